@@ -2,52 +2,416 @@
 #define FP_MATH_DY_H
 
 #include <stdint.h>
+#include <assert.h>
+
+/**
+ * Header only Q32.32 fixed point, bit compatible with the fp_math
+ * crate previously linked through fp_math_bindings.lib: same raw
+ * representation and the same truncation, wrapping and iteration
+ * rules for every operation, so results don't change when switching.
+ *
+ * Everything is inline and constexpr capable (C++14). The 128-bit
+ * intermediates of mul/div use __int128 where the compiler has it,
+ * and a portable 64-bit limb fallback otherwise (MSVC).
+ */
+
+#if defined(__SIZEOF_INT128__)
+#define FP64_HAS_INT128 1
+#else
+#define FP64_HAS_INT128 0
+#endif
 
-#ifdef __cplusplus
 namespace fp64
 {
-	extern "C" {
-		namespace fpc
+	namespace fpc
+	{
+		typedef struct Fp64
+		{
+			int64_t internal;
+		} Fp64;
+
+		constexpr int64_t FP64_ONE = 0x100000000;
+		constexpr int64_t FP64_PI = 0x3243F6A88;
+		constexpr int64_t FP64_TWO_PI = 0x6487ED511;
+		constexpr int64_t FP64_THREE_HALVES_PI = 0x4B65F1FCC;
+		constexpr int64_t FP64_EASY_SQRT_PRECISION = 0x10000;
+
+		// Wrapping integer helpers, signed overflow is UB in C++ but wraps in the reference implementation
+		constexpr int64_t WrappingAdd(int64_t a, int64_t b)
+		{
+			return (int64_t)((uint64_t)a + (uint64_t)b);
+		}
+
+		constexpr int64_t WrappingSub(int64_t a, int64_t b)
+		{
+			return (int64_t)((uint64_t)a - (uint64_t)b);
+		}
+
+		constexpr int64_t WrappingNeg(int64_t a)
+		{
+			return (int64_t)(0 - (uint64_t)a);
+		}
+
+		constexpr int64_t WrappingAbs(int64_t a)
+		{
+			return a < 0 ? WrappingNeg(a) : a;
+		}
+
+		constexpr int64_t WrappingShl(int64_t a, unsigned int shift)
+		{
+			return (int64_t)((uint64_t)a << shift);
+		}
+
+#if !FP64_HAS_INT128
+		// Unsigned 64x64 -> 128 product as hi:lo
+		constexpr void MulU64(uint64_t a, uint64_t b, uint64_t& hi, uint64_t& lo)
+		{
+			uint64_t aLo = a & 0xFFFFFFFF, aHi = a >> 32;
+			uint64_t bLo = b & 0xFFFFFFFF, bHi = b >> 32;
+			uint64_t ll = aLo * bLo;
+			uint64_t lh = aLo * bHi;
+			uint64_t hl = aHi * bLo;
+			uint64_t hh = aHi * bHi;
+			uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+			lo = (ll & 0xFFFFFFFF) | (mid << 32);
+			hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+		}
+
+		// Low 64 bits of the unsigned 128 / 64 quotient, restoring division
+		constexpr uint64_t DivU128(uint64_t hi, uint64_t lo, uint64_t d)
+		{
+			uint64_t quotient = 0;
+			uint64_t remainder = 0;
+			for (int i = 127; i >= 0; i--)
+			{
+				bool carry = (remainder >> 63) != 0;
+				remainder = (remainder << 1) | (((i >= 64 ? hi >> (i - 64) : lo >> i)) & 1);
+				if (carry || remainder >= d)
+				{
+					remainder -= d;
+					if (i < 64) quotient |= (uint64_t)1 << i;
+				}
+			}
+			return quotient;
+		}
+#endif
+
+		// Ops
+		constexpr Fp64 fp64_add(Fp64 a, Fp64 b)
+		{
+			return Fp64{ WrappingAdd(a.internal, b.internal) };
+		}
+
+		constexpr Fp64 fp64_sub(Fp64 a, Fp64 b)
+		{
+			return Fp64{ WrappingSub(a.internal, b.internal) };
+		}
+
+		// 128-bit product shifted back by 32, truncated toward zero
+		constexpr Fp64 fp64_mul(Fp64 a, Fp64 b)
+		{
+#if FP64_HAS_INT128
+			__int128 p = (__int128)a.internal * (__int128)b.internal;
+			if (p < 0) p += 0xFFFFFFFF;
+			return Fp64{ (int64_t)(p >> 32) };
+#else
+			bool negative = (a.internal < 0) != (b.internal < 0);
+			uint64_t hi = 0, lo = 0;
+			MulU64((uint64_t)WrappingAbs(a.internal), (uint64_t)WrappingAbs(b.internal), hi, lo);
+			uint64_t magnitude = (lo >> 32) | (hi << 32);
+			return Fp64{ negative ? WrappingNeg((int64_t)magnitude) : (int64_t)magnitude };
+#endif
+		}
+
+		// (a << 32) / b in 128 bits, truncated toward zero
+		constexpr Fp64 fp64_div(Fp64 a, Fp64 b)
+		{
+			assert(b.internal != 0);//The reference implementation panics
+#if FP64_HAS_INT128
+			return Fp64{ (int64_t)(((__int128)a.internal * FP64_ONE) / (__int128)b.internal) };
+#else
+			bool negative = (a.internal < 0) != (b.internal < 0);
+			uint64_t n = (uint64_t)WrappingAbs(a.internal);
+			uint64_t magnitude = DivU128(n >> 32, n << 32, (uint64_t)WrappingAbs(b.internal));
+			return Fp64{ negative ? WrappingNeg((int64_t)magnitude) : (int64_t)magnitude };
+#endif
+		}
+
+		constexpr Fp64 fp64_mod(Fp64 a, Fp64 b)
+		{
+			return Fp64{ a.internal % b.internal };
+		}
+
+		// Maths
+		constexpr Fp64 fp64_pow(Fp64 f, uint32_t exponent)
+		{
+			Fp64 result = Fp64{ FP64_ONE };
+			for (uint32_t i = 0; i < exponent; i++) result = fp64_mul(result, f);
+			return result;
+		}
+
+		// Heron's sqrt as a first guess, then Newton on 1/sqrt until 1/y^2 is within precision (raw) of f
+		constexpr Fp64 fp64_reciprocal_sqrt(Fp64 f, int64_t precision)
+		{
+			int64_t s = FP64_ONE;
+			for (int i = 0; i < 32; i++)
+			{
+				assert(s != 0);
+				int64_t q = fp64_div(f, Fp64{ s }).internal;
+				int64_t diff = WrappingAbs(WrappingSub(s, q));
+				s = WrappingAdd(s, q) >> 1;
+				if (diff <= FP64_ONE) break;
+			}
+			assert(s != 0);
+			Fp64 y = fp64_div(Fp64{ FP64_ONE }, Fp64{ s });
+			for (int i = 0; i < 128; i++)
+			{
+				Fp64 yfy = fp64_mul(fp64_mul(y, f), y);
+				y = fp64_mul(Fp64{ WrappingSub(3 * FP64_ONE, yfy.internal) }, Fp64{ y.internal >> 1 });
+				Fp64 y2 = fp64_mul(y, y);
+				if (y2.internal == 0) break;
+				if (WrappingAbs(WrappingSub(fp64_div(Fp64{ FP64_ONE }, y2).internal, f.internal)) <= precision) break;
+			}
+			return y;
+		}
+
+		constexpr Fp64 fp64_sqrt(Fp64 f, Fp64 precision)
+		{
+			Fp64 rsqrt = fp64_reciprocal_sqrt(f, precision.internal);
+			return rsqrt.internal == 0 ? Fp64{ 0 } : fp64_div(Fp64{ FP64_ONE }, rsqrt);
+		}
+
+		constexpr Fp64 fp64_easy_sqrt(Fp64 f)
+		{
+			return fp64_sqrt(f, Fp64{ FP64_EASY_SQRT_PRECISION });
+		}
+
+		// Taylor series to x^7 after wrapping to [-PI, PI), coefficients applied as integer divisions
+		constexpr Fp64 fp64_sin_wrapped(int64_t offset, Fp64 f)
+		{
+			int64_t x = WrappingSub(WrappingAdd(f.internal, offset) % FP64_TWO_PI, FP64_PI);
+			int64_t x2 = fp64_mul(Fp64{ x }, Fp64{ x }).internal;
+			int64_t x3 = fp64_mul(Fp64{ x2 }, Fp64{ x }).internal;
+			int64_t x4 = fp64_mul(Fp64{ x3 }, Fp64{ x }).internal;
+			int64_t x5 = fp64_mul(Fp64{ x4 }, Fp64{ x }).internal;
+			int64_t x6 = fp64_mul(Fp64{ x5 }, Fp64{ x }).internal;
+			int64_t x7 = fp64_mul(Fp64{ x6 }, Fp64{ x }).internal;
+			return Fp64{ WrappingAdd(WrappingAdd(WrappingAdd(x, x3 / -6), x5 / 120), x7 / -5040) };
+		}
+
+		constexpr Fp64 fp64_sin(Fp64 f)
+		{
+			return fp64_sin_wrapped(FP64_PI, f);
+		}
+
+		constexpr Fp64 fp64_cos(Fp64 f)
+		{
+			return fp64_sin_wrapped(FP64_THREE_HALVES_PI, f);
+		}
+
+		constexpr Fp64 fp64_half(Fp64 f)
+		{
+			return Fp64{ f.internal >> 1 };
+		}
+
+		constexpr Fp64 fp64_double(Fp64 f)
+		{
+			return Fp64{ WrappingShl(f.internal, 1) };
+		}
+
+		// Int conversions
+		constexpr Fp64 fp64_from_i32(int32_t i)
+		{
+			return Fp64{ WrappingShl(i, 32) };
+		}
+
+		constexpr Fp64 fp64_from_i64(int64_t i)
+		{
+			return Fp64{ WrappingShl(i, 32) };
+		}
+
+		constexpr int32_t fp64_to_i32(Fp64 f)
+		{
+			return (int32_t)(f.internal / FP64_ONE);
+		}
+
+		constexpr int64_t fp64_to_i64(Fp64 f)
+		{
+			return f.internal / FP64_ONE;
+		}
+
+		// Float conversions, saturating like Rust's 'as'
+		constexpr Fp64 fp64_from_f32(float f)
+		{
+			float scaled = f * 4294967296.0f;
+			if (scaled != scaled) return Fp64{ 0 };
+			if (scaled >= 9223372036854775808.0f) return Fp64{ INT64_MAX };
+			if (scaled <= -9223372036854775808.0f) return Fp64{ INT64_MIN };
+			return Fp64{ (int64_t)scaled };
+		}
+
+		constexpr Fp64 fp64_from_f64(double f)
+		{
+			double scaled = f * 4294967296.0;
+			if (scaled != scaled) return Fp64{ 0 };
+			if (scaled >= 9223372036854775808.0) return Fp64{ INT64_MAX };
+			if (scaled <= -9223372036854775808.0) return Fp64{ INT64_MIN };
+			return Fp64{ (int64_t)scaled };
+		}
+
+		constexpr float fp64_to_f32(Fp64 f)
+		{
+			return (float)f.internal * (1.0f / 4294967296.0f);
+		}
+
+		constexpr double fp64_to_f64(Fp64 f)
+		{
+			return (double)f.internal * (1.0 / 4294967296.0);
+		}
+
+		// Fast deterministic maths. Integer only, so every compiler produces the same bits.
+		// Error bounds are against the exact result, measured by the precision report test
+		constexpr int64_t FP64_FAST_PI = 0x3243F6A89;
+		constexpr int64_t FP64_FAST_HALF_PI = 0x1921FB544;
+		constexpr int64_t FP64_FAST_QUARTER_PI = 0xC90FDAA2;
+		constexpr int64_t FP64_HALF_PI_Q62_HI = 0x6487ED51;//PI/2 with 62 fractional bits, split in 32-bit halves
+		constexpr int64_t FP64_HALF_PI_Q62_LO = 0x10B4611A;
+		constexpr int64_t FP64_ATAN_EIGHTHS[9] = { 0x0, 0x1FD5BA9B, 0x3EB6EBF2, 0x5BD86508, 0x76B19C16, 0x8F005D5F, 0xA4BC7D19,
+		 0xB8053E2C, 0xC90FDAA2 };//atan(i/8)
+
+		constexpr int BitLength(uint64_t v)
+		{
+			int n = 0;
+			if (v >> 32) { v >>= 32; n += 32; }
+			if (v >> 16) { v >>= 16; n += 16; }
+			if (v >> 8) { v >>= 8; n += 8; }
+			if (v >> 4) { v >>= 4; n += 4; }
+			if (v >> 2) { v >>= 2; n += 2; }
+			if (v >> 1) { v >>= 1; n += 1; }
+			return n + (int)v;
+		}
+
+		constexpr int64_t MulRaw(int64_t a, int64_t b)
+		{
+			return fp64_mul(Fp64{ a }, Fp64{ b }).internal;
+		}
+
+		constexpr int64_t FloorDiv(int64_t a, int64_t b)//b > 0
 		{
-#endif // __cplusplus
+			return (a % b != 0 && a < 0) ? a / b - 1 : a / b;
+		}
 
-			typedef struct Fp64
+		// floor(sqrt(f)), exact to the last bit: error < 1 ulp (2^-32). Returns 0 for f <= 0
+		constexpr Fp64 fp64_fast_sqrt(Fp64 f)
+		{
+			if (f.internal <= 0) return Fp64{ 0 };
+			//Integer root of raw * 2^32 (96 bits as hi:lo) digit by digit, two input bits per root bit
+			//The high pairs come from raw itself, the low 16 pairs are all zero
+			uint64_t raw = (uint64_t)f.internal;
+			uint64_t remainder = 0, root = 0;
+			for (int pair = (BitLength(raw) + 1) / 2 - 1; pair >= -16; pair--)
 			{
-				int64_t internal;
-			} Fp64;
-
-			// Ops
-			extern Fp64 fp64_add(Fp64 a, Fp64 b);
-			extern Fp64 fp64_sub(Fp64 a, Fp64 b);
-			extern Fp64 fp64_mul(Fp64 a, Fp64 b);
-			extern Fp64 fp64_div(Fp64 a, Fp64 b);
-			extern Fp64 fp64_mod(Fp64 a, Fp64 b);
-
-			// Maths
-			extern Fp64 fp64_pow(Fp64 f, uint32_t exponent);
-			extern Fp64 fp64_sqrt(Fp64 f, Fp64 precision);
-			extern Fp64 fp64_easy_sqrt(Fp64 f);
-			extern Fp64 fp64_reciprocal_sqrt(Fp64 f, uint32_t iterations);
-			extern Fp64 fp64_sin(Fp64 f);
-			extern Fp64 fp64_cos(Fp64 f);
-			extern Fp64 fp64_half(Fp64 f);
-			extern Fp64 fp64_double(Fp64 f);
-
-			// Int conversions
-			extern Fp64 fp64_from_i32(int32_t i);
-			extern Fp64 fp64_from_i64(int64_t i);
-			extern int32_t fp64_to_i32(Fp64 f);
-			extern int64_t fp64_to_i64(Fp64 f);
-
-			// Float conversions
-			extern Fp64 fp64_from_f32(float i);
-			extern Fp64 fp64_from_f64(double i);
-			extern float fp64_to_f32(Fp64 f);
-			extern double fp64_to_f64(Fp64 f);
-
-#ifdef __cplusplus
-		} // namespace fpc
-	} // extern C
+				remainder = (remainder << 2) | (pair >= 0 ? (raw >> (pair * 2)) & 3 : 0);
+				uint64_t trial = (root << 2) | 1;
+				uint64_t take = 0 - (uint64_t)(remainder >= trial);//Branchless, the comparison is unpredictable
+				remainder -= trial & take;
+				root = (root << 1) | (take & 1);
+			}
+			return Fp64{ (int64_t)root };
+		}
+
+		// 1 / fast_sqrt(f), one division: error <= (1 + 1/f) ulp. Returns 0 for f <= 0
+		constexpr Fp64 fp64_fast_reciprocal_sqrt(Fp64 f)
+		{
+			Fp64 root = fp64_fast_sqrt(f);
+			return root.internal == 0 ? Fp64{ 0 } : fp64_div(Fp64{ FP64_ONE }, root);
+		}
+
+		// Polynomials for |r| <= PI/4, truncation error below 2^-36
+		constexpr int64_t SinQuarter(int64_t r)
+		{
+			int64_t r2 = MulRaw(r, r);
+			int64_t p = -108;//-1/11!
+			p = WrappingAdd(11836, MulRaw(p, r2));
+			p = WrappingAdd(-852176, MulRaw(p, r2));
+			p = WrappingAdd(35791394, MulRaw(p, r2));
+			p = WrappingAdd(-715827883, MulRaw(p, r2));
+			return WrappingAdd(r, MulRaw(MulRaw(p, r2), r));
+		}
+
+		constexpr int64_t CosQuarter(int64_t r)
+		{
+			int64_t r2 = MulRaw(r, r);
+			int64_t p = 9;//1/12!
+			p = WrappingAdd(-1184, MulRaw(p, r2));
+			p = WrappingAdd(106522, MulRaw(p, r2));
+			p = WrappingAdd(-5965232, MulRaw(p, r2));
+			p = WrappingAdd(178956971, MulRaw(p, r2));
+			p = WrappingAdd(-2147483648LL, MulRaw(p, r2));
+			return WrappingAdd(FP64_ONE, MulRaw(p, r2));
+		}
+
+		// Both share one range reduction to [-PI/4, PI/4]: error <= 4 ulp (~1e-9) for |f| < 2^20
+		constexpr void fp64_fast_sincos(Fp64 f, Fp64& sinOut, Fp64& cosOut)
+		{
+			int64_t k = FloorDiv(WrappingAdd(f.internal, FP64_FAST_QUARTER_PI), FP64_FAST_HALF_PI);
+			//k * PI/2 from the 62-bit constant, split so every product stays in 64 bits
+			int64_t kHalfPi = WrappingAdd(WrappingShl(k * FP64_HALF_PI_Q62_HI, 2), (k * FP64_HALF_PI_Q62_LO + (1LL << 29)) >> 30);
+			int64_t r = WrappingSub(f.internal, kHalfPi);
+			int64_t s = SinQuarter(r);
+			int64_t c = CosQuarter(r);
+			switch (k & 3)
+			{
+			case 0: sinOut = Fp64{ s }; cosOut = Fp64{ c }; break;
+			case 1: sinOut = Fp64{ c }; cosOut = Fp64{ WrappingNeg(s) }; break;
+			case 2: sinOut = Fp64{ WrappingNeg(s) }; cosOut = Fp64{ WrappingNeg(c) }; break;
+			default: sinOut = Fp64{ WrappingNeg(c) }; cosOut = Fp64{ s }; break;
+			}
+		}
+
+		constexpr Fp64 fp64_fast_sin(Fp64 f)
+		{
+			Fp64 s{ 0 }, c{ 0 };
+			fp64_fast_sincos(f, s, c);
+			return s;
+		}
+
+		constexpr Fp64 fp64_fast_cos(Fp64 f)
+		{
+			Fp64 s{ 0 }, c{ 0 };
+			fp64_fast_sincos(f, s, c);
+			return c;
+		}
+
+		// Octant reduction, then atan(t) = atan(i/8) + atan(u) with |u| <= 1/16: error <= 4 ulp. Range [-PI, PI], atan2(0, 0) = 0
+		constexpr Fp64 fp64_fast_atan2(Fp64 y, Fp64 x)
+		{
+			if (x.internal == 0 && y.internal == 0) return Fp64{ 0 };
+			uint64_t ax = (uint64_t)WrappingAbs(x.internal);
+			uint64_t ay = (uint64_t)WrappingAbs(y.internal);
+			bool swap = ay > ax;
+			uint64_t num = swap ? ax : ay;
+			uint64_t den = swap ? ay : ax;
+			if (den >> 63)
+			{
+				num >>= 1;
+				den >>= 1;
+			}
+			int64_t t = fp64_div(Fp64{ (int64_t)num }, Fp64{ (int64_t)den }).internal;//[0, 1]
+			int64_t i = (t + (FP64_ONE >> 4)) >> 29;
+			int64_t c = i << 29;
+			int64_t u = fp64_div(Fp64{ t - c }, Fp64{ FP64_ONE + MulRaw(t, c) }).internal;
+			int64_t u2 = MulRaw(u, u);
+			int64_t p = -613566757;//-1/7
+			p = 858993459 + MulRaw(p, u2);
+			p = -1431655765 + MulRaw(p, u2);
+			int64_t a = FP64_ATAN_EIGHTHS[i] + u + MulRaw(MulRaw(p, u2), u);
+			if (swap) a = FP64_FAST_HALF_PI - a;
+			if (x.internal < 0) a = FP64_FAST_PI - a;
+			if (y.internal < 0) a = -a;
+			return Fp64{ a };
+		}
+	} // namespace fpc
 
 	/**
 	 * Class wrapped around the equivalent C struct and its associated
@@ -73,26 +437,22 @@ namespace fp64
 		fpc::Fp64 m_Internal;
 	public:
 		// 'Constructors':
-		inline Fp64(fpc::Fp64 Internal) : m_Internal(Internal) {};
+		constexpr Fp64(fpc::Fp64 Internal) : m_Internal(Internal) {};
 
-		inline Fp64()
+		constexpr Fp64() : m_Internal{ 0 }
 		{
-			m_Internal = fpc::Fp64{ 0 };
 		}
 
-		inline Fp64(float f)
+		constexpr Fp64(float f) : m_Internal(fpc::fp64_from_f32(f))
 		{
-			*this = FromFloat(f);
 		}
 
-		inline Fp64(int i)
+		constexpr Fp64(int i) : m_Internal(fpc::fp64_from_i32(i))
 		{
-			*this = FromInt32(i);
 		}
 
-		inline Fp64(double d)
+		constexpr Fp64(double d) : m_Internal(fpc::fp64_from_f64(d))
 		{
-			*this = FromDouble(d);
 		}
 
 		/**
@@ -100,10 +460,13 @@ namespace fp64
 		 * 64-bit int representation. This should be used
 		 * with caution, as the scale is not guaranteed to
 		 * stay the same in future versions!
+		 * Stores i as the raw Q32.32 value, so it round trips
+		 * with InternalRepresentation. Use FromInt64 for
+		 * integers.
 		 */
-		inline static Fp64 WithInternalRepresentation(int64_t i)
+		constexpr static Fp64 WithInternalRepresentation(int64_t i)
 		{
-			return Fp64({ fpc::fp64_from_i64(i) });
+			return Fp64(fpc::Fp64{ i });
 		}
 
 		/**
@@ -112,7 +475,7 @@ namespace fp64
 		 * to a float carries no guarantees that the value
 		 * will be identical to when it was initially provided.
 		 */
-		inline static Fp64 FromFloat(float f)
+		constexpr static Fp64 FromFloat(float f)
 		{
 			return Fp64(fpc::fp64_from_f32(f));
 		}
@@ -123,7 +486,7 @@ namespace fp64
 		 * to a double carries no guarantees that the value
 		 * will be identical to when it was initially provided.
 		 */
-		inline static Fp64 FromDouble(double d)
+		constexpr static Fp64 FromDouble(double d)
 		{
 			return Fp64(fpc::fp64_from_f64(d));
 		}
@@ -134,7 +497,7 @@ namespace fp64
 		 * an int32_t is guaranteed to return a value
 		 * identical to the initially provided value.
 		 */
-		inline static Fp64 FromInt32(int32_t i)
+		constexpr static Fp64 FromInt32(int32_t i)
 		{
 			return Fp64(fpc::fp64_from_i32(i));
 		}
@@ -145,168 +508,208 @@ namespace fp64
 		 * an int64_t is guaranteed to return a value
 		 * identical to the initially provided value.
 		 */
-		inline static Fp64 FromInt64(int64_t i)
+		constexpr static Fp64 FromInt64(int64_t i)
 		{
 			return Fp64(fpc::fp64_from_i64(i));
 		}
 
 		// Conversions
 
-		inline explicit operator bool() const
+		constexpr explicit operator bool() const
 		{
-			return m_Internal.internal;
+			return m_Internal.internal != 0;
 		}
 
-		inline explicit operator int32_t() const
+		constexpr explicit operator int32_t() const
 		{
 			return fpc::fp64_to_i32(m_Internal);
 		}
 
-		inline explicit operator int64_t() const
+		constexpr explicit operator int64_t() const
 		{
 			return fpc::fp64_to_i64(m_Internal);
 		}
 
-		inline explicit operator float() const
+		constexpr explicit operator float() const
 		{
 			return fpc::fp64_to_f32(m_Internal);
 		}
 
-		inline explicit operator double() const
+		constexpr explicit operator double() const
 		{
 			return fpc::fp64_to_f64(m_Internal);
 		}
 
 		// Arithmetic operators
-		inline friend Fp64 operator+(Fp64 Lhs, Fp64 Rhs);
+		constexpr friend Fp64 operator+(Fp64 Lhs, Fp64 Rhs);
 
-		inline friend Fp64 operator-(Fp64 Lhs, Fp64 Rhs);
+		constexpr friend Fp64 operator-(Fp64 Lhs, Fp64 Rhs);
 
-		inline Fp64 operator-() const
+		constexpr Fp64 operator-() const
 		{
-			return Fp64(fpc::Fp64{ -m_Internal.internal });
+			return Fp64(fpc::Fp64{ fpc::WrappingNeg(m_Internal.internal) });
 		}
 
-		inline Fp64 operator*(Fp64 Rhs) const
+		constexpr Fp64 operator*(Fp64 Rhs) const
 		{
 			return Fp64(fpc::fp64_mul(m_Internal, Rhs.m_Internal));
 		}
 
-		inline friend Fp64 operator/(Fp64 Lhs, Fp64 Rhs);
+		constexpr friend Fp64 operator/(Fp64 Lhs, Fp64 Rhs);
 
-		inline Fp64 operator%(Fp64 Rhs) const
+		constexpr Fp64 operator%(Fp64 Rhs) const
 		{
 			return Fp64(fpc::fp64_mod(m_Internal, Rhs.m_Internal));
 		}
 
 		// Arithmetic assignment operators
-		inline Fp64& operator+=(Fp64 Rhs)
+		constexpr Fp64& operator+=(Fp64 Rhs)
 		{
 			m_Internal = fpc::fp64_add(m_Internal, Rhs.m_Internal);
 			return *this;
 		}
 
-		inline Fp64& operator-=(Fp64 Rhs)
+		constexpr Fp64& operator-=(Fp64 Rhs)
 		{
 			m_Internal = fpc::fp64_sub(m_Internal, Rhs.m_Internal);
 			return *this;
 		}
 
-		inline Fp64& operator*=(Fp64 Rhs)
+		constexpr Fp64& operator*=(Fp64 Rhs)
 		{
 			m_Internal = fpc::fp64_mul(m_Internal, Rhs.m_Internal);
 			return *this;
 		}
 
-		inline Fp64& operator/=(Fp64 Rhs)
+		constexpr Fp64& operator/=(Fp64 Rhs)
 		{
 			m_Internal = fpc::fp64_div(m_Internal, Rhs.m_Internal);
 			return *this;
 		}
 
-		inline Fp64& operator%=(Fp64 Rhs)
+		constexpr Fp64& operator%=(Fp64 Rhs)
 		{
 			m_Internal = fpc::fp64_mod(m_Internal, Rhs.m_Internal);
 			return *this;
 		}
 
 		// Comparison operators
-		inline bool operator==(const Fp64& Rhs) const
+		constexpr bool operator==(const Fp64& Rhs) const
 		{
 			return m_Internal.internal == Rhs.m_Internal.internal;
 		}
 
-		inline bool EqualsEps(const Fp64& Rhs, const Fp64& epsilon) const
+		constexpr bool EqualsEps(const Fp64& Rhs, const Fp64& epsilon) const
 		{
 			return Abs(*this - Rhs) < epsilon;
 		}
-		inline bool operator!=(const Fp64& Rhs) const
+		constexpr bool operator!=(const Fp64& Rhs) const
 		{
 			return !(*this == Rhs);
 		}
 
-		inline bool operator>(const Fp64& Rhs) const
+		constexpr bool operator>(const Fp64& Rhs) const
 		{
 			return m_Internal.internal > Rhs.m_Internal.internal;
 		}
 
-		inline bool operator>=(const Fp64& Rhs) const
+		constexpr bool operator>=(const Fp64& Rhs) const
 		{
 			return m_Internal.internal >= Rhs.m_Internal.internal;
 		}
 
-		inline bool operator<(const Fp64& Rhs) const
+		constexpr bool operator<(const Fp64& Rhs) const
 		{
 			return m_Internal.internal < Rhs.m_Internal.internal;
 		}
 
-		inline bool operator<=(const Fp64& Rhs) const
+		constexpr bool operator<=(const Fp64& Rhs) const
 		{
 			return m_Internal.internal <= Rhs.m_Internal.internal;
 		}
 
 		// Arithmetic functions
-		inline static Fp64 Sqrt(Fp64 F, Fp64 Precision)
+		constexpr static Fp64 Sqrt(Fp64 F, Fp64 Precision)
 		{
 			return Fp64(fpc::fp64_sqrt(F.m_Internal, Precision.m_Internal));
 		}
 
-		inline static Fp64 EasySqrt(Fp64 F)
+		constexpr static Fp64 EasySqrt(Fp64 F)
 		{
 			return Fp64(fpc::fp64_easy_sqrt(F.m_Internal));
 		}
 
-		inline static Fp64 Reciprocal_Sqrt(Fp64 F, uint32_t Iterations)
+		/**
+		 * Despite the name, the binding always forwarded this
+		 * argument as the raw precision of the Newton loop
+		 * (stop when |1/y^2 - F| <= Iterations), kept as is.
+		 */
+		constexpr static Fp64 Reciprocal_Sqrt(Fp64 F, uint32_t Iterations)
 		{
-			return Fp64(fpc::fp64_reciprocal_sqrt(F.m_Internal, Iterations));
+			return Fp64(fpc::fp64_reciprocal_sqrt(F.m_Internal, (int64_t)Iterations));
 		}
 
-		inline static Fp64 Pow(Fp64 F, uint32_t Exponent)
+		constexpr static Fp64 Pow(Fp64 F, uint32_t Exponent)
 		{
 			return Fp64(fpc::fp64_pow(F.m_Internal, Exponent));
 		}
 
-		inline static Fp64 Sin(Fp64 F)
+		constexpr static Fp64 Sin(Fp64 F)
 		{
 			return Fp64(fpc::fp64_sin(F.m_Internal));
 		}
 
-		inline static Fp64 Cos(Fp64 F)
+		constexpr static Fp64 Cos(Fp64 F)
 		{
 			return Fp64(fpc::fp64_cos(F.m_Internal));
 		}
 
-		inline static Fp64 Abs(Fp64 F)
+		/**
+		 * Fast deterministic variants, integer only. They are
+		 * not bit compatible with Sqrt/Sin/Cos above, see the
+		 * fpc::fp64_fast_* functions for their error bounds.
+		 */
+		constexpr static Fp64 FastSqrt(Fp64 F)
+		{
+			return Fp64(fpc::fp64_fast_sqrt(F.m_Internal));
+		}
+
+		constexpr static Fp64 FastReciprocalSqrt(Fp64 F)
+		{
+			return Fp64(fpc::fp64_fast_reciprocal_sqrt(F.m_Internal));
+		}
+
+		constexpr static Fp64 FastSin(Fp64 F)
+		{
+			return Fp64(fpc::fp64_fast_sin(F.m_Internal));
+		}
+
+		constexpr static Fp64 FastCos(Fp64 F)
+		{
+			return Fp64(fpc::fp64_fast_cos(F.m_Internal));
+		}
+
+		constexpr static void FastSinCos(Fp64 F, Fp64& Sin, Fp64& Cos)
+		{
+			fpc::fp64_fast_sincos(F.m_Internal, Sin.m_Internal, Cos.m_Internal);
+		}
+
+		constexpr static Fp64 Atan2(Fp64 Y, Fp64 X)
+		{
+			return Fp64(fpc::fp64_fast_atan2(Y.m_Internal, X.m_Internal));
+		}
+
+		constexpr static Fp64 Abs(Fp64 F)
 		{
 			return (F >= 0) ? F : -F;
 		}
 
-		inline Fp64 Half() const
+		constexpr Fp64 Half() const
 		{
 			return Fp64(fpc::fp64_half(m_Internal));
 		}
 
-		inline Fp64 Double() const
+		constexpr Fp64 Double() const
 		{
 			return Fp64(fpc::fp64_double(m_Internal));
 		}
@@ -317,34 +720,32 @@ namespace fp64
 		 * in future versions the scale may change, so
 		 * manipulate this value with caution.
 		 */
-		inline int64_t InternalRepresentation() const
+		constexpr int64_t InternalRepresentation() const
 		{
 			return m_Internal.internal;
 		}
 
-		inline int64_t* InternalRepresentationP()
+		constexpr int64_t* InternalRepresentationP()
 		{
 			return &m_Internal.internal;
 		}
 	};
 	//Friend funcs
-	inline Fp64 operator+(Fp64 Lhs, Fp64 Rhs)
+	constexpr Fp64 operator+(Fp64 Lhs, Fp64 Rhs)
 	{
 		return Fp64(fpc::fp64_add(Lhs.m_Internal, Rhs.m_Internal));
 	}
 
-	inline Fp64 operator-(Fp64 Lhs, Fp64 Rhs)
+	constexpr Fp64 operator-(Fp64 Lhs, Fp64 Rhs)
 	{
 		return Fp64(fpc::fp64_sub(Lhs.m_Internal, Rhs.m_Internal));
 	}
 
-	inline Fp64 operator/(Fp64 Lhs, Fp64 Rhs)
+	constexpr Fp64 operator/(Fp64 Lhs, Fp64 Rhs)
 	{
 		return Fp64(fpc::fp64_div(Lhs.m_Internal, Rhs.m_Internal));
 	}
 
 } // namespace fp64
 
-#endif // __cplusplus
-
 #endif // FP_MATH_DY_H
@@ -0,0 +1,42 @@
+#include "AllocationHooks.h"
+
+#include <stdlib.h>
+
+static void* DefaultAllocate(size_t size, void*)
+{
+	return malloc(size);
+}
+
+static void* DefaultReallocate(void* memory, size_t size, void*)
+{
+	return realloc(memory, size);
+}
+
+static void DefaultDeallocate(void* memory, void*)
+{
+	free(memory);
+}
+
+static AllocationHooks s_hooks = { DefaultAllocate, DefaultReallocate, DefaultDeallocate, nullptr };
+
+void SetAllocationHooks(const AllocationHooks* hooks)
+{
+	if (hooks) s_hooks = *hooks;
+	else s_hooks = AllocationHooks{ DefaultAllocate, DefaultReallocate, DefaultDeallocate, nullptr };
+}
+
+void* PipAllocate(size_t size)
+{
+	return s_hooks.allocate(size, s_hooks.userData);
+}
+
+void* PipReallocate(void* memory, size_t size)
+{
+	return s_hooks.reallocate(memory, size, s_hooks.userData);
+}
+
+//The current hooks, SetAllocationHooks isn't called while pip memory is out
+void PipFree(void* memory)
+{
+	if (memory) s_hooks.deallocate(memory, s_hooks.userData);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+
+//Where pip's raw allocations go: body pools, quadtree nodes and world batch blocks. A host routes them through its own
+//tracked allocator by setting hooks before it creates any solver. Blocks don't remember which hooks made them, they're
+//grown and freed through whichever hooks are set at the time: hooks must not change while any solver, allocator or world
+//batch exists. std::vector members stay on the standard allocator, Solver::GetMemoryReport accounts for them
+struct AllocationHooks
+{
+	void* (*allocate)(size_t size, void* userData);
+	void* (*reallocate)(void* memory, size_t size, void* userData);//Keeps the contents, like realloc
+	void (*deallocate)(void* memory, void* userData);
+	void* userData;
+};
+
+void SetAllocationHooks(const AllocationHooks* hooks);//Null goes back to malloc, realloc and free. Only while no pip object lives
+void* PipAllocate(size_t size);
+void* PipReallocate(void* memory, size_t size);
+void PipFree(void* memory);
@@ -0,0 +1,145 @@
+#include "AsyncSolver.h"
+
+#include "PipMath.h"
+
+#define SNAPSHOT_IDX_MASK 3
+#define SNAPSHOT_FRESH 4//Set on m_latest by the physics thread, cleared by the reader taking it
+
+using namespace std;
+using namespace std::chrono;
+using namespace PipMath;
+
+template <typename T>
+BasicRenderSnapshot<T>::BasicRenderSnapshot()
+	: stepCount(0), time(0), timestep(0)
+{
+}
+
+template <typename T>
+BasicRigidbody<T>* BasicRenderSnapshot<T>::GetFirstBody()
+{
+	if (pool.empty()) return nullptr;
+	return (Rigidbody*)pool.data();
+}
+
+template <typename T>
+BasicRigidbody<T>* BasicRenderSnapshot<T>::GetNextBody(Rigidbody* prev)
+{
+	char* next = (char*)prev + DefaultAllocator::GetBodyByteSize(prev->m_bodyType);
+	if (next == pool.data() + pool.size()) return nullptr;
+	return (Rigidbody*)next;
+}
+
+template <typename T>
+BasicRigidbody<T>* BasicRenderSnapshot<T>::GetBody(Handle handle)
+{
+	if (handle.idx >= mappings.size() || !mappings[handle.idx].active || mappings[handle.idx].generation != handle.generation)
+	{
+		return nullptr;
+	}
+	Rigidbody* rb = GetFirstBody();
+	for (size_t i = 0; i < mappings[handle.idx].idx && rb; i++) rb = GetNextBody(rb);
+	return rb;
+}
+
+template <typename T>
+BasicAsyncSolver<T>::BasicAsyncSolver(Solver& solver)
+	: m_solver(solver), m_latest(2), m_writeIdx(0), m_readIdx(1), m_running(false), m_epoch(steady_clock::now())
+{
+}
+
+template <typename T>
+BasicAsyncSolver<T>::~BasicAsyncSolver()
+{
+	Stop();
+}
+
+template <typename T>
+void BasicAsyncSolver<T>::Start()
+{
+	if (IsRunning()) return;
+	m_writeIdx = 0;
+	m_readIdx = 1;
+	m_latest.store(2, memory_order_relaxed);
+	Publish(0, GetTime());
+	m_running.store(true, memory_order_release);
+	m_thread = thread(&BasicAsyncSolver<T>::Run, this);
+}
+
+template <typename T>
+void BasicAsyncSolver<T>::Stop()
+{
+	m_running.store(false, memory_order_release);
+	if (m_thread.joinable()) m_thread.join();
+}
+
+template <typename T>
+bool BasicAsyncSolver<T>::IsRunning()
+{
+	return m_thread.joinable();
+}
+
+template <typename T>
+BasicRenderSnapshot<T>& BasicAsyncSolver<T>::AcquireSnapshot()
+{
+	//Swap the snapshot we were reading for the latest, unless there's been no step since
+	if (m_latest.load(memory_order_relaxed) & SNAPSHOT_FRESH)
+	{
+		m_readIdx = m_latest.exchange(m_readIdx, memory_order_acq_rel) & SNAPSHOT_IDX_MASK;
+	}
+	return m_snapshots[m_readIdx];
+}
+
+template <typename T>
+T BasicAsyncSolver<T>::GetAlpha(const RenderSnapshot& snapshot)
+{
+	//Drawing runs one step behind: the snapshot's step is reached a timestep after it was due
+	if (snapshot.timestep <= 0) return 1;
+	float alpha = (float)((GetTime() - snapshot.time) / (double)snapshot.timestep);
+	return (decimal)Clamp(alpha, 0.f, 1.f);
+}
+
+template <typename T>
+double BasicAsyncSolver<T>::GetTime()
+{
+	return duration<double>(steady_clock::now() - m_epoch).count();
+}
+
+template <typename T>
+void BasicAsyncSolver<T>::Run()
+{
+	unsigned int stepCount = 0;
+	steady_clock::time_point nextStep = steady_clock::now();
+	while (m_running.load(memory_order_acquire))
+	{
+		nextStep += duration_cast<steady_clock::duration>(duration<double>((double)m_solver.m_timestep));
+		this_thread::sleep_until(nextStep);
+		if (!m_running.load(memory_order_acquire)) break;
+		//Like Update's accumulator, falling more than 0.2 seconds behind drops the time instead of catching up on it
+		steady_clock::time_point now = steady_clock::now();
+		if (now - nextStep > duration_cast<steady_clock::duration>(duration<double>(0.2))) nextStep = now;
+		(m_solver.m_continuousCollision) ? m_solver.ContinuousStep(m_solver.m_timestep) : m_solver.Step(m_solver.m_timestep);
+		Publish(++stepCount, duration<double>(nextStep - m_epoch).count());
+	}
+}
+
+template <typename T>
+void BasicAsyncSolver<T>::Publish(unsigned int stepCount, double time)
+{
+	//Buffers keep their capacity, a world that doesn't grow stops allocating after the first three steps
+	RenderSnapshot& snapshot = m_snapshots[m_writeIdx];
+	DefaultAllocator& allocator = m_solver.m_allocator;
+	snapshot.pool.assign(allocator.m_pool.start, allocator.m_pool.next);
+	snapshot.mappings.assign(allocator.m_mappings.begin(), allocator.m_mappings.end());
+	snapshot.objectToMappingIdx.assign(allocator.m_objectToMappingIdx.begin(), allocator.m_objectToMappingIdx.end());
+	snapshot.stepCount = stepCount;
+	snapshot.time = time;
+	snapshot.timestep = m_solver.m_timestep;
+	//Hand the written snapshot over and take back whichever one the reader isn't holding
+	m_writeIdx = m_latest.exchange(m_writeIdx | SNAPSHOT_FRESH, memory_order_acq_rel) & SNAPSHOT_IDX_MASK;
+}
+
+template struct BasicRenderSnapshot<float>;
+template struct BasicRenderSnapshot<fp64::Fp64>;
+template class BasicAsyncSolver<float>;
+template class BasicAsyncSolver<fp64::Fp64>;
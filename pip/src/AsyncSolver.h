@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "Solver.h"
+
+//Copy of the bodies as they were after one step, for drawing while the next steps run. Bodies are stored raw like
+//SolverState, each one still holds the transform of the step before in m_prevPos and m_prevRot
+template <typename T>
+struct BasicRenderSnapshot
+{
+	PIP_SCALAR_TYPES(T)
+	typedef BasicDefaultAllocator<T> DefaultAllocator;
+
+	BasicRenderSnapshot();
+	Rigidbody* GetFirstBody();
+	Rigidbody* GetNextBody(Rigidbody* prev);
+	Rigidbody* GetBody(Handle handle);//Null if the body didn't exist when the snapshot was taken
+	std::vector<char> pool;
+	std::vector<Idx> mappings;
+	std::vector<size_t> objectToMappingIdx;
+	unsigned int stepCount;//Steps taken since Start, 0 is the state Start found
+	double time;//Seconds since the async solver was created, when this step was due
+	decimal timestep;
+};
+typedef BasicRenderSnapshot<decimal> RenderSnapshot;
+
+//Runs a solver's fixed steps on a thread of its own, in real time. Every step is published to a triple buffer: the
+//physics thread always has a free snapshot to write and the reader always has a complete one, neither waits on a lock.
+//The solver belongs to the physics thread between Start and Stop, anything that touches it (creating bodies, input,
+//changing settings) has to Stop first
+template <typename T>
+class BasicAsyncSolver
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	typedef BasicSolver<T> Solver;
+	typedef BasicDefaultAllocator<T> DefaultAllocator;
+	typedef BasicRenderSnapshot<T> RenderSnapshot;
+
+	BasicAsyncSolver(Solver& solver);
+	~BasicAsyncSolver();
+	void Start();//Takes the solver over, the first snapshot is its current state
+	void Stop();//Joins the physics thread, the solver holds the last step taken
+	bool IsRunning();
+	RenderSnapshot& AcquireSnapshot();//Latest published step, stays untouched until the next AcquireSnapshot
+	decimal GetAlpha(const RenderSnapshot& snapshot);//Blend from m_prevPos to m_position for drawing it now, 0 to 1
+	double GetTime();
+private:
+	void Run();
+	void Publish(unsigned int stepCount, double time);
+public:
+	Solver& m_solver;
+	RenderSnapshot m_snapshots[3];
+	std::atomic<int> m_latest;//Index of the last published snapshot, plus FRESH while the reader hasn't taken it
+	int m_writeIdx;//Physics thread only
+	int m_readIdx;//Reader only
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+	std::chrono::steady_clock::time_point m_epoch;
+};
+typedef BasicAsyncSolver<decimal> AsyncSolver;
@@ -1,13 +1,14 @@
 #include "Capsule.h"
 
-#include <float.h>
-
 #include "Circle.h"
 #include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
 
 using namespace PipMath;
 
-Capsule::Capsule(decimal length, decimal radius, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass, decimal e,
+template <typename T>
+BasicCapsule<T>::BasicCapsule(decimal length, decimal radius, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass, decimal e,
  bool isKinematic)
 	: m_length(length), m_radius(radius), Rigidbody(pos, rot, vel, angVel, mass, e, isKinematic)
 {
@@ -27,150 +28,56 @@ Capsule::Capsule(decimal length, decimal radius, Vector2 pos, decimal rot, Vecto
 	m_inertia = inertiaRectangle + inertiaCircle2;
 }
 
-Capsule::~Capsule()
+template <typename T>
+BasicCapsule<T>::~BasicCapsule()
 {
 }
 //Intersect test with AABB (Quad Nodes)
-bool Capsule::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
 {
-	//#Early out tests
-	//Equation of a line
-	//Caps line	y = mx + c
-	decimal m = Tan(m_rotation);
-	//Clamp line segment to aabb, compare sqdist to sqrRad
-	//Get Capsule's AB
+	//Segment swept by the radius vs box, in box space. No slopes or divisions, so it holds at any angle and in fixed point
+	Vector2 extents = (topRight - bottomLeft) / 2;
+	Vector2 p = m_position - (bottomLeft + extents);
+	Vector2 u = Vector2(m_rotationMatrix.c, m_rotationMatrix.s);
+	Vector2 n = u.Perp();
 	decimal halfLength = m_length / 2;
-	Vector2 a = Vector2{ -halfLength, 0 };
-	Vector2 b = Vector2{ halfLength, 0 };
-	//Rotate about position
-	a.Rotate(m_rotation);
-	b.Rotate(m_rotation);
-	a += m_position;
-	b += m_position;
-	decimal c = a.y - m*a.x;
-
-	Vector2 boxPoints[4] =
-	{
-		topRight,
-		Vector2(topRight.x, bottomLeft.y), //bottomRight
-		bottomLeft,
-		Vector2(bottomLeft.x, topRight.y) //topLeft
-	};
-
-	//First, clamp both points in caps to aabb and check if theyre close enough
-	Vector2 aClamped = Vector2(Clamp(a.x, bottomLeft.x, topRight.x), Clamp(a.y, bottomLeft.y, topRight.y));
-	Vector2 bClamped = Vector2(Clamp(b.x, bottomLeft.x, topRight.x), Clamp(b.y, bottomLeft.y, topRight.y));
-	if ((aClamped - a).LengthSqr() <= m_radius * m_radius) return true;
-	if ((bClamped - b).LengthSqr() <= m_radius * m_radius) return true;
-	//Then if none are close enough check if capsule line collides with aabb axis, and then check distance against points clamped in segment and in aabb
-	//First check line is not parallel to y or x axis
-	decimal segmentXMin, segmentXMax, segmentYMin, segmentYMax;
-	if (a.x <= b.x)
-	{
-		segmentXMin = a.x;
-		segmentXMax = b.x;
-	}
-	else
-	{
-		segmentXMin = b.x;
-		segmentXMax = a.x;
-	}
-	if (a.y <= b.y)
-	{
-		segmentYMin = a.y;
-		segmentYMax = b.y;
-	}
-	else
-	{
-		segmentYMin = b.y;
-		segmentYMax = a.y;
-	}
-
-	if (m == 0) {
-		//Completely horizontal line segment
-		//Find points when it collides with the x min and max of the aabb
-		//Clamp those to the line segment, and to the aabb, and compare
-
-		decimal y = a.y;
-		decimal x = bottomLeft.x;
-		decimal x2 = topRight.x;
-		decimal boxClampY = Clamp(y, bottomLeft.y, topRight.y);
-		Vector2 boxClamp1 = Vector2(bottomLeft.x, boxClampY);
-		Vector2 boxClamp2 = Vector2(topRight.x, boxClampY);
-
-		Vector2 segmentClamp1 = Vector2(Clamp(x, segmentXMin, segmentXMax), y);
-		Vector2 segmentClamp2 = Vector2(Clamp(x2, segmentXMin, segmentXMax), y);
-		
-		//Check distances of segment clamps against box clamps
-		if ((segmentClamp1 - boxClamp1).LengthSqr() <= m_radius * m_radius) return true;
-		if ((segmentClamp1 - boxClamp2).LengthSqr() <= m_radius * m_radius) return true;
-		if ((segmentClamp2 - boxClamp1).LengthSqr() <= m_radius * m_radius) return true;
-		if ((segmentClamp2 - boxClamp2).LengthSqr() <= m_radius * m_radius) return true;
-	}
-	else if (m == FLT_MAX) 
-	{
-		//Completely vertical line segment
-		//Find points when it collides with the y min and max of the aabb
-		//Clamp those to the line segment, and to the aabb, and compare
-
-		decimal x = a.x;
-		decimal y = bottomLeft.y;
-		decimal y2 = topRight.y;
-		decimal boxClampX = Clamp(x, bottomLeft.x, topRight.x);
-		Vector2 boxClamp1 = Vector2(boxClampX, bottomLeft.y);
-		Vector2 boxClamp2 = Vector2(boxClampX, topRight.y);
-
-		Vector2 segmentClamp1 = Vector2(x, Clamp(y, segmentYMin, segmentYMax));
-		Vector2 segmentClamp2 = Vector2(x, Clamp(y2, segmentYMin, segmentYMax));
-
-		//Check distances of segment clamps against box clamps
-		if ((segmentClamp1 - boxClamp1).LengthSqr() <= m_radius * m_radius) return true;
-		if ((segmentClamp1 - boxClamp2).LengthSqr() <= m_radius * m_radius) return true;
-		if ((segmentClamp2 - boxClamp1).LengthSqr() <= m_radius * m_radius) return true;
-		if ((segmentClamp2 - boxClamp2).LengthSqr() <= m_radius * m_radius) return true;
-	}
-	else
+	//SAT on the box axii and the segment normal, these are exact unless the closest features are a box corner and a cap
+	decimal overlapX = extents.x + halfLength * Abs(u.x) - Abs(p.x);
+	decimal overlapY = extents.y + halfLength * Abs(u.y) - Abs(p.y);
+	decimal overlapN = extents.x * Abs(n.x) + extents.y * Abs(n.y) - Abs(n.Dot(p));
+	if (Min(Min(overlapX, overlapY), overlapN) < -m_radius) return false;
+	if (Min(Min(overlapX, overlapY), overlapN) >= 0) return true;//Segment crosses the box
+	//Near a corner, closest distance is between a cap and the box or a corner and the segment
+	Vector2 a = p - u * halfLength;
+	Vector2 b = p + u * halfLength;
+	Vector2 aOut = a - Vector2(Clamp(a.x, -extents.x, extents.x), Clamp(a.y, -extents.y, extents.y));
+	Vector2 bOut = b - Vector2(Clamp(b.x, -extents.x, extents.x), Clamp(b.y, -extents.y, extents.y));
+	decimal minDistSqr = Min(aOut.LengthSqr(), bOut.LengthSqr());
+	Vector2 corners[4] = { extents, Vector2(extents.x, -extents.y), -extents, Vector2(-extents.x, extents.y) };
+	for (int i = 0; i < 4; i++)
 	{
-		//Use equation of line to solve for x == xmin || xmax and || y == ymin || ymax
-		//We know it collides with all aabb axis as its not parallel to none
-		//Line with box x axis 1
-		Vector2 lineX1 = Vector2(bottomLeft.x, m * bottomLeft.x + c);
-		Vector2 lineX2 = Vector2(topRight.x, m * topRight.x + c);
-
-		Vector2 lineY1 = Vector2((bottomLeft.y - c) / m, bottomLeft.y);
-		Vector2 lineY2 = Vector2((topRight.y - c) / m, topRight.y);
-
-		Vector2 boxClamp1 = Vector2(bottomLeft.x, Clamp(lineX1.y, bottomLeft.y, topRight.y));
-		Vector2 segmentClamp1 = Vector2(Clamp(lineX1.x, segmentXMin, segmentXMax), Clamp(lineX1.y, segmentYMin, segmentYMax));
-		if ((boxClamp1 - segmentClamp1).LengthSqr() <= m_radius * m_radius) return true;
-
-		Vector2 boxClamp2 = Vector2(topRight.x, Clamp(lineX2.y, bottomLeft.x, topRight.y));
-		Vector2 segmentClamp2 = Vector2(Clamp(lineX2.x, segmentXMin, segmentXMax), Clamp(lineX2.y, segmentYMin, segmentYMax));
-		if ((boxClamp2 - segmentClamp2).LengthSqr() <= m_radius * m_radius) return true;
-
-		Vector2 boxClamp3 = Vector2(Clamp(lineY1.x, bottomLeft.x, topRight.x), bottomLeft.y);
-		Vector2 segmentClamp3 = Vector2(Clamp(lineY1.x, segmentXMin, segmentXMax), Clamp(lineY1.y, segmentYMin, segmentYMax));
-		if ((boxClamp3 - segmentClamp3).LengthSqr() <= m_radius * m_radius) return true;
-
-		Vector2 boxClamp4 = Vector2(Clamp(lineY2.x, bottomLeft.x, topRight.x), topRight.y);
-		Vector2 segmentClamp4 = Vector2(Clamp(lineY2.x, segmentXMin, segmentXMax), Clamp(lineY2.y, segmentYMin, segmentYMax));
-		if ((boxClamp4 - segmentClamp4).LengthSqr() <= m_radius * m_radius) return true;
+		Vector2 toCorner = corners[i] - p;
+		Vector2 closest = u * Clamp(u.Dot(toCorner), -halfLength, halfLength);
+		minDistSqr = Min(minDistSqr, (toCorner - closest).LengthSqr());
 	}
-	//#UNIT TEST THIS STUFF
-	return false;
+	return minDistSqr <= m_radius * m_radius;
 }
 
-bool Capsule::IntersectWith(Rigidbody* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(Rigidbody* rb2, Manifold& manifold)
 {
 	return rb2->IntersectWith(this, manifold);
 }
 
-bool Capsule::IntersectWith(Circle* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(Circle* rb2, Manifold& manifold)
 {
 	return rb2->IntersectWith(this, manifold);//Forward to solution in circle
 }
 
-bool Capsule::IntersectWith(Capsule* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(Capsule* rb2, Manifold& manifold)
 {
 	//Get Capsule's AB
 	decimal halfLength = m_length / 2;
@@ -180,10 +87,10 @@ bool Capsule::IntersectWith(Capsule* rb2, Manifold& manifold)
 	Vector2 c = Vector2{ -halfLength2, 0 };
 	Vector2 d = Vector2{ halfLength2 , 0 };
 	//Rotate about position
-	a.Rotate(m_rotation);
-	b.Rotate(m_rotation);
-	c.Rotate(rb2->m_rotation);
-	d.Rotate(rb2->m_rotation);
+	a.Rotate(m_rotationMatrix);
+	b.Rotate(m_rotationMatrix);
+	c.Rotate(rb2->m_rotationMatrix);
+	d.Rotate(rb2->m_rotationMatrix);
 	a += m_position;
 	b += m_position;
 	c += rb2->m_position;
@@ -242,7 +149,8 @@ bool Capsule::IntersectWith(Capsule* rb2, Manifold& manifold)
 	else return false;
 }
 
-bool Capsule::IntersectWith(OrientedBox* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 {
 	//Haven't done this one before, probably ClosestPtObbToSegment query
 	///#Randy Gaul: 
@@ -261,20 +169,14 @@ bool Capsule::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 
 	//Get Capsule's AB
 	decimal halfLength = m_length / 2;
-	Vector2 a = m_position + Vector2( -halfLength, 0 ).Rotate(m_rotation);
-	Vector2 b = m_position + Vector2( halfLength, 0 ).Rotate(m_rotation);
+	Vector2 a = m_position + Vector2( -halfLength, 0 ).Rotate(m_rotationMatrix);
+	Vector2 b = m_position + Vector2( halfLength, 0 ).Rotate(m_rotationMatrix);
 
-	Vector2 rotExtents = rb2->m_halfExtents.Rotated(rb2->m_rotation);
-	//Caps points are now in box's local space
-	Vector2 boxPoints[4] = {
-		rb2->m_position + rotExtents,
-		rb2->m_position + rotExtents.Perp(),
-		rb2->m_position - rotExtents,
-		rb2->m_position - rotExtents.Perp()
-	};
+	Vector2 boxPoints[4];
+	rb2->GetCorners(boxPoints);
 	
 	decimal biggestPen = 0;
-	for (int i = 0; i < 3; i++) {
+	for (int i = 0; i < 4; i++) {
 		//Generate box segment and do like Caps-Caps query
 		Vector2 c = boxPoints[i];
 		Vector2 d = boxPoints[(i < 3) ? i + 1 : 0];
@@ -328,22 +230,62 @@ bool Capsule::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 	return false;
 }
 
-decimal Capsule::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(ConvexPolygon* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+bool BasicCapsule<T>::IntersectWith(Compound* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+T BasicCapsule<T>::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
 {
 	return rb2->SweepWith(this, dt, manifold);
 }
 
-decimal Capsule::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicCapsule<T>::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
 
-decimal Capsule::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicCapsule<T>::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
 
-decimal Capsule::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicCapsule<T>::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
+
+template <typename T>
+T BasicCapsule<T>::SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicCapsule<T>::SweepWith(Compound* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+void BasicCapsule<T>::ComputeAabb(Vector2& topRight, Vector2& bottomLeft)
+{
+	decimal halfLength = m_length / 2;
+	Vector2 extents = Vector2(Abs(m_rotationMatrix.c) * halfLength + m_radius, Abs(m_rotationMatrix.s) * halfLength + m_radius);
+	topRight = m_position + extents;
+	bottomLeft = m_position - extents;
+}
+
+template class BasicCapsule<float>;
+template class BasicCapsule<fp64::Fp64>;
@@ -3,23 +3,33 @@
 #include "Rigidbody.h"
 #include "PipMath.h"
 
-class Capsule :
-	public Rigidbody
+template <typename T>
+class BasicCapsule :
+	public BasicRigidbody<T>
 {
 public:
-	Capsule(decimal length = 1.0f, decimal radius = 1.0f, PipMath::Vector2 pos = PipMath::Vector2(), decimal rot = 0.0f,
-	 PipMath::Vector2 vel = PipMath::Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
-	~Capsule();
-	virtual bool IntersectWith(PipMath::Vector2 topRight, PipMath::Vector2 bottomLeft) override;
-	virtual bool IntersectWith(Rigidbody* rb2, PipMath::Manifold& manifold) override;
-	virtual bool IntersectWith(Circle* rb2, PipMath::Manifold& manifold) override;
-	virtual bool IntersectWith(Capsule* rb2, PipMath::Manifold& manifold) override;
-	virtual bool IntersectWith(OrientedBox* rb2, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(Circle* rb2, decimal dt, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(Capsule* rb2, decimal dt, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, PipMath::Manifold& manifold) override;
+	PIP_SCALAR_TYPES(T)
+	PIP_RIGIDBODY_MEMBERS
+
+	BasicCapsule(decimal length = 1.0f, decimal radius = 1.0f, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	~BasicCapsule();
+	virtual bool IntersectWith(Vector2 topRight, Vector2 bottomLeft) override;
+	virtual bool IntersectWith(Rigidbody* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Circle* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Capsule* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(OrientedBox* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(ConvexPolygon* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Compound* rb2, Manifold& manifold) override;
+	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Circle* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Capsule* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Compound* rb2, decimal dt, Manifold& manifold) override;
+	virtual void ComputeAabb(Vector2& topRight, Vector2& bottomLeft) override;
 
 	decimal m_length;
 	decimal m_radius;
 };
+typedef BasicCapsule<decimal> Capsule;
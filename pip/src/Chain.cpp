@@ -0,0 +1,95 @@
+#include "Chain.h"
+
+#include <algorithm>
+
+using namespace PipMath;
+
+template <typename T>
+BasicChain<T>::BasicChain(const Vector2* vertices, size_t vertexCount, bool loop, decimal thickness, decimal e)
+	: m_vertices(vertices, vertices + vertexCount), m_loop(loop)
+{
+	m_shapeType = StaticShapeType::Chain;
+	size_t segmentCount = (vertexCount < 2) ? 0 : (loop ? vertexCount : vertexCount - 1);
+	m_segments.reserve(segmentCount);
+	for (size_t i = 0; i < segmentCount; i++)
+	{
+		Vector2 a = vertices[i];
+		Vector2 b = vertices[(i + 1 < vertexCount) ? i + 1 : 0];
+		Vector2 ab = b - a;
+		m_segments.push_back(OrientedBox(Vector2(ab.Length() / 2, thickness / 2), a + ab / 2, Atan2(ab.y, ab.x), Vector2(), 0.f, 1.f, e,
+		 true));
+	}
+	if (segmentCount) BuildNode(0, segmentCount);
+}
+
+template <typename T>
+BasicChain<T>::~BasicChain()
+{
+}
+
+template <typename T>
+size_t BasicChain<T>::BuildNode(size_t first, size_t count)
+{
+	size_t nodeIdx = m_nodes.size();
+	m_nodes.push_back(ChainNode());
+	Vector2 topRight, bottomLeft;
+	m_segments[first].ComputeAabb(topRight, bottomLeft);
+	for (size_t i = first + 1; i < first + count; i++)
+	{
+		Vector2 segmentTopRight, segmentBottomLeft;
+		m_segments[i].ComputeAabb(segmentTopRight, segmentBottomLeft);
+		topRight = Vector2(Max(topRight.x, segmentTopRight.x), Max(topRight.y, segmentTopRight.y));
+		bottomLeft = Vector2(Min(bottomLeft.x, segmentBottomLeft.x), Min(bottomLeft.y, segmentBottomLeft.y));
+	}
+	m_nodes[nodeIdx].topRight = topRight;
+	m_nodes[nodeIdx].bottomLeft = bottomLeft;
+	m_nodes[nodeIdx].first = first;
+	m_nodes[nodeIdx].count = count;
+	m_nodes[nodeIdx].rightChild = 0;
+	if (count <= CHAIN_LEAF_SEGMENTS) return nodeIdx;
+
+	//Median split of segment centres along the node's longest side
+	bool splitX = (topRight.x - bottomLeft.x) >= (topRight.y - bottomLeft.y);
+	size_t half = count / 2;
+	std::nth_element(m_segments.begin() + first, m_segments.begin() + first + half, m_segments.begin() + first + count,
+		[splitX](const OrientedBox& a, const OrientedBox& b) { return splitX ? a.m_position.x < b.m_position.x : a.m_position.y < b.m_position.y; });
+	BuildNode(first, half);
+	size_t rightChild = BuildNode(first + half, count - half);
+	m_nodes[nodeIdx].rightChild = rightChild;
+	return nodeIdx;
+}
+
+template <typename T>
+void BasicChain<T>::Query(Vector2 topRight, Vector2 bottomLeft, std::vector<OrientedBox*>& segments)
+{
+	if (m_nodes.empty()) return;
+	size_t stack[64];
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize)
+	{
+		const ChainNode& node = m_nodes[stack[--stackSize]];
+		if (node.bottomLeft.x > topRight.x || node.topRight.x < bottomLeft.x || node.bottomLeft.y > topRight.y || node.topRight.y < bottomLeft.y)
+		{
+			continue;
+		}
+		if (!node.rightChild)
+		{
+			for (size_t i = node.first; i < node.first + node.count; i++) segments.push_back(&m_segments[i]);
+			continue;
+		}
+		//Median splits keep depth at log2 of the segment count, far below the stack size
+		stack[stackSize++] = node.rightChild;
+		stack[stackSize++] = (size_t)(&node - m_nodes.data()) + 1;
+	}
+}
+
+template <typename T>
+size_t BasicChain<T>::GetByteSize()
+{
+	return sizeof(*this) + m_segments.capacity() * sizeof(OrientedBox) + m_vertices.capacity() * sizeof(Vector2)
+	 + m_nodes.capacity() * sizeof(ChainNode);
+}
+
+template class BasicChain<float>;
+template class BasicChain<fp64::Fp64>;
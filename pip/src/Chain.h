@@ -0,0 +1,38 @@
+#pragma once
+
+#include "StaticShape.h"
+
+#define CHAIN_LEAF_SEGMENTS 4
+
+//Static polyline. Segments are thin boxes centred on the line, kept in a BVH built once at creation
+template <typename T>
+class BasicChain :
+	public BasicStaticShape<T>
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	using BasicStaticShape<T>::m_shapeType;
+	using BasicStaticShape<T>::m_segments;
+
+	//Flattened preorder, left child follows its parent. Leaves own m_segments[first, first + count)
+	struct ChainNode
+	{
+		Vector2 topRight;
+		Vector2 bottomLeft;
+		size_t first;
+		size_t count;
+		size_t rightChild;//0 on leaves
+	};
+
+	BasicChain(const Vector2* vertices, size_t vertexCount, bool loop = false, decimal thickness = 0.1f, decimal e = 1.f);
+	~BasicChain();
+	virtual void Query(Vector2 topRight, Vector2 bottomLeft, std::vector<OrientedBox*>& segments) override;
+	virtual size_t GetByteSize() override;
+private:
+	size_t BuildNode(size_t first, size_t count);//RECURSIVE, returns node idx
+public:
+	std::vector<Vector2> m_vertices;
+	bool m_loop;
+	std::vector<ChainNode> m_nodes;
+};
+typedef BasicChain<decimal> Chain;
@@ -2,40 +2,48 @@
 
 #include "Capsule.h"
 #include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
 
 //https://en.wikipedia.org/wiki/List_of_moments_of_inertia
 
 using namespace PipMath;
 
-Circle::Circle(decimal rad, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass,  decimal e, bool isKinematic)
+template <typename T>
+BasicCircle<T>::BasicCircle(decimal rad, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass,  decimal e, bool isKinematic)
 	: m_radius(rad), Rigidbody(pos, rot, vel, angVel, mass, e, isKinematic)
 {
 	m_bodyType = BodyType::Circle;
 	m_inertia = m_mass * m_radius * m_radius / 2;//mr^2/2
 }
 
-Circle::~Circle()
+template <typename T>
+BasicCircle<T>::~BasicCircle()
 {
 }
 //Intersect with AABB for Quad Nodes
-bool Circle::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
+template <typename T>
+bool BasicCircle<T>::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
 {
 	//Clamp Circle point to aabb bounds, compare sqdist to clamped point against sqRad
 	Vector2 clampedPos = Vector2(Clamp(m_position.x, bottomLeft.x, topRight.x), Clamp(m_position.y, bottomLeft.y, topRight.y));
 	return (m_radius*m_radius >= (m_position - clampedPos).LengthSqr());
 }
 
-bool Circle::IntersectWith(Rigidbody* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCircle<T>::IntersectWith(Rigidbody* rb2, Manifold& manifold)
 {
 	return rb2->IntersectWith(this, manifold);
 }
 
-bool Circle::IntersectWith(Circle* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCircle<T>::IntersectWith(Circle* rb2, Manifold& manifold)
 {
 	Vector2 ab = rb2->m_position - m_position;
-	if (ab.LengthSqr() <= Pow((m_radius + rb2->m_radius), 2)) {
+	decimal rab = m_radius + rb2->m_radius;
+	if (ab.LengthSqr() <= rab * rab) {
 		//Manifold
-		manifold.penetration = m_radius + rb2->m_radius - ab.Length();
+		manifold.penetration = rab - ab.Length();
 		manifold.normal = -ab.Normalize();//Point to A by convention
 		Vector2 circle1Edge = m_position + ab * m_radius;
 		Vector2 circle2Edge = rb2->m_position - ab * rb2->m_radius;
@@ -48,15 +56,16 @@ bool Circle::IntersectWith(Circle* rb2, Manifold& manifold)
 	return false;
 }
 
-bool Circle::IntersectWith(Capsule* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCircle<T>::IntersectWith(Capsule* rb2, Manifold& manifold)
 {
 	//Get Capsule's AB
 	decimal halfLength = rb2->m_length / 2;
 	Vector2 a = Vector2{ -halfLength, 0 };
 	Vector2 b = Vector2{ halfLength, 0 };
 	//Rotate about position
-	a.Rotate(rb2->m_rotation);
-	b.Rotate(rb2->m_rotation);
+	a.Rotate(rb2->m_rotationMatrix);
+	b.Rotate(rb2->m_rotationMatrix);
 	a += rb2->m_position;
 	b += rb2->m_position;
 	Vector2 c = m_position;
@@ -79,17 +88,33 @@ bool Circle::IntersectWith(Capsule* rb2, Manifold& manifold)
 	return false;
 }
 
-bool Circle::IntersectWith(OrientedBox* rb2, Manifold& manifold)
+template <typename T>
+bool BasicCircle<T>::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 {
 	//ClosestPtToObb query
 	//Set world origin to be box's center, unrotate all, clamp pt to AABB. Rotate point with box and move it to its pos.
 	Vector2 p = m_position - rb2->m_position;
 	//Consider the box unrotated, and rotate this p by inverse box's rotation
-	p.Rotate(-rb2->m_rotation);
+	p.InvRotate(rb2->m_rotationMatrix);
+	if (Abs(p.x) <= rb2->m_halfExtents.x && Abs(p.y) <= rb2->m_halfExtents.y)
+	{
+		//Centre inside the box, clamping gives no direction: push out through the closest face
+		decimal dx = rb2->m_halfExtents.x - Abs(p.x);
+		decimal dy = rb2->m_halfExtents.y - Abs(p.y);
+		Vector2 faceNormal = (dx < dy) ? Vector2(p.x < 0 ? -1 : 1, 0) : Vector2(0, p.y < 0 ? -1 : 1);
+		Vector2 facePoint = (dx < dy) ? Vector2(faceNormal.x * rb2->m_halfExtents.x, p.y) : Vector2(p.x, faceNormal.y * rb2->m_halfExtents.y);
+		manifold.penetration = m_radius + ((dx < dy) ? dx : dy);
+		manifold.normal = faceNormal.Rotate(rb2->m_rotationMatrix);//Point to A by convention
+		manifold.numContactPoints = 1;
+		manifold.contactPoints[0] = facePoint.Rotate(rb2->m_rotationMatrix) + rb2->m_position;
+		manifold.rb1 = this;
+		manifold.rb2 = rb2;
+		return true;
+	}
 	p.x = Clamp(p.x, -rb2->m_halfExtents.x, rb2->m_halfExtents.x);
 	p.y = Clamp(p.y, -rb2->m_halfExtents.y, rb2->m_halfExtents.y);
 	//Rotate point back to world space, then translate it
-	p.Rotate(rb2->m_rotation);
+	p.Rotate(rb2->m_rotationMatrix);
 	p += rb2->m_position;
 	//p is closest point from sphere to Obb
 	//Get manifold info
@@ -108,12 +133,26 @@ bool Circle::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 	return false;
 }
 
-decimal Circle::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+bool BasicCircle<T>::IntersectWith(ConvexPolygon* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+bool BasicCircle<T>::IntersectWith(Compound* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+T BasicCircle<T>::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
 {
 	return rb2->SweepWith(this, dt, manifold);
 }
 
-decimal Circle::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicCircle<T>::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
 {
 	//https://www.gamasutra.com/view/feature/131790/simple_intersection_tests_for_games.php?page=2
 	//A = A0 + U*VA
@@ -159,12 +198,36 @@ decimal Circle::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
 	}
 }
 
-decimal Circle::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicCircle<T>::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
 
-decimal Circle::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicCircle<T>::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
+
+template <typename T>
+T BasicCircle<T>::SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicCircle<T>::SweepWith(Compound* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+void BasicCircle<T>::ComputeAabb(Vector2& topRight, Vector2& bottomLeft)
+{
+	topRight = m_position + Vector2(m_radius, m_radius);
+	bottomLeft = m_position - Vector2(m_radius, m_radius);
+}
+
+template class BasicCircle<float>;
+template class BasicCircle<fp64::Fp64>;
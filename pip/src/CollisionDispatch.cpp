@@ -0,0 +1,165 @@
+#include "CollisionDispatch.h"
+
+#include "Circle.h"
+#include "Capsule.h"
+#include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
+
+using namespace PipMath;
+
+//Qualified calls, the compiler binds them statically
+template <typename BodyA, typename BodyB>
+static bool IntersectCanonical(typename BodyA::Rigidbody* rb1, typename BodyA::Rigidbody* rb2, typename BodyA::Manifold& manifold)
+{
+	return static_cast<BodyA*>(rb1)->BodyA::IntersectWith(static_cast<BodyB*>(rb2), manifold);
+}
+
+//rb2 owns the test. Same type pairs also land here to keep the manifold order the visitor produced
+template <typename BodyA, typename BodyB>
+static bool IntersectMirrored(typename BodyA::Rigidbody* rb1, typename BodyA::Rigidbody* rb2, typename BodyA::Manifold& manifold)
+{
+	return static_cast<BodyB*>(rb2)->BodyB::IntersectWith(static_cast<BodyA*>(rb1), manifold);
+}
+
+//Rows are rb1's BodyType, columns rb2's. Polygon pairs all run in ConvexPolygon and compound
+//pairs in Compound, whichever side they're on
+template <typename T>
+const IntersectFunction<T> IntersectTable<T>::s_functions[BODY_TYPE_COUNT][BODY_TYPE_COUNT] =
+{
+	{ IntersectMirrored<BasicCircle<T>, BasicCircle<T>>, IntersectCanonical<BasicCircle<T>, BasicCapsule<T>>,
+	 IntersectCanonical<BasicCircle<T>, BasicOrientedBox<T>>, IntersectMirrored<BasicCircle<T>, BasicConvexPolygon<T>>,
+	 IntersectMirrored<BasicCircle<T>, BasicCompound<T>> },
+	{ IntersectMirrored<BasicCapsule<T>, BasicCircle<T>>, IntersectMirrored<BasicCapsule<T>, BasicCapsule<T>>,
+	 IntersectCanonical<BasicCapsule<T>, BasicOrientedBox<T>>, IntersectMirrored<BasicCapsule<T>, BasicConvexPolygon<T>>,
+	 IntersectMirrored<BasicCapsule<T>, BasicCompound<T>> },
+	{ IntersectMirrored<BasicOrientedBox<T>, BasicCircle<T>>, IntersectMirrored<BasicOrientedBox<T>, BasicCapsule<T>>,
+	 IntersectMirrored<BasicOrientedBox<T>, BasicOrientedBox<T>>, IntersectMirrored<BasicOrientedBox<T>, BasicConvexPolygon<T>>,
+	 IntersectMirrored<BasicOrientedBox<T>, BasicCompound<T>> },
+	{ IntersectCanonical<BasicConvexPolygon<T>, BasicCircle<T>>, IntersectCanonical<BasicConvexPolygon<T>, BasicCapsule<T>>,
+	 IntersectCanonical<BasicConvexPolygon<T>, BasicOrientedBox<T>>, IntersectMirrored<BasicConvexPolygon<T>, BasicConvexPolygon<T>>,
+	 IntersectMirrored<BasicConvexPolygon<T>, BasicCompound<T>> },
+	{ IntersectCanonical<BasicCompound<T>, BasicCircle<T>>, IntersectCanonical<BasicCompound<T>, BasicCapsule<T>>,
+	 IntersectCanonical<BasicCompound<T>, BasicOrientedBox<T>>, IntersectCanonical<BasicCompound<T>, BasicConvexPolygon<T>>,
+	 IntersectMirrored<BasicCompound<T>, BasicCompound<T>> }
+};
+
+//Convex core of a body: a point, a segment or a polygon that the shape covers once grown by radius
+template <typename T>
+static int GetCore(BasicRigidbody<T>* rb, BasicVector2<T>* points, T& radius)
+{
+	radius = 0;
+	switch (rb->m_bodyType)
+	{
+	case BodyType::Circle:
+	{
+		points[0] = rb->m_position;
+		radius = static_cast<BasicCircle<T>*>(rb)->m_radius;
+		return 1;
+	}
+	case BodyType::Capsule:
+	{
+		BasicCapsule<T>* capsule = static_cast<BasicCapsule<T>*>(rb);
+		BasicVector2<T> halfAxis = BasicVector2<T>(capsule->m_length / 2, 0).Rotate(capsule->m_rotationMatrix);
+		points[0] = capsule->m_position - halfAxis;
+		points[1] = capsule->m_position + halfAxis;
+		radius = capsule->m_radius;
+		return 2;
+	}
+	case BodyType::Obb:
+	{
+		static_cast<BasicOrientedBox<T>*>(rb)->GetCorners(points);
+		return 4;
+	}
+	case BodyType::Polygon:
+	{
+		BasicConvexPolygon<T>* polygon = static_cast<BasicConvexPolygon<T>*>(rb);
+		BasicVector2<T> normals[POLYGON_MAX_VERTICES];
+		polygon->GetWorldVertices(points, normals);
+		return polygon->m_vertexCount;
+	}
+	default:
+		return 0;
+	}
+}
+
+//Closest points of two disjoint convex cores, always a vertex of one against an edge of the other. Returns the squared distance
+template <typename T>
+static T ClosestCorePoints(const BasicVector2<T>* core1, int count1, const BasicVector2<T>* core2, int count2, BasicVector2<T>& point1,
+ BasicVector2<T>& point2)
+{
+	T minDistSqr = -1;
+	for (int i = 0; i < count1; i++)
+	{
+		for (int j = 0; j < count2; j++)
+		{
+			//Vertex i of core1 against edge j of core2, then vertex j of core2 against edge i of core1
+			BasicVector2<T> onEdge = ClosestPtToSegment(core2[j], core2[(j + 1 < count2) ? j + 1 : 0], core1[i]);
+			T distSqr = (core1[i] - onEdge).LengthSqr();
+			if (minDistSqr < 0 || distSqr < minDistSqr)
+			{
+				minDistSqr = distSqr;
+				point1 = core1[i];
+				point2 = onEdge;
+			}
+			onEdge = ClosestPtToSegment(core1[i], core1[(i + 1 < count1) ? i + 1 : 0], core2[j]);
+			distSqr = (core2[j] - onEdge).LengthSqr();
+			if (distSqr < minDistSqr)
+			{
+				minDistSqr = distSqr;
+				point1 = onEdge;
+				point2 = core2[j];
+			}
+		}
+	}
+	return minDistSqr;
+}
+
+template <typename T>
+bool SpeculativePair(BasicRigidbody<T>* rb1, BasicRigidbody<T>* rb2, T maxDistance, BasicManifold<T>& manifold)
+{
+	typedef BasicVector2<T> Vector2;
+	if (rb1->m_bodyType == BodyType::Compound || rb2->m_bodyType == BodyType::Compound)
+	{
+		//Closest child stands in for the compound, same as its intersect tests
+		bool compoundFirst = rb1->m_bodyType == BodyType::Compound;
+		BasicCompound<T>* compound = static_cast<BasicCompound<T>*>(compoundFirst ? rb1 : rb2);
+		BasicRigidbody<T>* other = compoundFirst ? rb2 : rb1;
+		compound->UpdateChildren();
+		bool found = false;
+		for (int i = 0; i < compound->m_childCount; i++)
+		{
+			BasicManifold<T> childManifold;
+			if (!SpeculativePair(compound->GetChild(i), other, maxDistance, childManifold)) continue;
+			if (found && childManifold.penetration <= manifold.penetration) continue;
+			manifold = childManifold;
+			found = true;
+		}
+		if (!found) return false;
+		if (!compoundFirst) manifold.normal = -manifold.normal;
+		manifold.rb1 = rb1;
+		manifold.rb2 = rb2;
+		return true;
+	}
+	Vector2 core1[POLYGON_MAX_VERTICES], core2[POLYGON_MAX_VERTICES];
+	T radius1, radius2;
+	int count1 = GetCore(rb1, core1, radius1);
+	int count2 = GetCore(rb2, core2, radius2);
+	Vector2 point1, point2;
+	T distance = Sqrt(ClosestCorePoints(core1, count1, core2, count2, point1, point2));
+	if (distance <= (T)FLT_EPSILON_TESTS || distance - radius1 - radius2 > maxDistance) return false;//Touching cores are the intersect tests' job
+	Vector2 normal = (point1 - point2) / distance;
+	manifold.normal = normal;//Point to A by convention
+	manifold.penetration = radius1 + radius2 - distance;
+	manifold.numContactPoints = 1;
+	manifold.contactPoints[0] = (point1 - normal * radius1 + point2 + normal * radius2) / 2;
+	manifold.rb1 = rb1;
+	manifold.rb2 = rb2;
+	return true;
+}
+
+template struct IntersectTable<float>;
+template struct IntersectTable<fp64::Fp64>;
+template bool SpeculativePair(BasicRigidbody<float>* rb1, BasicRigidbody<float>* rb2, float maxDistance, BasicManifold<float>& manifold);
+template bool SpeculativePair(BasicRigidbody<fp64::Fp64>* rb1, BasicRigidbody<fp64::Fp64>* rb2, fp64::Fp64 maxDistance,
+ BasicManifold<fp64::Fp64>& manifold);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "PipMath.h"
+#include "Rigidbody.h"
+
+#define BODY_TYPE_COUNT 5
+
+//Narrowphase test for one pair of concrete body types, rb1 and rb2 are expected to match the table slot
+template <typename T>
+using IntersectFunction = bool (*)(BasicRigidbody<T>* rb1, BasicRigidbody<T>* rb2, PipMath::BasicManifold<T>& manifold);
+
+//BodyType x BodyType, calls the concrete test directly with the lower BodyType as 'this' (same as the visitor ended up doing)
+//One table per scalar type, defined for float and fp64::Fp64
+template <typename T>
+struct IntersectTable
+{
+	static const IntersectFunction<T> s_functions[BODY_TYPE_COUNT][BODY_TYPE_COUNT];
+};
+
+template <typename T = decimal>
+inline IntersectFunction<T> GetIntersectFunction(BodyType type1, BodyType type2)
+{
+	return IntersectTable<T>::s_functions[(int)type1][(int)type2];
+}
+
+//Replaces rb1->IntersectWith(rb2, manifold): one table load instead of two to three virtual calls
+template <typename T>
+inline bool IntersectPair(BasicRigidbody<T>* rb1, BasicRigidbody<T>* rb2, PipMath::BasicManifold<T>& manifold)
+{
+	return IntersectTable<T>::s_functions[(int)rb1->m_bodyType][(int)rb2->m_bodyType](rb1, rb2, manifold);
+}
+
+//Gap between two bodies that don't overlap, as a single contact manifold with negative penetration if they're within
+//maxDistance of each other. Normal points to rb1 like IntersectPair. Compounds report their closest child
+template <typename T>
+bool SpeculativePair(BasicRigidbody<T>* rb1, BasicRigidbody<T>* rb2, T maxDistance, PipMath::BasicManifold<T>& manifold);
@@ -0,0 +1,260 @@
+#include "Compound.h"
+
+#include "ConvexPolygon.h"
+#include "CollisionDispatch.h"
+#include "Solver.h"
+
+using namespace PipMath;
+
+template <typename T>
+BasicCompound<T>::BasicCompound(const BodyDesc* children, size_t childCount, Vector2 pos, decimal rot, Vector2 vel, decimal angVel,
+ decimal mass, decimal e, bool isKinematic)
+	: m_childCount(0), m_placedRotation(0), m_childrenPlaced(false), Rigidbody(pos, rot, vel, angVel, mass, e, isKinematic)
+{
+	m_bodyType = BodyType::Compound;
+	m_inertia = 0;
+	if (!IsValid(children, childCount)) return;
+	m_childCount = (int)childCount;
+	//Children weigh by area, their centroid becomes the centre of mass
+	decimal areas[COMPOUND_MAX_CHILDREN];
+	decimal area = 0;
+	Vector2 centroid;
+	for (int i = 0; i < m_childCount; i++)
+	{
+		const BodyDesc& child = children[i];
+		areas[i] = GetChildArea(child);
+		area += areas[i];
+		centroid += child.position * areas[i];
+	}
+	centroid = centroid / area;
+	for (int i = 0; i < m_childCount; i++)
+	{
+		const BodyDesc& child = children[i];
+		m_childOffsets[i] = child.position - centroid;
+		m_childRotations[i] = child.rotation;
+		m_childRotationMatrices[i] = Mat2(child.rotation);
+		//Each proxy's inertia is about its own centre, parallel axis moves it to the compound's
+		decimal childMass = m_mass * areas[i] / area;
+		Rigidbody* proxy = nullptr;
+		switch (child.bodyType)
+		{
+		case BodyType::Circle:
+			proxy = new (&m_children[i]) Circle(child.radius, Vector2(), 0.f, Vector2(), 0.f, childMass, e, isKinematic);
+			break;
+		case BodyType::Capsule:
+			proxy = new (&m_children[i]) Capsule(child.length, child.radius, Vector2(), 0.f, Vector2(), 0.f, childMass, e, isKinematic);
+			break;
+		default:
+			proxy = new (&m_children[i]) OrientedBox(child.halfExtents, Vector2(), 0.f, Vector2(), 0.f, childMass, e, isKinematic);
+			break;
+		}
+		m_inertia += proxy->m_inertia + childMass * m_childOffsets[i].LengthSqr();
+	}
+	UpdateChildren();
+}
+
+template <typename T>
+BasicCompound<T>::~BasicCompound()
+{
+}
+//Intersect AABB for Quad Nodes, only leaves some child reaches
+template <typename T>
+bool BasicCompound<T>::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
+{
+	UpdateChildren();
+	for (int i = 0; i < m_childCount; i++)
+	{
+		if (GetChild(i)->IntersectWith(topRight, bottomLeft)) return true;
+	}
+	return false;
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectWith(Rigidbody* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectWith(Circle* rb2, Manifold& manifold)
+{
+	return IntersectChildren(rb2, manifold);
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectWith(Capsule* rb2, Manifold& manifold)
+{
+	return IntersectChildren(rb2, manifold);
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectWith(OrientedBox* rb2, Manifold& manifold)
+{
+	return IntersectChildren(rb2, manifold);
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectWith(ConvexPolygon* rb2, Manifold& manifold)
+{
+	return IntersectChildren(rb2, manifold);
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectWith(Compound* rb2, Manifold& manifold)
+{
+	//Each child against rb2 as a whole, rb2 splits it into its own children
+	return IntersectChildren(rb2, manifold);
+}
+
+template <typename T>
+bool BasicCompound<T>::IntersectChildren(Rigidbody* rb2, Manifold& manifold)
+{
+	Vector2 topRight, bottomLeft;
+	rb2->ComputeAabb(topRight, bottomLeft);
+	UpdateChildren();
+	Manifold childManifolds[COMPOUND_MAX_CHILDREN];
+	int hitCount = 0;
+	int deepest = 0;
+	for (int i = 0; i < m_childCount; i++)
+	{
+		Rigidbody* child = GetChild(i);
+		Vector2 childTopRight, childBottomLeft;
+		child->ComputeAabb(childTopRight, childBottomLeft);
+		if (childBottomLeft.x > topRight.x || childTopRight.x < bottomLeft.x || childBottomLeft.y > topRight.y || childTopRight.y < bottomLeft.y)
+		{
+			continue;
+		}
+		if (!IntersectPair(child, rb2, childManifolds[hitCount])) continue;
+		//Children stand in for this body, the response has to move the compound
+		if (IsChild(childManifolds[hitCount].rb1)) childManifolds[hitCount].rb1 = this;
+		else
+		{
+			childManifolds[hitCount].rb2 = childManifolds[hitCount].rb1;
+			childManifolds[hitCount].rb1 = this;
+			childManifolds[hitCount].normal = -childManifolds[hitCount].normal;//Still points to rb1
+		}
+		if (childManifolds[hitCount].penetration > childManifolds[deepest].penetration) deepest = hitCount;
+		hitCount++;
+	}
+	if (!hitCount) return false;
+	//One manifold per pair: the deepest child's, plus contacts of children pushed the same way while there's room
+	manifold = childManifolds[deepest];
+	for (int i = 0; i < hitCount && manifold.numContactPoints < 2; i++)
+	{
+		if (i == deepest || childManifolds[i].normal.Dot(manifold.normal) < (decimal)0.95f) continue;
+		manifold.contactPoints[manifold.numContactPoints++] = childManifolds[i].contactPoints[0];
+	}
+	return true;
+}
+
+template <typename T>
+T BasicCompound<T>::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
+{
+	return rb2->SweepWith(this, dt, manifold);
+}
+
+template <typename T>
+T BasicCompound<T>::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicCompound<T>::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicCompound<T>::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicCompound<T>::SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicCompound<T>::SweepWith(Compound* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+void BasicCompound<T>::ComputeAabb(Vector2& topRight, Vector2& bottomLeft)
+{
+	UpdateChildren();
+	topRight = bottomLeft = m_position;
+	for (int i = 0; i < m_childCount; i++)
+	{
+		Vector2 childTopRight, childBottomLeft;
+		GetChild(i)->ComputeAabb(childTopRight, childBottomLeft);
+		if (i == 0)
+		{
+			topRight = childTopRight;
+			bottomLeft = childBottomLeft;
+			continue;
+		}
+		topRight = Vector2(Max(topRight.x, childTopRight.x), Max(topRight.y, childTopRight.y));
+		bottomLeft = Vector2(Min(bottomLeft.x, childBottomLeft.x), Min(bottomLeft.y, childBottomLeft.y));
+	}
+}
+
+template <typename T>
+void BasicCompound<T>::UpdateChildren()
+{
+	if (m_childrenPlaced && m_position == m_placedPosition && m_rotation == m_placedRotation) return;
+	m_childrenPlaced = true;
+	m_placedPosition = m_position;
+	m_placedRotation = m_rotation;
+	for (int i = 0; i < m_childCount; i++)
+	{
+		Rigidbody* child = GetChild(i);
+		child->m_position = m_position + m_childOffsets[i].Rotated(m_rotationMatrix);
+		child->m_rotation = m_rotation + m_childRotations[i];
+		child->m_rotationMatrix = m_rotationMatrix * m_childRotationMatrices[i];
+	}
+}
+
+template <typename T>
+BasicRigidbody<T>* BasicCompound<T>::GetChild(int i)
+{
+	return (Rigidbody*)&m_children[i];
+}
+
+template <typename T>
+bool BasicCompound<T>::IsValid(const BodyDesc* children, size_t childCount)
+{
+	if (!children || childCount < 1 || childCount > COMPOUND_MAX_CHILDREN) return false;
+	for (size_t i = 0; i < childCount; i++)
+	{
+		BodyType bodyType = children[i].bodyType;
+		if (bodyType != BodyType::Circle && bodyType != BodyType::Capsule && bodyType != BodyType::Obb) return false;
+		//The constructor divides by the summed area, and a child with none would have no mass
+		if (!(GetChildArea(children[i]) > 0)) return false;
+	}
+	return true;
+}
+
+template <typename T>
+T BasicCompound<T>::GetChildArea(const BodyDesc& child)
+{
+	switch (child.bodyType)
+	{
+	case BodyType::Circle: return child.radius * child.radius * PI;
+	case BodyType::Capsule: return child.radius * child.radius * PI + child.length * child.radius * 2;
+	default: return child.halfExtents.x * child.halfExtents.y * 4;
+	}
+}
+
+template <typename T>
+bool BasicCompound<T>::IsChild(Rigidbody* rb)
+{
+	return (char*)rb >= (char*)&m_children[0] && (char*)rb < (char*)&m_children[COMPOUND_MAX_CHILDREN];
+}
+
+template class BasicCompound<float>;
+template class BasicCompound<fp64::Fp64>;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <type_traits>
+
+#include "Rigidbody.h"
+#include "Circle.h"
+#include "Capsule.h"
+#include "OrientedBox.h"
+
+#define COMPOUND_MAX_CHILDREN 4
+
+template <typename T> struct BasicBodyDesc;
+
+//Several Circle/Capsule/Obb shapes moving as one body. Children are proxies kept inside the body, placed from the body's
+//transform right before they're tested. The broadphase only sees the compound, pairs reach a child past a bounds check
+template <typename T>
+class BasicCompound :
+	public BasicRigidbody<T>
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	PIP_RIGIDBODY_MEMBERS
+	typedef BasicBodyDesc<T> BodyDesc;
+
+	//Child position and rotation are relative to pos, children get recentred on their centroid so pos ends up being the
+	//centre of mass. Mass is split between children by area
+	BasicCompound(const BodyDesc* children = nullptr, size_t childCount = 0, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	~BasicCompound();
+	virtual bool IntersectWith(Vector2 topRight, Vector2 bottomLeft) override;
+	virtual bool IntersectWith(Rigidbody* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Circle* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Capsule* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(OrientedBox* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(ConvexPolygon* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Compound* rb2, Manifold& manifold) override;
+	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Circle* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Capsule* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Compound* rb2, decimal dt, Manifold& manifold) override;
+	virtual void ComputeAabb(Vector2& topRight, Vector2& bottomLeft) override;
+	//Moves the child proxies to the body's current transform. Only writes when the body has moved since, the solver places
+	//children while integrating so its parallel phases only ever read them
+	void UpdateChildren();
+	Rigidbody* GetChild(int i);
+	static bool IsValid(const BodyDesc* children, size_t childCount);//1 to COMPOUND_MAX_CHILDREN Circle, Capsule or Obb, each with area
+private:
+	static decimal GetChildArea(const BodyDesc& child);//Children weigh by area
+	bool IntersectChildren(Rigidbody* rb2, Manifold& manifold);
+	bool IsChild(Rigidbody* rb);
+public:
+	typedef typename std::aligned_union<0, Circle, Capsule, OrientedBox>::type ChildStorage;
+
+	ChildStorage m_children[COMPOUND_MAX_CHILDREN];//Raw like the pool, bodies are copied around without constructors
+	Vector2 m_childOffsets[COMPOUND_MAX_CHILDREN];//From the centre of mass, body space
+	decimal m_childRotations[COMPOUND_MAX_CHILDREN];
+	Mat2 m_childRotationMatrices[COMPOUND_MAX_CHILDREN];
+	int m_childCount;
+	Vector2 m_placedPosition;//Transform the children were last placed from
+	decimal m_placedRotation;
+	bool m_childrenPlaced;
+};
+typedef BasicCompound<decimal> Compound;
@@ -0,0 +1,456 @@
+#include "ConvexPolygon.h"
+
+#include "Circle.h"
+#include "Capsule.h"
+#include "OrientedBox.h"
+#include "Compound.h"
+
+using namespace PipMath;
+
+//Deepest penetration of polygon2 through polygon1's faces, positive once a face separates them. Consecutive face normals
+//turn monotonically, so polygon2's support for face i starts climbing from the one for face i - 1
+template <typename T>
+static T FindMaxSeparation(const BasicVector2<T>* vertices1, const BasicVector2<T>* normals1, int vertexCount1,
+ const BasicVector2<T>* vertices2, int vertexCount2, int& edge)
+{
+	typedef BasicVector2<T> Vector2;
+	T maxSeparation = 0;
+	int support = 0;
+	for (int i = 0; i < vertexCount1; i++)
+	{
+		Vector2 normal = normals1[i];
+		support = BasicConvexPolygon<T>::FindSupport(vertices2, vertexCount2, -normal, support);
+		T separation = normal.Dot(vertices2[support] - vertices1[i]);
+		if (i == 0 || separation > maxSeparation)
+		{
+			maxSeparation = separation;
+			edge = i;
+		}
+		if (separation > 0) break;//Separating axis
+	}
+	return maxSeparation;
+}
+
+//Keeps the part of segment in on the back of the plane, returns how many points made it to out
+template <typename T>
+static int ClipSegment(const BasicVector2<T> in[2], BasicVector2<T> out[2], BasicVector2<T> normal, T offset)
+{
+	int count = 0;
+	T dist0 = normal.Dot(in[0]) - offset;
+	T dist1 = normal.Dot(in[1]) - offset;
+	if (dist0 <= 0) out[count++] = in[0];
+	if (dist1 <= 0) out[count++] = in[1];
+	if ((dist0 < 0 && dist1 > 0) || (dist0 > 0 && dist1 < 0)) out[count++] = in[0] + (in[1] - in[0]) * (dist0 / (dist0 - dist1));
+	return count;
+}
+
+template <typename T>
+BasicConvexPolygon<T>::BasicConvexPolygon(const Vector2* vertices, size_t vertexCount, Vector2 pos, decimal rot, Vector2 vel,
+ decimal angVel, decimal mass, decimal e, bool isKinematic)
+	: m_vertexCount(0), Rigidbody(pos, rot, vel, angVel, mass, e, isKinematic)
+{
+	m_bodyType = BodyType::Polygon;
+	m_inertia = 0;
+	if (!vertices || vertexCount < 3 || vertexCount > POLYGON_MAX_VERTICES) return;
+	m_vertexCount = (int)vertexCount;
+	//Store them counter clockwise
+	decimal signedArea = 0;
+	for (int i = 0; i < m_vertexCount; i++) signedArea += vertices[i].Cross(vertices[(i + 1 < m_vertexCount) ? i + 1 : 0]);
+	for (int i = 0; i < m_vertexCount; i++) m_vertices[i] = vertices[(signedArea < 0) ? m_vertexCount - 1 - i : i];
+	//Area and centroid from a triangle fan around vertex 0
+	decimal area = 0;
+	Vector2 centroid;
+	for (int i = 1; i + 1 < m_vertexCount; i++)
+	{
+		decimal triangleArea = (m_vertices[i] - m_vertices[0]).Cross(m_vertices[i + 1] - m_vertices[0]) / 2;
+		area += triangleArea;
+		centroid += (m_vertices[0] + m_vertices[i] + m_vertices[i + 1]) * (triangleArea / 3);
+	}
+	centroid = centroid / area;
+	for (int i = 0; i < m_vertexCount; i++) m_vertices[i] -= centroid;
+	//Polar second moment of area about the centroid, scaled to the body's mass
+	decimal secondMoment = 0;
+	for (int i = 0; i < m_vertexCount; i++)
+	{
+		Vector2 v1 = m_vertices[i];
+		Vector2 v2 = m_vertices[(i + 1 < m_vertexCount) ? i + 1 : 0];
+		secondMoment += v1.Cross(v2) * (v1.Dot(v1) + v1.Dot(v2) + v2.Dot(v2)) / 12;
+		Vector2 edge = v2 - v1;
+		m_normals[i] = Vector2(edge.y, -edge.x).Normalize();
+	}
+	m_inertia = m_mass * secondMoment / area;
+}
+
+template <typename T>
+BasicConvexPolygon<T>::~BasicConvexPolygon()
+{
+}
+//Intersect AABB for Quad Nodes, SAT on the box axii (bounds overlap) and the polygon's normals
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
+{
+	Vector2 polygonTopRight, polygonBottomLeft;
+	ComputeAabb(polygonTopRight, polygonBottomLeft);
+	if (polygonBottomLeft.x > topRight.x || polygonTopRight.x < bottomLeft.x || polygonBottomLeft.y > topRight.y
+	 || polygonTopRight.y < bottomLeft.y) return false;
+	Vector2 quadCenter = (topRight + bottomLeft) / 2;
+	Vector2 quadExtents = topRight - quadCenter;
+	for (int i = 0; i < m_vertexCount; i++)
+	{
+		Vector2 normal = m_normals[i].Rotated(m_rotationMatrix);
+		Vector2 vertex = m_position + m_vertices[i].Rotated(m_rotationMatrix);
+		decimal quadMin = normal.Dot(quadCenter) - (Abs(normal.x) * quadExtents.x + Abs(normal.y) * quadExtents.y);
+		if (quadMin > normal.Dot(vertex)) return false;
+	}
+	return true;
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(Rigidbody* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(Circle* rb2, Manifold& manifold)
+{
+	//Polygon's local space, find the face the centre is furthest out of
+	Vector2 center = (rb2->m_position - m_position).InvRotate(m_rotationMatrix);
+	decimal radius = rb2->m_radius;
+	int face = 0;
+	decimal separation = 0;
+	for (int i = 0; i < m_vertexCount; i++)
+	{
+		decimal faceSeparation = m_normals[i].Dot(center - m_vertices[i]);
+		if (faceSeparation > radius) return false;
+		if (i == 0 || faceSeparation > separation)
+		{
+			separation = faceSeparation;
+			face = i;
+		}
+	}
+	Vector2 v1 = m_vertices[face];
+	Vector2 v2 = m_vertices[(face + 1 < m_vertexCount) ? face + 1 : 0];
+	Vector2 normal;
+	Vector2 contactPoint;
+	if (separation <= 0)
+	{
+		//Centre inside, push out through the closest face
+		normal = m_normals[face];
+		manifold.penetration = radius - separation;
+		contactPoint = center - normal * separation;
+	}
+	else
+	{
+		//Outside the face, the closest feature may be one of its vertices
+		Vector2 closest;
+		if ((center - v1).Dot(v2 - v1) <= 0) closest = v1;
+		else if ((center - v2).Dot(v1 - v2) <= 0) closest = v2;
+		else closest = center - m_normals[face] * separation;
+		Vector2 toCenter = center - closest;
+		if (toCenter.LengthSqr() > radius * radius) return false;
+		decimal distance = toCenter.Length();
+		normal = toCenter / distance;
+		manifold.penetration = radius - distance;
+		contactPoint = (closest + center - normal * radius) / 2;
+	}
+	manifold.normal = -normal.Rotated(m_rotationMatrix);//Point to A by convention
+	manifold.numContactPoints = 1;
+	manifold.contactPoints[0] = m_position + contactPoint.Rotated(m_rotationMatrix);
+	manifold.rb1 = this;
+	manifold.rb2 = rb2;
+	return true;
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(Capsule* rb2, Manifold& manifold)
+{
+	//Capsule segment in the polygon's local space
+	decimal radius = rb2->m_radius;
+	Vector2 halfAxis = Vector2(rb2->m_length / 2, 0).Rotate(rb2->m_rotationMatrix);
+	Vector2 a = (rb2->m_position - halfAxis - m_position).InvRotate(m_rotationMatrix);
+	Vector2 b = (rb2->m_position + halfAxis - m_position).InvRotate(m_rotationMatrix);
+	//SAT on the polygon's faces and the segment's normal, any of them separating by more than the radius is a miss
+	int face = 0;
+	decimal faceSeparation = 0;
+	for (int i = 0; i < m_vertexCount; i++)
+	{
+		decimal separation = Min(m_normals[i].Dot(a - m_vertices[i]), m_normals[i].Dot(b - m_vertices[i]));
+		if (separation > radius) return false;
+		if (i == 0 || separation > faceSeparation)
+		{
+			faceSeparation = separation;
+			face = i;
+		}
+	}
+	Vector2 segmentNormal = (b - a).Perp();
+	if (segmentNormal.Dot(a) < 0) segmentNormal = -segmentNormal;//Away from the centroid
+	decimal segmentSeparation = faceSeparation;
+	int support = 0;
+	if (rb2->m_length > 0)
+	{
+		segmentNormal.Normalize();
+		support = FindSupport(m_vertices, m_vertexCount, segmentNormal, 0);
+		segmentSeparation = segmentNormal.Dot(a - m_vertices[support]);
+		if (segmentSeparation > radius) return false;
+	}
+
+	Vector2 normal;
+	Vector2 contactPoints[2];
+	int numContactPoints = 0;
+	decimal penetration = 0;
+	//Faces win ties by a tenth of the radius, so a capsule lying on a face keeps both contacts from frame to frame
+	if (segmentSeparation <= faceSeparation + radius / 10)
+	{
+		//Clip the segment to the face's side planes, contact wherever it's within the radius of the face
+		Vector2 v1 = m_vertices[face];
+		Vector2 v2 = m_vertices[(face + 1 < m_vertexCount) ? face + 1 : 0];
+		Vector2 tangent = (v2 - v1).Normalized();
+		Vector2 segment[2] = { a, b };
+		Vector2 clipped[2];
+		Vector2 clipped2[2];
+		int clipCount = ClipSegment(segment, clipped, -tangent, -tangent.Dot(v1));
+		if (clipCount == 2) clipCount = ClipSegment(clipped, clipped2, tangent, tangent.Dot(v2));
+		normal = m_normals[face];
+		for (int i = 0; i < clipCount && clipCount == 2; i++)
+		{
+			decimal separation = normal.Dot(clipped2[i] - v1);
+			if (separation > radius) continue;
+			contactPoints[numContactPoints++] = clipped2[i] - normal * ((separation + radius) / 2);
+			penetration = Max(penetration, radius - separation);
+		}
+	}
+	if (!numContactPoints)
+	{
+		if (Max(faceSeparation, segmentSeparation) > 0)
+		{
+			//Cores apart, the closest points of the segment and the polygon's boundary decide
+			decimal minDistSqr = 0;
+			Vector2 polygonPoint, segmentPoint;
+			for (int i = 0; i < m_vertexCount; i++)
+			{
+				Vector2 v1 = m_vertices[i];
+				Vector2 v2 = m_vertices[(i + 1 < m_vertexCount) ? i + 1 : 0];
+				Vector2 candidates[6] = { ClosestPtToSegment(v1, v2, a), a, ClosestPtToSegment(v1, v2, b), b, v1, ClosestPtToSegment(a, b, v1) };
+				for (int j = 0; j < 6; j += 2)
+				{
+					decimal distSqr = (candidates[j + 1] - candidates[j]).LengthSqr();
+					if ((i == 0 && j == 0) || distSqr < minDistSqr)
+					{
+						minDistSqr = distSqr;
+						polygonPoint = candidates[j];
+						segmentPoint = candidates[j + 1];
+					}
+				}
+			}
+			if (minDistSqr > radius * radius) return false;
+			decimal distance = Sqrt(minDistSqr);
+			normal = (distance > 0) ? (segmentPoint - polygonPoint) / distance : m_normals[face];
+			contactPoints[0] = (polygonPoint + segmentPoint - normal * radius) / 2;
+			penetration = radius - distance;
+		}
+		else
+		{
+			//Segment through the polygon, separate along whichever axis overlaps least
+			bool faceAxis = segmentSeparation <= faceSeparation;
+			normal = faceAxis ? m_normals[face] : segmentNormal;
+			contactPoints[0] = faceAxis ? ((normal.Dot(a - b) < 0) ? a : b) : m_vertices[support];
+			penetration = radius - (faceAxis ? faceSeparation : segmentSeparation);
+		}
+		numContactPoints = 1;
+	}
+	manifold.normal = -normal.Rotated(m_rotationMatrix);//Point to A by convention
+	manifold.numContactPoints = numContactPoints;
+	for (int i = 0; i < numContactPoints; i++) manifold.contactPoints[i] = m_position + contactPoints[i].Rotated(m_rotationMatrix);
+	manifold.penetration = penetration;
+	manifold.rb1 = this;
+	manifold.rb2 = rb2;
+	return true;
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(OrientedBox* rb2, Manifold& manifold)
+{
+	//Box as a 4 vertex polygon, edge i runs from corner i to i + 1
+	Vector2 corners[4];
+	rb2->GetCorners(corners);
+	Vector2 axisX = Vector2(1, 0).Rotate(rb2->m_rotationMatrix);
+	Vector2 axisY = Vector2(0, 1).Rotate(rb2->m_rotationMatrix);
+	Vector2 normals[4] = { axisY, -axisX, -axisY, axisX };
+	return IntersectPolygon(corners, normals, 4, rb2, manifold);
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(ConvexPolygon* rb2, Manifold& manifold)
+{
+	Vector2 vertices[POLYGON_MAX_VERTICES];
+	Vector2 normals[POLYGON_MAX_VERTICES];
+	rb2->GetWorldVertices(vertices, normals);
+	return IntersectPolygon(vertices, normals, rb2->m_vertexCount, rb2, manifold);
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectPolygon(const Vector2* vertices2, const Vector2* normals2, int vertexCount2, Rigidbody* rb2,
+ Manifold& manifold)
+{
+	Vector2 vertices1[POLYGON_MAX_VERTICES];
+	Vector2 normals1[POLYGON_MAX_VERTICES];
+	GetWorldVertices(vertices1, normals1);
+	int edge1 = 0;
+	int edge2 = 0;
+	decimal separation1 = FindMaxSeparation(vertices1, normals1, m_vertexCount, vertices2, vertexCount2, edge1);
+	if (separation1 > 0) return false;
+	decimal separation2 = FindMaxSeparation(vertices2, normals2, vertexCount2, vertices1, m_vertexCount, edge2);
+	if (separation2 > 0) return false;
+
+	//Reference face from this unless rb2's is clearly shallower, so it doesn't flip between frames on near ties
+	bool flip = separation2 > separation1 * (decimal)0.98f + (decimal)0.001f;
+	const Vector2* refVertices = flip ? vertices2 : vertices1;
+	const Vector2* incVertices = flip ? vertices1 : vertices2;
+	const Vector2* incNormals = flip ? normals1 : normals2;
+	int refCount = flip ? vertexCount2 : m_vertexCount;
+	int incCount = flip ? m_vertexCount : vertexCount2;
+	int refEdge = flip ? edge2 : edge1;
+	Vector2 refNormal = flip ? normals2[refEdge] : normals1[refEdge];
+	Vector2 v1 = refVertices[refEdge];
+	Vector2 v2 = refVertices[(refEdge + 1 < refCount) ? refEdge + 1 : 0];
+	//Incident edge is the one facing the reference normal the most, normals are in order around the hull too
+	int incEdge = FindSupport(incNormals, incCount, -refNormal, 0);
+	Vector2 incident[2] = { incVertices[incEdge], incVertices[(incEdge + 1 < incCount) ? incEdge + 1 : 0] };
+
+	//Clip the incident edge to the reference face's side planes, keep what's behind the face
+	Vector2 tangent = (v2 - v1).Normalized();
+	Vector2 clipped[2];
+	Vector2 clipped2[2];
+	int clipCount = ClipSegment(incident, clipped, -tangent, -tangent.Dot(v1));
+	if (clipCount == 2) clipCount = ClipSegment(clipped, clipped2, tangent, tangent.Dot(v2));
+	decimal penetration = 0;
+	for (int i = 0; i < clipCount && clipCount == 2; i++)
+	{
+		decimal separation = refNormal.Dot(clipped2[i] - v1);
+		if (separation > 0) continue;
+		manifold.contactPoints[manifold.numContactPoints++] = clipped2[i];
+		penetration = Max(penetration, -separation);
+	}
+	if (!manifold.numContactPoints)
+	{
+		//Clipping lost the edge to rounding, use the deepest incident vertex
+		int deepest = FindSupport(incVertices, incCount, -refNormal, incEdge);
+		manifold.contactPoints[0] = incVertices[deepest];
+		manifold.numContactPoints = 1;
+		penetration = -refNormal.Dot(incVertices[deepest] - v1);
+	}
+	manifold.normal = flip ? refNormal : -refNormal;//Point to A by convention
+	manifold.penetration = penetration;
+	manifold.rb1 = this;
+	manifold.rb2 = rb2;
+	return true;
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IntersectWith(Compound* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+T BasicConvexPolygon<T>::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
+{
+	return rb2->SweepWith(this, dt, manifold);
+}
+
+template <typename T>
+T BasicConvexPolygon<T>::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicConvexPolygon<T>::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicConvexPolygon<T>::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicConvexPolygon<T>::SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicConvexPolygon<T>::SweepWith(Compound* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+void BasicConvexPolygon<T>::ComputeAabb(Vector2& topRight, Vector2& bottomLeft)
+{
+	topRight = m_position + m_vertices[0].Rotated(m_rotationMatrix);
+	bottomLeft = topRight;
+	for (int i = 1; i < m_vertexCount; i++)
+	{
+		Vector2 vertex = m_position + m_vertices[i].Rotated(m_rotationMatrix);
+		topRight = Vector2(Max(topRight.x, vertex.x), Max(topRight.y, vertex.y));
+		bottomLeft = Vector2(Min(bottomLeft.x, vertex.x), Min(bottomLeft.y, vertex.y));
+	}
+}
+
+template <typename T>
+void BasicConvexPolygon<T>::GetWorldVertices(Vector2* vertices, Vector2* normals)
+{
+	for (int i = 0; i < m_vertexCount; i++)
+	{
+		vertices[i] = m_position + m_vertices[i].Rotated(m_rotationMatrix);
+		normals[i] = m_normals[i].Rotated(m_rotationMatrix);
+	}
+}
+
+template <typename T>
+bool BasicConvexPolygon<T>::IsValid(const Vector2* vertices, size_t vertexCount)
+{
+	if (!vertices || vertexCount < 3 || vertexCount > POLYGON_MAX_VERTICES) return false;
+	decimal signedArea = 0;
+	for (size_t i = 0; i < vertexCount; i++) signedArea += vertices[i].Cross(vertices[(i + 1 < vertexCount) ? i + 1 : 0]);
+	if (signedArea == 0) return false;
+	//Every other vertex strictly inside each edge, also rejects repeated vertices and self intersecting stars
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		Vector2 v1 = vertices[i];
+		Vector2 edge = vertices[(i + 1 < vertexCount) ? i + 1 : 0] - v1;
+		for (size_t j = 0; j < vertexCount; j++)
+		{
+			if (j == i || j == ((i + 1 < vertexCount) ? i + 1 : 0)) continue;
+			decimal side = edge.Cross(vertices[j] - v1);
+			if ((signedArea > 0) ? side <= 0 : side >= 0) return false;
+		}
+	}
+	return true;
+}
+
+template <typename T>
+int BasicConvexPolygon<T>::FindSupport(const Vector2* vertices, int vertexCount, Vector2 dir, int start)
+{
+	int best = start;
+	decimal bestDot = dir.Dot(vertices[best]);
+	//Climb towards whichever neighbour is higher, a flat neighbour means we're already on top or at the bottom of a flat edge
+	int step = (dir.Dot(vertices[(best + 1 < vertexCount) ? best + 1 : 0]) > bestDot) ? 1 : vertexCount - 1;
+	for (int i = 1; i < vertexCount; i++)
+	{
+		int next = (best + step) % vertexCount;
+		decimal nextDot = dir.Dot(vertices[next]);
+		if (nextDot <= bestDot) break;
+		best = next;
+		bestDot = nextDot;
+	}
+	return best;
+}
+
+template class BasicConvexPolygon<float>;
+template class BasicConvexPolygon<fp64::Fp64>;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Rigidbody.h"
+#include "PipMath.h"
+
+#define POLYGON_MAX_VERTICES 8//Vertices live inline, every polygon takes the same pool size
+
+template <typename T>
+class BasicConvexPolygon :
+	public BasicRigidbody<T>
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	PIP_RIGIDBODY_MEMBERS
+
+	//Vertices are relative to pos and get recentred on their centroid, so pos ends up being the centre of mass
+	BasicConvexPolygon(const Vector2* vertices = nullptr, size_t vertexCount = 0, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	~BasicConvexPolygon();
+	virtual bool IntersectWith(Vector2 topRight, Vector2 bottomLeft) override;
+	virtual bool IntersectWith(Rigidbody* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Circle* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Capsule* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(OrientedBox* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(ConvexPolygon* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Compound* rb2, Manifold& manifold) override;
+	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Circle* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Capsule* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Compound* rb2, decimal dt, Manifold& manifold) override;
+	virtual void ComputeAabb(Vector2& topRight, Vector2& bottomLeft) override;
+	void GetWorldVertices(Vector2* vertices, Vector2* normals);//Fills m_vertexCount of each
+	static bool IsValid(const Vector2* vertices, size_t vertexCount);//3 to POLYGON_MAX_VERTICES, strictly convex, either winding
+	//Vertex furthest along dir, climbing from start. Dot products along a convex hull rise then fall, so the walk stops
+	//at the maximum after visiting only the vertices in between
+	static int FindSupport(const Vector2* vertices, int vertexCount, Vector2 dir, int start);
+private:
+	bool IntersectPolygon(const Vector2* vertices2, const Vector2* normals2, int vertexCount2, Rigidbody* rb2, Manifold& manifold);
+public:
+	Vector2 m_vertices[POLYGON_MAX_VERTICES];//Local space, counter clockwise around the centroid
+	Vector2 m_normals[POLYGON_MAX_VERTICES];//Local outward normal of edge i, from vertex i to i + 1
+	int m_vertexCount;
+};
+typedef BasicConvexPolygon<decimal> ConvexPolygon;
@@ -6,10 +6,15 @@
 #include "Circle.h"
 #include "Capsule.h"
 #include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
+#include "AllocationHooks.h"
 
 using namespace std;
 
-DefaultAllocator::DefaultAllocator(size_t poolSize)
+template <typename T>
+BasicDefaultAllocator<T>::BasicDefaultAllocator(size_t poolSize)
+	: m_ownsPool(true)
 {
 	if (poolSize > 0)
 	{
@@ -18,28 +23,67 @@ DefaultAllocator::DefaultAllocator(size_t poolSize)
 }
 
 
-DefaultAllocator::~DefaultAllocator()
+template <typename T>
+BasicDefaultAllocator<T>::~BasicDefaultAllocator()
 {
 	DestroyPool();
 }
 
-void DefaultAllocator::CreatePool(size_t size)
+template <typename T>
+void BasicDefaultAllocator<T>::CreatePool(size_t size)
 {
-	m_pool.start = (char*)(malloc(size));
+	m_pool.start = (char*)(PipAllocate(size));
 	m_pool.next = m_pool.start;
 	m_pool.end = m_pool.start + size;
+	m_ownsPool = true;
 }
 
-void DefaultAllocator::DestroyPool()
+template <typename T>
+void BasicDefaultAllocator<T>::DestroyPool()
 {
 	DestroyAllBodies();
-	free(m_pool.start);
+	if (m_ownsPool) PipFree(m_pool.start);
 	m_pool.start = nullptr;
 	m_pool.next = nullptr;
 	m_pool.end = nullptr;
 }
 
-void* DefaultAllocator::AllocateBody( size_t length, Handle& handle)
+template <typename T>
+void BasicDefaultAllocator<T>::ReservePool(size_t size)
+{
+	size_t capacity = m_pool.end - m_pool.start;
+	if (size <= capacity) return;
+	if (!m_ownsPool)
+	{
+		std::cout << "PiP Error: ReservePool can't grow a pool it doesn't own" << std::endl;
+		return;
+	}
+	size_t used = m_pool.next - m_pool.start;
+	char* start = (char*)(PipReallocate(m_pool.start, size));
+	if (!start)
+	{
+		std::cout << "PiP Error: ReservePool failed to grow the pool" << std::endl;
+		return;
+	}
+	memset(start + capacity, 0, size - capacity);
+	m_pool.start = start;
+	m_pool.next = start + used;
+	m_pool.end = start + size;
+}
+
+template <typename T>
+void BasicDefaultAllocator<T>::UsePool(char* start, size_t size)
+{
+	DestroyPool();
+	m_pool.start = start;
+	m_pool.next = start;
+	m_pool.end = start + size;
+	m_ownsPool = false;
+	DestroyAllBodies();
+}
+
+template <typename T>
+void* BasicDefaultAllocator<T>::AllocateBody( size_t length, Handle& handle)
 {
 	//Asks for a linear slot of that size from the pool and return void *
 	if (length > AvailableInPool()) {
@@ -80,7 +124,52 @@ void* DefaultAllocator::AllocateBody( size_t length, Handle& handle)
 	return (void*)ret;
 }
 
-void DefaultAllocator::DestroyAllBodies()
+template <typename T>
+void* BasicDefaultAllocator<T>::AllocateBodies(const size_t* lengths, size_t count, Handle* handles)
+{
+	size_t totalLength = 0;
+	for (size_t i = 0; i < count; i++) totalLength += lengths[i];
+	if (totalLength > AvailableInPool()) {
+		std::cout << "Error! Trying to allocate past pool size" << std::endl;
+		return nullptr;
+	}
+	size_t objIdx = m_objectToMappingIdx.size();
+	m_objectToMappingIdx.reserve(objIdx + count);
+	//Recycle gaps in the mapping list in one scan, then append new mappings for the rest
+	size_t bodyIdx = 0;
+	for (size_t i = 0; i < m_mappings.size() && bodyIdx < count; i++)
+	{
+		if (!m_mappings[i].active)
+		{
+			m_objectToMappingIdx.push_back(i);
+
+			m_mappings[i].active = true;
+			m_mappings[i].generation++;
+			m_mappings[i].idx = objIdx + bodyIdx;
+
+			handles[bodyIdx].idx = i;
+			handles[bodyIdx].generation = m_mappings[i].generation;
+			bodyIdx++;
+		}
+	}
+	m_mappings.reserve(m_mappings.size() + count - bodyIdx);
+	for (; bodyIdx < count; bodyIdx++)
+	{
+		m_objectToMappingIdx.push_back(m_mappings.size());
+
+		handles[bodyIdx].idx = m_mappings.size();
+		handles[bodyIdx].generation = 0;
+
+		m_mappings.push_back(Idx(true, objIdx + bodyIdx, 0));
+	}
+	//Allocate memory and move pool pointer
+	char* ret = m_pool.next;
+	m_pool.next += totalLength;
+	return (void*)ret;
+}
+
+template <typename T>
+void BasicDefaultAllocator<T>::DestroyAllBodies()
 {
 	memset(m_pool.start, 0, m_pool.end - m_pool.start);//#Profile memleak
 	m_pool.next = m_pool.start;
@@ -88,19 +177,22 @@ void DefaultAllocator::DestroyAllBodies()
 	m_objectToMappingIdx.clear();
 }
 //Bytes available
-size_t DefaultAllocator::AvailableInPool()
+template <typename T>
+size_t BasicDefaultAllocator<T>::AvailableInPool()
 {
 	return m_pool.end - m_pool.next;
 }
 
-Rigidbody* DefaultAllocator::GetFirstBody()
+template <typename T>
+BasicRigidbody<T>* BasicDefaultAllocator<T>::GetFirstBody()
 {
 	//Returns null if pool uninitted, dynamic cast
 	if (m_pool.start == m_pool.next)return nullptr;
 	return (Rigidbody*)m_pool.start;
 }
 
-Rigidbody* DefaultAllocator::GetNextBody(Rigidbody* prev)
+template <typename T>
+BasicRigidbody<T>* BasicDefaultAllocator<T>::GetNextBody(Rigidbody* prev)
 {
 	char* charP = (char*)prev;
 	char* charPNext = charP;
@@ -109,10 +201,17 @@ Rigidbody* DefaultAllocator::GetNextBody(Rigidbody* prev)
 	return (Rigidbody*)charPNext;
 }
 
-size_t DefaultAllocator::GetBodyByteSize(Rigidbody* rb)
+template <typename T>
+size_t BasicDefaultAllocator<T>::GetBodyByteSize(Rigidbody* rb)
 {
 	assert(rb);
-	switch (rb->m_bodyType)
+	return GetBodyByteSize(rb->m_bodyType);
+}
+
+template <typename T>
+size_t BasicDefaultAllocator<T>::GetBodyByteSize(BodyType bodyType)
+{
+	switch (bodyType)
 	{
 	case BodyType::Circle:
 	{
@@ -129,20 +228,32 @@ size_t DefaultAllocator::GetBodyByteSize(Rigidbody* rb)
 		return sizeof(OrientedBox);
 		break;
 	}
+	case BodyType::Polygon:
+	{
+		return sizeof(ConvexPolygon);
+		break;
+	}
+	case BodyType::Compound:
+	{
+		return sizeof(Compound);
+		break;
+	}
 	default:
 		break;
 	}
 	return size_t();
 }
 
-Rigidbody* DefaultAllocator::GetBody(Handle handle)
+template <typename T>
+BasicRigidbody<T>* BasicDefaultAllocator<T>::GetBody(Handle handle)
 {
 	if (!IsHandleValid(handle)) return nullptr;
 	Idx i = m_mappings[handle.idx];
 	return GetBodyAt(i.idx);
 }
 
-Rigidbody* DefaultAllocator::GetBodyAt(size_t i)
+template <typename T>
+BasicRigidbody<T>* BasicDefaultAllocator<T>::GetBodyAt(size_t i)
 {
 	//#Using pool mappings, could rapidly figure out memory offset from pool's m_start
 	//by comparing bodyTypes of all PoolIdx's
@@ -162,7 +273,8 @@ Rigidbody* DefaultAllocator::GetBodyAt(size_t i)
 	return rb;
 }
 
-Rigidbody* DefaultAllocator::GetLastBodyOfType(BodyType bodyType, int& idx )
+template <typename T>
+BasicRigidbody<T>* BasicDefaultAllocator<T>::GetLastBodyOfType(BodyType bodyType, int& idx )
 {
 	Rigidbody* lastBodyOfType = nullptr;
 	unsigned int curIdx = 0;
@@ -178,7 +290,8 @@ Rigidbody* DefaultAllocator::GetLastBodyOfType(BodyType bodyType, int& idx )
 	return lastBodyOfType;
 }
 
-void DefaultAllocator::DestroyBody(Handle handle)
+template <typename T>
+void BasicDefaultAllocator<T>::DestroyBody(Handle handle)
 {
 	if (!IsHandleValid(handle))
 	{
@@ -217,6 +330,16 @@ void DefaultAllocator::DestroyBody(Handle handle)
 				*(OrientedBox*)bodyToDestroy = *(OrientedBox*)lastMatchingBody;
 				break;
 			}
+			case BodyType::Polygon:
+			{
+				*(ConvexPolygon*)bodyToDestroy = *(ConvexPolygon*)lastMatchingBody;
+				break;
+			}
+			case BodyType::Compound:
+			{
+				*(Compound*)bodyToDestroy = *(Compound*)lastMatchingBody;
+				break;
+			}
 		}
 	}
 	//Pop and displace (objMapping and Pool)
@@ -232,12 +355,52 @@ void DefaultAllocator::DestroyBody(Handle handle)
 	m_mappings[handle.idx].active = false;
 }
 
-bool DefaultAllocator::IsHandleValid(Handle handle)
+template <typename T>
+void BasicDefaultAllocator<T>::DestroyBodies(const Handle* handles, size_t count)
+{
+	//Flag every body to destroy, then compact the pool once instead of displacing it per body
+	size_t objCount = m_objectToMappingIdx.size();
+	vector<bool> destroyFlags(objCount, false);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!IsHandleValid(handles[i]))
+		{
+			cout << "PiP Warning: DestroyBodies::Handle invalid" << endl;
+			continue;
+		}
+		destroyFlags[m_mappings[handles[i].idx].idx] = true;
+		m_mappings[handles[i].idx].active = false;
+	}
+	char* read = m_pool.start;
+	char* write = m_pool.start;
+	size_t writeIdx = 0;
+	for (size_t i = 0; i < objCount; i++)
+	{
+		size_t bodySize = GetBodyByteSize((Rigidbody*)read);
+		if (!destroyFlags[i])
+		{
+			//Write never overtakes read, so memmove doesn't clobber bodies yet to be visited
+			if (write != read) memmove(write, read, bodySize);
+			m_objectToMappingIdx[writeIdx] = m_objectToMappingIdx[i];
+			m_mappings[m_objectToMappingIdx[writeIdx]].idx = writeIdx;
+			write += bodySize;
+			writeIdx++;
+		}
+		read += bodySize;
+	}
+	memset(write, 0, m_pool.next - write);
+	m_pool.next = write;
+	m_objectToMappingIdx.resize(writeIdx);
+}
+
+template <typename T>
+bool BasicDefaultAllocator<T>::IsHandleValid(Handle handle)
 {
 	return handle.idx < m_mappings.size() && m_mappings[handle.idx].active && handle.generation == m_mappings[handle.idx].generation;
 }
 
-void DefaultAllocator::DestroyBodyFromPool(Rigidbody* bodyToDestroy)
+template <typename T>
+void BasicDefaultAllocator<T>::DestroyBodyFromPool(Rigidbody* bodyToDestroy)
 {
 	assert(bodyToDestroy);
 	BodyType bodyType = bodyToDestroy->m_bodyType;
@@ -259,6 +422,16 @@ void DefaultAllocator::DestroyBodyFromPool(Rigidbody* bodyToDestroy)
 			displacementSize = sizeof(OrientedBox);
 			break;
 		}
+		case BodyType::Polygon:
+		{
+			displacementSize = sizeof(ConvexPolygon);
+			break;
+		}
+		case BodyType::Compound:
+		{
+			displacementSize = sizeof(Compound);
+			break;
+		}
 	}
 	Rigidbody* bodyToDisplace = GetNextBody(bodyToDestroy);
 	memset((void*)bodyToDestroy, 0, displacementSize);
@@ -268,12 +441,16 @@ void DefaultAllocator::DestroyBodyFromPool(Rigidbody* bodyToDestroy)
 		if ((char*)bodyToDisplace == m_pool.next) break;
 		//Cache body and displace it back in the pool
 		size_t bodyToDisplaceSize = GetBodyByteSize(bodyToDisplace);
-		Rigidbody* cachedBodyToDisplace = (Rigidbody*)malloc(bodyToDisplaceSize);
+		Rigidbody* cachedBodyToDisplace = (Rigidbody*)PipAllocate(bodyToDisplaceSize);
 		memcpy((void*)cachedBodyToDisplace, (void*)bodyToDisplace, bodyToDisplaceSize);//cached
 		memset((void*)bodyToDisplace, 0, bodyToDisplaceSize);
 		bodyToDisplace = (Rigidbody*)((char*)bodyToDisplace - displacementSize);//Invalid right now
 		memcpy((void*)bodyToDisplace, (void*)cachedBodyToDisplace, bodyToDisplaceSize);
+		PipFree(cachedBodyToDisplace);
 	}
 	//Update m_pool pointers
 	m_pool.next -= displacementSize;
 }
+
+template class BasicDefaultAllocator<float>;
+template class BasicDefaultAllocator<fp64::Fp64>;
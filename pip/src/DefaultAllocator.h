@@ -42,20 +42,28 @@ struct Pool
     char* end;
 };
 
-class DefaultAllocator
+template <typename T>
+class BasicDefaultAllocator
 {
 public:
-	DefaultAllocator(size_t poolSize = 0);
-	~DefaultAllocator();
+	PIP_SCALAR_TYPES(T)
+
+	BasicDefaultAllocator(size_t poolSize = 0);
+	~BasicDefaultAllocator();
 	void CreatePool(size_t size);
 	void DestroyPool();//Profile whether free deallocates whole pool
+	void ReservePool(size_t size);//Grows the pool keeping its bodies, invalidates Rigidbody pointers
+	void UsePool(char* start, size_t size);//Bodies go in memory the caller owns, it's never freed nor grown from here
 	void* AllocateBody(size_t length, Handle& handle);
+	void* AllocateBodies(const size_t* lengths, size_t count, Handle* handles);//Contiguous block for count bodies, one capacity check
 	void DestroyAllBodies();//Won't call destructors
     void DestroyBody(Handle handle);
+    void DestroyBodies(const Handle* handles, size_t count);//Single compaction pass, keeps the order of surviving bodies
 	size_t AvailableInPool();
     Rigidbody* GetFirstBody();
 	Rigidbody* GetNextBody(Rigidbody* prev);
     size_t GetBodyByteSize(Rigidbody* rb);
+    static size_t GetBodyByteSize(BodyType bodyType);
     Rigidbody* GetBody(Handle handle);
     Rigidbody* GetBodyAt(size_t i);
     Rigidbody* GetLastBodyOfType(BodyType bodyType, int& idx);
@@ -64,9 +72,11 @@ protected:
     void DestroyBodyFromPool(Rigidbody* bodyToDestroy);//Realigns pool
 public:
 	Pool m_pool;
+	bool m_ownsPool;
     std::vector<Idx> m_mappings;//Maps reusable object list to linear object pool.
     std::vector<size_t> m_objectToMappingIdx;//Maps object idx in the pool to their mapping idx
 };
+typedef BasicDefaultAllocator<decimal> DefaultAllocator;
 
 /*
 #include <vector>
@@ -0,0 +1,174 @@
+#include "DesyncLog.h"
+
+#include <stdio.h>
+#include <iostream>
+
+using namespace std;
+
+template <typename T>
+BasicDesyncLog<T>::BasicDesyncLog()
+{
+	Clear();
+}
+
+template <typename T>
+void BasicDesyncLog<T>::Clear()
+{
+	m_stateHashes.clear();
+	m_stepOffsets.assign(1, 0);
+	m_bodies.clear();
+}
+
+template <typename T>
+size_t BasicDesyncLog<T>::GetStepCount() const
+{
+	return m_stateHashes.size();
+}
+
+template <typename T>
+void BasicDesyncLog<T>::Record(Solver& solver)
+{
+	//Bodies created, destroyed or edited since the step leave its hashes out of date, hash the state as it is
+	if (solver.m_stateHashStale) solver.HashState();
+	m_stateHashes.push_back(solver.m_stateHash);
+	const std::vector<Idx>& mappings = solver.m_allocator.m_mappings;
+	for (size_t i = 0; i < mappings.size(); i++)
+	{
+		if (!mappings[i].active) continue;
+		m_bodies.push_back(BodyHashRecord{ i, mappings[i].generation, solver.m_bodyHashes[mappings[i].idx] });
+	}
+	m_stepOffsets.push_back(m_bodies.size());
+}
+
+template <typename T>
+int BasicDesyncLog<T>::Replay(Solver& solver, const SolverState& start, unsigned int steps)
+{
+	Clear();
+	if (solver.RestoreState(start) != 0) return -1;
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		solver.Step(solver.m_timestep);
+		Record(solver);
+	}
+	return 0;
+}
+
+template <typename T>
+int BasicDesyncLog<T>::Write(const char* path) const
+{
+	DesyncLogHeader header = {};
+	header.magic = PIP_DESYNC_MAGIC;
+	header.version = PIP_DESYNC_VERSION;
+	header.stepCount = m_stateHashes.size();
+	header.bodyCount = m_bodies.size();
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		cout << "PiP Error: DesyncLog::Write couldn't open " << path << endl;
+		return -1;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (written && !m_stateHashes.empty()) written = fwrite(m_stateHashes.data(), sizeof(uint64_t), m_stateHashes.size(), file) == m_stateHashes.size();
+	if (written) written = fwrite(m_stepOffsets.data(), sizeof(uint64_t), m_stepOffsets.size(), file) == m_stepOffsets.size();
+	if (written && !m_bodies.empty()) written = fwrite(m_bodies.data(), sizeof(BodyHashRecord), m_bodies.size(), file) == m_bodies.size();
+	if (fclose(file) != 0) written = false;
+	if (!written)
+	{
+		cout << "PiP Error: DesyncLog::Write failed writing " << path << endl;
+		return -1;
+	}
+	return 0;
+}
+
+template <typename T>
+int BasicDesyncLog<T>::Read(const char* path)
+{
+	Clear();
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		cout << "PiP Error: DesyncLog::Read couldn't open " << path << endl;
+		return -1;
+	}
+	DesyncLogHeader header;
+	bool read = fread(&header, sizeof(header), 1, file) == 1;
+	if (read && (header.magic != PIP_DESYNC_MAGIC || header.version != PIP_DESYNC_VERSION))
+	{
+		cout << "PiP Error: DesyncLog::Read " << path << " isn't a desync log of this version" << endl;
+		fclose(file);
+		return -1;
+	}
+	//Counts are checked against what's left of the file before anything is sized from them
+	long fileSize = -1;
+	if (read && fseek(file, 0, SEEK_END) == 0) fileSize = ftell(file);
+	read = read && fileSize >= (long)sizeof(header) && fseek(file, sizeof(header), SEEK_SET) == 0;
+	if (read)
+	{
+		uint64_t remaining = (uint64_t)fileSize - sizeof(header);
+		read = remaining >= sizeof(uint64_t) && header.stepCount <= (remaining - sizeof(uint64_t)) / (2 * sizeof(uint64_t));
+		if (read) remaining -= (header.stepCount * 2 + 1) * sizeof(uint64_t);
+		read = read && header.bodyCount <= remaining / sizeof(BodyHashRecord);
+	}
+	if (read)
+	{
+		m_stateHashes.resize(header.stepCount);
+		m_stepOffsets.resize(header.stepCount + 1);
+		m_bodies.resize(header.bodyCount);
+		if (!m_stateHashes.empty()) read = fread(m_stateHashes.data(), sizeof(uint64_t), m_stateHashes.size(), file) == m_stateHashes.size();
+		if (read) read = fread(m_stepOffsets.data(), sizeof(uint64_t), m_stepOffsets.size(), file) == m_stepOffsets.size();
+		if (read && !m_bodies.empty()) read = fread(m_bodies.data(), sizeof(BodyHashRecord), m_bodies.size(), file) == m_bodies.size();
+		//FindDesync indexes m_bodies with every step's range
+		read = read && m_stepOffsets.front() == 0 && m_stepOffsets.back() == m_bodies.size();
+		for (size_t i = 1; read && i < m_stepOffsets.size(); i++) read = m_stepOffsets[i - 1] <= m_stepOffsets[i];
+	}
+	fclose(file);
+	if (!read)
+	{
+		cout << "PiP Error: DesyncLog::Read failed reading " << path << endl;
+		Clear();
+		return -1;
+	}
+	return 0;
+}
+
+template <typename T>
+bool BasicDesyncLog<T>::FindDesync(const BasicDesyncLog& a, const BasicDesyncLog& b, size_t& step, Handle& handle)
+{
+	size_t stepCount = std::min(a.GetStepCount(), b.GetStepCount());
+	for (step = 0; step < stepCount; step++)
+	{
+		if (a.m_stateHashes[step] == b.m_stateHashes[step]) continue;
+		//Both lists are in handle order, walk them side by side
+		size_t i = a.m_stepOffsets[step], j = b.m_stepOffsets[step];
+		size_t endA = a.m_stepOffsets[step + 1], endB = b.m_stepOffsets[step + 1];
+		while (i < endA || j < endB)
+		{
+			const BodyHashRecord* bodyA = (i < endA) ? &a.m_bodies[i] : nullptr;
+			const BodyHashRecord* bodyB = (j < endB) ? &b.m_bodies[j] : nullptr;
+			if (!bodyB || (bodyA && bodyA->handleIdx < bodyB->handleIdx))
+			{
+				handle = Handle((size_t)bodyA->handleIdx, bodyA->generation);
+				return true;
+			}
+			if (!bodyA || bodyB->handleIdx < bodyA->handleIdx)
+			{
+				handle = Handle((size_t)bodyB->handleIdx, bodyB->generation);
+				return true;
+			}
+			if (bodyA->generation != bodyB->generation || bodyA->hash != bodyB->hash)
+			{
+				handle = Handle((size_t)bodyA->handleIdx, bodyA->generation);
+				return true;
+			}
+			i++;
+			j++;
+		}
+		//Same bodies, the state hashes alone differ
+		handle = Handle(0, 0);
+		return true;
+	}
+	return false;
+}
+
+template class BasicDesyncLog<float>;
+template class BasicDesyncLog<fp64::Fp64>;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Solver.h"
+
+#define PIP_DESYNC_MAGIC 0x44504950 //"PIPD" read as little endian uint32
+#define PIP_DESYNC_VERSION 1
+
+//Hash of one body after a step, keyed by its handle
+struct BodyHashRecord
+{
+	uint64_t handleIdx;
+	uint64_t generation;
+	uint64_t hash;
+};
+
+//Layout: [DesyncLogHeader][uint64 state hash * stepCount][uint64 offset * (stepCount + 1)][BodyHashRecord * bodyCount]
+struct DesyncLogHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t stepCount;
+	uint64_t bodyCount;
+};
+
+//Step by step digest of a run for lockstep checks: the state hash of every step and each body's hash, in handle order.
+//Clients record their runs from the hashes Step leaves behind, FindDesync points at the first step and body where two
+//runs part ways
+template <typename T>
+class BasicDesyncLog
+{
+public:
+	typedef BasicSolver<T> Solver;
+	typedef BasicSolverState<T> SolverState;
+
+	BasicDesyncLog();
+	void Clear();
+	size_t GetStepCount() const;
+	void Record(Solver& solver);//Appends the state the solver's last Step left
+	int Replay(Solver& solver, const SolverState& start, unsigned int steps);//Restores start and records every step, -1 if it doesn't fit
+	int Write(const char* path) const;
+	int Read(const char* path);//Replaces the log, -1 if the file isn't a desync log
+	//Compares the steps both logs have. Returns false if they match, otherwise the first step whose hashes differ and the
+	//first body in handle order that differs or exists in only one of them
+	static bool FindDesync(const BasicDesyncLog& a, const BasicDesyncLog& b, size_t& step, Handle& handle);
+public:
+	std::vector<uint64_t> m_stateHashes;//One per step
+	std::vector<uint64_t> m_stepOffsets;//Step i's bodies are [m_stepOffsets[i], m_stepOffsets[i + 1]) of m_bodies
+	std::vector<BodyHashRecord> m_bodies;
+};
+typedef BasicDesyncLog<decimal> DesyncLog;
@@ -0,0 +1,67 @@
+#include "Heightfield.h"
+
+using namespace PipMath;
+
+template <typename T>
+BasicHeightfield<T>::BasicHeightfield(const decimal* heights, size_t sampleCount, Vector2 origin, decimal spacing, decimal depth, decimal e)
+	: m_heights(heights, heights + sampleCount), m_origin(origin), m_spacing(spacing), m_depth(depth)
+{
+	m_shapeType = StaticShapeType::Heightfield;
+	size_t columnCount = (sampleCount < 2) ? 0 : sampleCount - 1;
+	m_segments.reserve(columnCount);
+	m_columnTop.resize(columnCount);
+	m_columnBottom.resize(columnCount);
+	for (size_t i = 0; i < columnCount; i++)
+	{
+		Vector2 a = m_origin + Vector2(m_spacing * (decimal)(int)i, heights[i]);
+		Vector2 b = m_origin + Vector2(m_spacing * (decimal)(int)(i + 1), heights[i + 1]);
+		Vector2 ab = b - a;
+		decimal length = ab.Length();
+		Vector2 down = -ab.Perp() / length;
+		m_segments.push_back(OrientedBox(Vector2(length / 2, m_depth / 2), a + ab / 2 + down * (m_depth / 2), Atan2(ab.y, ab.x), Vector2(),
+		 0.f, 1.f, e, true));
+		Vector2 topRight, bottomLeft;
+		m_segments[i].ComputeAabb(topRight, bottomLeft);
+		m_columnTop[i] = topRight.y;
+		m_columnBottom[i] = bottomLeft.y;
+	}
+}
+
+template <typename T>
+BasicHeightfield<T>::~BasicHeightfield()
+{
+}
+
+template <typename T>
+void BasicHeightfield<T>::Query(Vector2 topRight, Vector2 bottomLeft, std::vector<OrientedBox*>& segments)
+{
+	int columnCount = (int)m_segments.size();
+	if (!columnCount) return;
+	//Steep columns lean over their neighbours by up to m_depth, widen the range to keep their proxies
+	decimal minX = bottomLeft.x - m_depth - m_origin.x;
+	decimal maxX = topRight.x + m_depth - m_origin.x;
+	decimal width = m_spacing * (decimal)columnCount;
+	//Reject and clamp before converting to int, a body far off the field (or a NaN one) doesn't fit in an int
+	if (!(maxX >= 0 && minX <= width)) return;
+	if (minX < 0) minX = 0;
+	if (maxX > width) maxX = width;
+	int first = (int)(minX / m_spacing) - 1;
+	int last = (int)(maxX / m_spacing) + 1;
+	if (first < 0) first = 0;
+	if (last > columnCount - 1) last = columnCount - 1;
+	for (int i = first; i <= last; i++)
+	{
+		if (m_columnBottom[i] > topRight.y || m_columnTop[i] < bottomLeft.y) continue;
+		segments.push_back(&m_segments[i]);
+	}
+}
+
+template <typename T>
+size_t BasicHeightfield<T>::GetByteSize()
+{
+	return sizeof(*this) + m_segments.capacity() * sizeof(OrientedBox)
+	 + (m_heights.capacity() + m_columnTop.capacity() + m_columnBottom.capacity()) * sizeof(decimal);
+}
+
+template class BasicHeightfield<float>;
+template class BasicHeightfield<fp64::Fp64>;
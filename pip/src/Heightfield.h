@@ -0,0 +1,28 @@
+#pragma once
+
+#include "StaticShape.h"
+
+//Static terrain from evenly spaced height samples. Column i spans samples i and i + 1, its proxy box hangs depth below
+//the surface so bodies can't tunnel through a thin crust. A body's columns come straight from its x range
+template <typename T>
+class BasicHeightfield :
+	public BasicStaticShape<T>
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	using BasicStaticShape<T>::m_shapeType;
+	using BasicStaticShape<T>::m_segments;
+
+	BasicHeightfield(const decimal* heights, size_t sampleCount, Vector2 origin, decimal spacing, decimal depth = 1.f, decimal e = 1.f);
+	~BasicHeightfield();
+	virtual void Query(Vector2 topRight, Vector2 bottomLeft, std::vector<OrientedBox*>& segments) override;
+	virtual size_t GetByteSize() override;
+public:
+	std::vector<decimal> m_heights;//Relative to m_origin.y
+	Vector2 m_origin;//First sample's x, heights' zero
+	decimal m_spacing;
+	decimal m_depth;
+	std::vector<decimal> m_columnTop;//Proxy bounds per column, for culling by y
+	std::vector<decimal> m_columnBottom;
+};
+typedef BasicHeightfield<decimal> Heightfield;
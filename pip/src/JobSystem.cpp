@@ -0,0 +1,130 @@
+#include "JobSystem.h"
+
+using namespace std;
+
+JobSystem::JobSystem(unsigned int threadCount)
+	: m_pendingJobs(0), m_generation(0), m_quit(false)
+{
+	SetThreadCount(threadCount);
+}
+
+JobSystem::~JobSystem()
+{
+	StopWorkers();
+}
+
+void JobSystem::SetThreadCount(unsigned int threadCount)
+{
+	if (threadCount < 1) threadCount = 1;
+	StopWorkers();
+	m_queues.clear();
+	//A single thread runs everything inline, it needs no queue
+	for (unsigned int i = 0; threadCount > 1 && i < threadCount; i++)
+	{
+		m_queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+		m_queues.back()->head = 0;
+	}
+	m_quit = false;
+	for (unsigned int i = 1; i < threadCount; i++) m_workers.push_back(thread(&JobSystem::WorkerLoop, this, i));
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, TaskFunction task, void* context)
+{
+	if (count == 0) return;
+	if (grain < 1) grain = 1;
+	size_t threadCount = m_queues.size();
+	size_t jobCount = (count + grain - 1) / grain;
+	if (threadCount <= 1 || jobCount == 1)
+	{
+		task(context, 0, count, 0);
+		return;
+	}
+	//Counted before any job is visible, so finishing one never takes the count below zero
+	m_pendingJobs.store(jobCount, memory_order_relaxed);
+	for (size_t i = 0; i < jobCount; i++)
+	{
+		WorkerQueue& queue = *m_queues[i * threadCount / jobCount];
+		lock_guard<mutex> lock(queue.mutex);
+		if (queue.head == queue.jobs.size())
+		{
+			queue.jobs.clear();
+			queue.head = 0;
+		}
+		size_t begin = i * grain;
+		queue.jobs.push_back(Job{ task, context, begin, (begin + grain < count) ? begin + grain : count });
+	}
+	{
+		lock_guard<mutex> lock(m_wakeMutex);
+		m_generation++;
+	}
+	m_wake.notify_all();
+	while (m_pendingJobs.load(memory_order_acquire) > 0)
+	{
+		if (!RunOneJob(0)) this_thread::yield();
+	}
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return m_queues.empty() ? 1 : (unsigned int)m_queues.size();
+}
+
+void JobSystem::WorkerLoop(unsigned int threadIdx)
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_wakeMutex);
+			m_wake.wait(lock, [&] { return m_quit || m_generation != generation; });
+			if (m_quit) return;
+			generation = m_generation;
+		}
+		while (m_pendingJobs.load(memory_order_acquire) > 0)
+		{
+			if (!RunOneJob(threadIdx)) this_thread::yield();
+		}
+	}
+}
+
+bool JobSystem::RunOneJob(unsigned int threadIdx)
+{
+	size_t threadCount = m_queues.size();
+	Job job;
+	bool found = false;
+	{
+		WorkerQueue& queue = *m_queues[threadIdx];
+		lock_guard<mutex> lock(queue.mutex);
+		if (queue.jobs.size() > queue.head)
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			found = true;
+		}
+	}
+	for (size_t i = 1; i < threadCount && !found; i++)
+	{
+		WorkerQueue& queue = *m_queues[(threadIdx + i) % threadCount];
+		lock_guard<mutex> lock(queue.mutex);
+		if (queue.jobs.size() > queue.head)
+		{
+			job = queue.jobs[queue.head++];
+			found = true;
+		}
+	}
+	if (!found) return false;
+	job.task(job.context, job.begin, job.end, threadIdx);
+	m_pendingJobs.fetch_sub(1, memory_order_release);
+	return true;
+}
+
+void JobSystem::StopWorkers()
+{
+	{
+		lock_guard<mutex> lock(m_wakeMutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (thread& worker : m_workers) worker.join();
+	m_workers.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdint.h>
+
+#include "TaskScheduler.h"
+
+//Work stealing thread pool. A ParallelFor deals its ranges out to every thread's queue in contiguous blocks, each
+//thread runs its own block from the back and steals from the front of the others once it's out of work. The calling
+//thread takes part as thread 0, with one thread everything runs inline
+class JobSystem :
+	public TaskScheduler
+{
+public:
+	JobSystem(unsigned int threadCount = 1);
+	~JobSystem();
+	void SetThreadCount(unsigned int threadCount);//Restarts the workers, call between ParallelFors
+	virtual void ParallelFor(size_t count, size_t grain, TaskFunction task, void* context) override;
+	virtual unsigned int GetThreadCount() override;
+private:
+	struct Job
+	{
+		TaskFunction task;
+		void* context;
+		size_t begin, end;
+	};
+	//Owner pops the back, thieves take the front. Keeps its capacity, once warmed up a ParallelFor doesn't allocate
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::vector<Job> jobs;
+		size_t head;
+	};
+	void WorkerLoop(unsigned int threadIdx);
+	bool RunOneJob(unsigned int threadIdx);//Own queue first, then the others. False if there was nothing to take
+	void StopWorkers();
+public:
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues;//One per thread
+	std::vector<std::thread> m_workers;//Threads 1 and up
+	std::atomic<size_t> m_pendingJobs;//Ranges of the current ParallelFor that haven't finished
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	uint64_t m_generation;//Bumped by every ParallelFor, workers sleep until it changes
+	bool m_quit;
+};
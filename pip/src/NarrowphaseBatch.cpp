@@ -0,0 +1,286 @@
+#include "NarrowphaseBatch.h"
+
+#include "Circle.h"
+#include "OrientedBox.h"
+#include "CollisionDispatch.h"
+
+#if PIP_SSE
+#include <emmintrin.h>
+#endif
+
+#define PIP_BATCH_LANES 4
+#define PIP_BATCH_GRAIN 64//Generic pairs per parallel-for range
+
+using namespace PipMath;
+
+template <typename T>
+void BasicNarrowphaseBatch<T>::Clear()
+{
+	m_pairs.clear();
+	m_circleCircle.clear();
+	m_circleObb.clear();
+	m_other.clear();
+}
+
+template <typename T>
+size_t BasicNarrowphaseBatch<T>::GetByteSize()
+{
+	return m_pairs.capacity() * sizeof(Rigidbody*) + (m_circleCircle.capacity() + m_circleObb.capacity() + m_other.capacity()) * sizeof(size_t)
+	 + m_hits.capacity() + m_results.capacity() * sizeof(Manifold) + m_lanes.capacity() * sizeof(T);
+}
+
+template <typename T>
+void BasicNarrowphaseBatch<T>::AddPair(Rigidbody* rb1, Rigidbody* rb2)
+{
+	size_t pairIdx = m_pairs.size() / 2;
+	m_pairs.push_back(rb1);
+	m_pairs.push_back(rb2);
+	BodyType type1 = rb1->m_bodyType;
+	BodyType type2 = rb2->m_bodyType;
+	if (type1 == BodyType::Circle && type2 == BodyType::Circle) m_circleCircle.push_back(pairIdx);
+	else if ((type1 == BodyType::Circle && type2 == BodyType::Obb) || (type1 == BodyType::Obb && type2 == BodyType::Circle)) m_circleObb.push_back(pairIdx);
+	else m_other.push_back(pairIdx);
+}
+
+template <typename T>
+size_t BasicNarrowphaseBatch<T>::Run(std::vector<Manifold>& manifolds, TaskScheduler* scheduler)
+{
+	size_t pairCount = m_pairs.size() / 2;
+	m_hits.assign(pairCount, 0);
+	if (m_results.size() < pairCount) m_results.resize(pairCount);
+	RunCircleCircle();
+	RunCircleObb();
+	//Every pair writes its own slot
+	ParallelFor(scheduler, m_other.size(), PIP_BATCH_GRAIN, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++)
+		{
+			size_t pairIdx = m_other[i];
+			m_results[pairIdx] = Manifold();
+			m_hits[pairIdx] = IntersectPair(m_pairs[pairIdx * 2], m_pairs[pairIdx * 2 + 1], m_results[pairIdx]);
+		}
+	});
+	size_t hitCount = 0;
+	for (size_t i = 0; i < pairCount; i++)
+	{
+		if (!m_hits[i]) continue;
+		manifolds.push_back(m_results[i]);
+		hitCount++;
+	}
+	return hitCount;
+}
+
+//Scalar fallback, one pair at a time through the dispatch table
+template <typename T>
+void BasicNarrowphaseBatch<T>::RunCircleCircle()
+{
+	for (size_t pairIdx : m_circleCircle)
+	{
+		m_results[pairIdx] = Manifold();
+		m_hits[pairIdx] = IntersectPair(m_pairs[pairIdx * 2], m_pairs[pairIdx * 2 + 1], m_results[pairIdx]);
+	}
+}
+
+template <typename T>
+void BasicNarrowphaseBatch<T>::RunCircleObb()
+{
+	for (size_t pairIdx : m_circleObb)
+	{
+		m_results[pairIdx] = Manifold();
+		m_hits[pairIdx] = IntersectPair(m_pairs[pairIdx * 2], m_pairs[pairIdx * 2 + 1], m_results[pairIdx]);
+	}
+}
+
+#if PIP_SSE
+//The kernels replay Circle::IntersectWith's float operations in the same order, so hits and manifolds match it bit for bit
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+template <>
+void BasicNarrowphaseBatch<float>::RunCircleCircle()
+{
+	//Gather the whole bucket to SoA first, lanes are loaded long after they're written. Same type pairs are tested with
+	//rb2 as 'this', like the dispatch table does. Padding lanes never hit
+	size_t count = m_circleCircle.size();
+	size_t padded = (count + PIP_BATCH_LANES - 1) / PIP_BATCH_LANES * PIP_BATCH_LANES;
+	m_lanes.resize(padded * 6);
+	float* ax = m_lanes.data(), * ay = ax + padded, * ar = ay + padded, * bx = ar + padded, * by = bx + padded, * br = by + padded;
+	for (size_t i = 0; i < padded; i++)
+	{
+		if (i >= count)
+		{
+			ax[i] = ay[i] = ar[i] = by[i] = br[i] = 0;
+			bx[i] = 1;
+			continue;
+		}
+		size_t pairIdx = m_circleCircle[i];
+		Circle* a = static_cast<Circle*>(m_pairs[pairIdx * 2 + 1]);
+		Circle* b = static_cast<Circle*>(m_pairs[pairIdx * 2]);
+		ax[i] = a->m_position.x;
+		ay[i] = a->m_position.y;
+		ar[i] = a->m_radius;
+		bx[i] = b->m_position.x;
+		by[i] = b->m_position.y;
+		br[i] = b->m_radius;
+	}
+	for (size_t base = 0; base < count; base += PIP_BATCH_LANES)
+	{
+		size_t lanes = (count - base < PIP_BATCH_LANES) ? count - base : PIP_BATCH_LANES;
+		__m128 aX = _mm_loadu_ps(ax + base), aY = _mm_loadu_ps(ay + base), aR = _mm_loadu_ps(ar + base);
+		__m128 bX = _mm_loadu_ps(bx + base), bY = _mm_loadu_ps(by + base), bR = _mm_loadu_ps(br + base);
+		__m128 abX = _mm_sub_ps(bX, aX);
+		__m128 abY = _mm_sub_ps(bY, aY);
+		__m128 lengthSqr = _mm_add_ps(_mm_mul_ps(abX, abX), _mm_mul_ps(abY, abY));
+		__m128 rab = _mm_add_ps(aR, bR);
+		int hitMask = _mm_movemask_ps(_mm_cmple_ps(lengthSqr, _mm_mul_ps(rab, rab))) & ((1 << lanes) - 1);
+		//m_hits comes in cleared, misses are final here
+		if (!hitMask) continue;
+
+		__m128 length = _mm_sqrt_ps(lengthSqr);
+		alignas(16) float penetration[PIP_BATCH_LANES], nx[PIP_BATCH_LANES], ny[PIP_BATCH_LANES], cx[PIP_BATCH_LANES], cy[PIP_BATCH_LANES];
+		__m128 nX = _mm_div_ps(abX, length);
+		__m128 nY = _mm_div_ps(abY, length);
+		__m128 edge1X = _mm_add_ps(aX, _mm_mul_ps(nX, aR));
+		__m128 edge1Y = _mm_add_ps(aY, _mm_mul_ps(nY, aR));
+		__m128 edge2X = _mm_sub_ps(bX, _mm_mul_ps(nX, bR));
+		__m128 edge2Y = _mm_sub_ps(bY, _mm_mul_ps(nY, bR));
+		__m128 two = _mm_set1_ps(2.f);
+		_mm_store_ps(penetration, _mm_sub_ps(rab, length));
+		_mm_store_ps(nx, nX);
+		_mm_store_ps(ny, nY);
+		_mm_store_ps(cx, _mm_add_ps(edge1X, _mm_div_ps(_mm_sub_ps(edge2X, edge1X), two)));
+		_mm_store_ps(cy, _mm_add_ps(edge1Y, _mm_div_ps(_mm_sub_ps(edge2Y, edge1Y), two)));
+		for (size_t l = 0; l < lanes; l++)
+		{
+			if (!((hitMask >> l) & 1)) continue;
+			size_t pairIdx = m_circleCircle[base + l];
+			m_hits[pairIdx] = 1;
+			Manifold& manifold = m_results[pairIdx];
+			manifold = Manifold();
+			manifold.penetration = penetration[l];
+			manifold.normal = -Vector2(nx[l], ny[l]);//Point to A by convention
+			manifold.numContactPoints = 1;
+			manifold.contactPoints[0] = Vector2(cx[l], cy[l]);
+			manifold.rb1 = m_pairs[pairIdx * 2 + 1];
+			manifold.rb2 = m_pairs[pairIdx * 2];
+		}
+	}
+}
+
+template <>
+void BasicNarrowphaseBatch<float>::RunCircleObb()
+{
+	//Circle is always 'this', either order. Padding lanes are a zero radius circle outside a unit box
+	size_t count = m_circleObb.size();
+	size_t padded = (count + PIP_BATCH_LANES - 1) / PIP_BATCH_LANES * PIP_BATCH_LANES;
+	m_lanes.resize(padded * 9);
+	float* cpx = m_lanes.data(), * cpy = cpx + padded, * cr = cpy + padded, * bpx = cr + padded, * bpy = bpx + padded;
+	float* bc = bpy + padded, * bs = bc + padded, * bhx = bs + padded, * bhy = bhx + padded;
+	for (size_t i = 0; i < padded; i++)
+	{
+		if (i >= count)
+		{
+			cpy[i] = cr[i] = bpx[i] = bpy[i] = bs[i] = 0;
+			cpx[i] = 4;
+			bc[i] = bhx[i] = bhy[i] = 1;
+			continue;
+		}
+		size_t pairIdx = m_circleObb[i];
+		bool circleFirst = m_pairs[pairIdx * 2]->m_bodyType == BodyType::Circle;
+		Circle* circle = static_cast<Circle*>(m_pairs[pairIdx * 2 + (circleFirst ? 0 : 1)]);
+		OrientedBox* box = static_cast<OrientedBox*>(m_pairs[pairIdx * 2 + (circleFirst ? 1 : 0)]);
+		cpx[i] = circle->m_position.x;
+		cpy[i] = circle->m_position.y;
+		cr[i] = circle->m_radius;
+		bpx[i] = box->m_position.x;
+		bpy[i] = box->m_position.y;
+		bc[i] = box->m_rotationMatrix.c;
+		bs[i] = box->m_rotationMatrix.s;
+		bhx[i] = box->m_halfExtents.x;
+		bhy[i] = box->m_halfExtents.y;
+	}
+	const __m128 signBit = _mm_set1_ps(-0.f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 two = _mm_set1_ps(2.f);
+	for (size_t base = 0; base < count; base += PIP_BATCH_LANES)
+	{
+		size_t lanes = (count - base < PIP_BATCH_LANES) ? count - base : PIP_BATCH_LANES;
+		__m128 cX = _mm_loadu_ps(cpx + base), cY = _mm_loadu_ps(cpy + base), r = _mm_loadu_ps(cr + base);
+		__m128 bX = _mm_loadu_ps(bpx + base), bY = _mm_loadu_ps(bpy + base);
+		__m128 c = _mm_loadu_ps(bc + base), s = _mm_loadu_ps(bs + base);
+		__m128 hX = _mm_loadu_ps(bhx + base), hY = _mm_loadu_ps(bhy + base);
+		//Circle centre in box space
+		__m128 relX = _mm_sub_ps(cX, bX);
+		__m128 relY = _mm_sub_ps(cY, bY);
+		__m128 pX = _mm_add_ps(_mm_mul_ps(relX, c), _mm_mul_ps(relY, s));
+		__m128 pY = _mm_sub_ps(_mm_mul_ps(relY, c), _mm_mul_ps(relX, s));
+		__m128 absX = _mm_andnot_ps(signBit, pX);
+		__m128 absY = _mm_andnot_ps(signBit, pY);
+		__m128 inside = _mm_and_ps(_mm_cmple_ps(absX, hX), _mm_cmple_ps(absY, hY));
+
+		//Outside: clamp to the box, back to world space
+		__m128 qX = _mm_max_ps(_mm_xor_ps(hX, signBit), _mm_min_ps(pX, hX));
+		__m128 qY = _mm_max_ps(_mm_xor_ps(hY, signBit), _mm_min_ps(pY, hY));
+		__m128 wX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(qX, c), _mm_mul_ps(qY, s)), bX);
+		__m128 wY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qY, c), _mm_mul_ps(qX, s)), bY);
+		__m128 dX = _mm_sub_ps(wX, cX);
+		__m128 dY = _mm_sub_ps(wY, cY);
+		__m128 distSqr = _mm_add_ps(_mm_mul_ps(dX, dX), _mm_mul_ps(dY, dY));
+		__m128 hitOutside = _mm_cmple_ps(distSqr, _mm_mul_ps(r, r));
+		int hitMask = _mm_movemask_ps(_mm_or_ps(inside, hitOutside)) & ((1 << lanes) - 1);
+		//m_hits comes in cleared, misses are final here
+		if (!hitMask) continue;
+
+		__m128 dist = _mm_sqrt_ps(distSqr);
+		__m128 outNX = _mm_div_ps(dX, dist);
+		__m128 outNY = _mm_div_ps(dY, dist);
+		__m128 outPenetration = _mm_sub_ps(r, dist);
+		__m128 outContactX = _mm_div_ps(_mm_add_ps(_mm_add_ps(cX, _mm_mul_ps(r, outNX)), wX), two);
+		__m128 outContactY = _mm_div_ps(_mm_add_ps(_mm_add_ps(cY, _mm_mul_ps(r, outNY)), wY), two);
+
+		//Inside: push out through the closest face
+		__m128 faceDX = _mm_sub_ps(hX, absX);
+		__m128 faceDY = _mm_sub_ps(hY, absY);
+		__m128 useX = _mm_cmplt_ps(faceDX, faceDY);
+		__m128 signX = Select(_mm_cmplt_ps(pX, zero), _mm_xor_ps(one, signBit), one);
+		__m128 signY = Select(_mm_cmplt_ps(pY, zero), _mm_xor_ps(one, signBit), one);
+		__m128 faceNX = Select(useX, signX, zero);
+		__m128 faceNY = Select(useX, zero, signY);
+		__m128 facePX = Select(useX, _mm_mul_ps(faceNX, hX), pX);
+		__m128 facePY = Select(useX, pY, _mm_mul_ps(faceNY, hY));
+		__m128 inPenetration = _mm_add_ps(r, Select(useX, faceDX, faceDY));
+		__m128 inNX = _mm_sub_ps(_mm_mul_ps(faceNX, c), _mm_mul_ps(faceNY, s));
+		__m128 inNY = _mm_add_ps(_mm_mul_ps(faceNY, c), _mm_mul_ps(faceNX, s));
+		__m128 inContactX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(facePX, c), _mm_mul_ps(facePY, s)), bX);
+		__m128 inContactY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(facePY, c), _mm_mul_ps(facePX, s)), bY);
+
+		//Outside normals are negated when written, inside ones aren't
+		alignas(16) float penetration[PIP_BATCH_LANES], nx[PIP_BATCH_LANES], ny[PIP_BATCH_LANES], px[PIP_BATCH_LANES], py[PIP_BATCH_LANES];
+		_mm_store_ps(penetration, Select(inside, inPenetration, outPenetration));
+		_mm_store_ps(nx, Select(inside, inNX, _mm_xor_ps(outNX, signBit)));
+		_mm_store_ps(ny, Select(inside, inNY, _mm_xor_ps(outNY, signBit)));
+		_mm_store_ps(px, Select(inside, inContactX, outContactX));
+		_mm_store_ps(py, Select(inside, inContactY, outContactY));
+		for (size_t l = 0; l < lanes; l++)
+		{
+			if (!((hitMask >> l) & 1)) continue;
+			size_t pairIdx = m_circleObb[base + l];
+			bool circleFirst = m_pairs[pairIdx * 2]->m_bodyType == BodyType::Circle;
+			m_hits[pairIdx] = 1;
+			Manifold& manifold = m_results[pairIdx];
+			manifold = Manifold();
+			manifold.penetration = penetration[l];
+			manifold.normal = Vector2(nx[l], ny[l]);
+			manifold.numContactPoints = 1;
+			manifold.contactPoints[0] = Vector2(px[l], py[l]);
+			manifold.rb1 = m_pairs[pairIdx * 2 + (circleFirst ? 0 : 1)];
+			manifold.rb2 = m_pairs[pairIdx * 2 + (circleFirst ? 1 : 0)];
+		}
+	}
+}
+#endif
+
+template class BasicNarrowphaseBatch<float>;
+template class BasicNarrowphaseBatch<fp64::Fp64>;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "PipMath.h"
+#include "Rigidbody.h"
+#include "TaskScheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIP_SSE 1
+#else
+#define PIP_SSE 0
+#endif
+
+//Narrowphase for a whole step's broadphase pairs. Pairs are bucketed by shape combination, circle-circle and circle-obb
+//run through 4 wide SSE kernels on float worlds, everything else (and every pair on scalar fallback builds) goes
+//through IntersectPair. Hits come out in the order pairs were added, so the response order doesn't change
+template <typename T>
+class BasicNarrowphaseBatch
+{
+public:
+	PIP_SCALAR_TYPES(T)
+
+	void Clear();//Keeps capacity, a step's batch doesn't allocate once warmed up
+	void AddPair(Rigidbody* rb1, Rigidbody* rb2);
+	size_t GetByteSize();//Capacity of its buffers
+	//Appends a manifold per hit, returns number of hits. Pairs outside the SIMD buckets are spread over scheduler
+	size_t Run(std::vector<Manifold>& manifolds, TaskScheduler* scheduler = nullptr);
+private:
+	void RunCircleCircle();
+	void RunCircleObb();
+public:
+	std::vector<Rigidbody*> m_pairs;//rb1, rb2 interleaved
+	std::vector<size_t> m_circleCircle;//Pair idx per bucket
+	std::vector<size_t> m_circleObb;
+	std::vector<size_t> m_other;
+	std::vector<char> m_hits;//Per pair
+	std::vector<Manifold> m_results;//Per pair, only valid where m_hits is set
+	std::vector<T> m_lanes;//SoA scratch for the SIMD kernels
+};
+typedef BasicNarrowphaseBatch<decimal> NarrowphaseBatch;
+
+#if PIP_SSE
+template <> void BasicNarrowphaseBatch<float>::RunCircleCircle();
+template <> void BasicNarrowphaseBatch<float>::RunCircleObb();
+#endif
@@ -2,104 +2,104 @@
 
 #include "Circle.h"
 #include "Capsule.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
 
 using namespace PipMath;
 
-OrientedBox::OrientedBox(Vector2 halfExtents, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass,
+template <typename T>
+BasicOrientedBox<T>::BasicOrientedBox(Vector2 halfExtents, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass,
 	decimal e, bool isKinematic)
 	: m_halfExtents(halfExtents), Rigidbody(pos, rot, vel, angVel, mass, e, isKinematic)
 {
 	m_bodyType = BodyType::Obb;
+	for (int i = 0; i < PIP_SAT_AXIS_CACHE_SLOTS; i++) m_satAxisCache[i].Clear();
 	//Find inertia tensor formula for an oriented box (Derived from capsule's)
 	m_inertia = m_mass * (Pow(m_halfExtents.x * 2, 2) + Pow(m_halfExtents.y * 2, 2)) / 12;
 }
 
-OrientedBox::~OrientedBox()
+template <typename T>
+BasicOrientedBox<T>::~BasicOrientedBox()
 {
 }
 //Intersect AABB for Quad Nodes (Simplified SAT?)
-bool OrientedBox::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(Vector2 topRight, Vector2 bottomLeft)
 {
-	Vector2 rotExtents = m_halfExtents.Rotated(m_rotation);
+	Vector2 halfX = Vector2(m_halfExtents.x, 0).Rotate(m_rotationMatrix);
+	Vector2 halfY = Vector2(0, m_halfExtents.y).Rotate(m_rotationMatrix);
 	Vector2 quadCenter = topRight + (bottomLeft - topRight) / 2;
+	Vector2 quadExtents = topRight - quadCenter;
+	Vector2 quadHalfX = Vector2(quadExtents.x, 0);
+	Vector2 quadHalfY = Vector2(0, quadExtents.y);
 	decimal dummyPenetration;
 	Vector2 axis = Vector2(1, 0);
-	if (!TestAxis(axis, m_position, quadCenter, rotExtents, topRight, dummyPenetration)) return false;
+	if (!TestAxis(axis, m_position, quadCenter, halfX, halfY, quadHalfX, quadHalfY, dummyPenetration)) return false;
 	axis = Vector2(0, 1);
-	if (!TestAxis(axis, m_position, quadCenter, rotExtents, topRight, dummyPenetration)) return false;
-	axis = Vector2(1, 0).Rotate(m_rotation);
-	if (!TestAxis(axis, m_position, quadCenter, rotExtents, topRight, dummyPenetration)) return false;
-	axis = Vector2(0, 1).Rotate(m_rotation);
-	if (!TestAxis(axis, m_position, quadCenter, rotExtents, topRight, dummyPenetration)) return false;
+	if (!TestAxis(axis, m_position, quadCenter, halfX, halfY, quadHalfX, quadHalfY, dummyPenetration)) return false;
+	axis = Vector2(1, 0).Rotate(m_rotationMatrix);
+	if (!TestAxis(axis, m_position, quadCenter, halfX, halfY, quadHalfX, quadHalfY, dummyPenetration)) return false;
+	axis = Vector2(0, 1).Rotate(m_rotationMatrix);
+	if (!TestAxis(axis, m_position, quadCenter, halfX, halfY, quadHalfX, quadHalfY, dummyPenetration)) return false;
 	return true;
 }
 
-bool OrientedBox::IntersectWith(Rigidbody* rb2, Manifold& manifold)
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(Rigidbody* rb2, Manifold& manifold)
 {
 	return rb2->IntersectWith(this, manifold);
 }
 
-bool OrientedBox::IntersectWith(Circle* rb2, Manifold& manifold)
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(Circle* rb2, Manifold& manifold)
 {
 	//ClosestPtCircleToObb query
 	return rb2->IntersectWith(this, manifold);
 }
 
-bool OrientedBox::IntersectWith(Capsule* rb2, Manifold& manifold)
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(Capsule* rb2, Manifold& manifold)
 {
 	return rb2->IntersectWith(this, manifold);
 }
 
-bool OrientedBox::IntersectWith(OrientedBox* rb2, Manifold& manifold)
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 {
 	//SAT
 	//We only have 4 axis to project to, but we can simplify it by bringing things to one Obb's reference frame
 	Vector2 aToB = rb2->m_position - m_position;
-	Vector2 rotExtents = m_halfExtents.Rotated(m_rotation);
-	Vector2 rotExtents2 = rb2->m_halfExtents.Rotated(rb2->m_rotation);
+	//rb1's axii, then rb2's
+	Vector2 axes[4] = { Vector2(1, 0).Rotate(m_rotationMatrix), Vector2(0, 1).Rotate(m_rotationMatrix),
+		Vector2(1, 0).Rotate(rb2->m_rotationMatrix), Vector2(0, 1).Rotate(rb2->m_rotationMatrix) };
+	Vector2 halfX = axes[0] * m_halfExtents.x;
+	Vector2 halfY = axes[1] * m_halfExtents.y;
+	Vector2 halfX2 = axes[2] * rb2->m_halfExtents.x;
+	Vector2 halfY2 = axes[3] * rb2->m_halfExtents.y;
+	//Last separating axis against rb2 goes first, a pair that's still apart exits after one projection
+	SatAxisCache& cache = m_satAxisCache[((uintptr_t)rb2 / sizeof(OrientedBox)) & (PIP_SAT_AXIS_CACHE_SLOTS - 1)];
+	int axisHint = cache.GetAxis(rb2);
+	decimal hintPenetration;
+	if (axisHint >= 0 && !TestAxis(axes[axisHint], m_position, rb2->m_position, halfX, halfY, halfX2, halfY2, hintPenetration)) return false;
 	//Possibly add ref arguments to retrieve contact data (amount of penetration,..)
+	//Axii are still compared in order, so the hint never changes which one wins a tie
 	decimal minPen;
 	Vector2 minAxis;
-	Vector2 axis;
 	decimal penetration;
 	SatCollision collisionType;
-	//rb1's axii
-	axis = Vector2(1, 0).Rotate(m_rotation);
-	if (TestAxis(axis, m_position, rb2->m_position, rotExtents, rotExtents2, penetration)) {
-		//Store penetration and axis
-		minPen = penetration;
-		minAxis = axis;
-		collisionType = SatCollision::OBJ1;
-	}
-	else return false;
-	axis = Vector2(0, 1).Rotate(m_rotation);
-	if (TestAxis( axis, m_position, rb2->m_position, rotExtents, rotExtents2, penetration)) {
-		if (penetration < minPen) {
-			minPen = penetration;
-			minAxis = axis;
-			collisionType = SatCollision::OBJ1;
-		}
-	} 
-	else return false;
-	//rb2's axii
-	axis = Vector2(1, 0).Rotate(rb2->m_rotation);
-	if (TestAxis( axis, m_position, rb2->m_position, rotExtents, rotExtents2, penetration)) {
-		if (penetration < minPen) {
-			minPen = penetration;
-			minAxis = axis;
-			collisionType = SatCollision::OBJ2;
+	for (int i = 0; i < 4; i++) {
+		if (i == axisHint) penetration = hintPenetration;
+		else if (!TestAxis(axes[i], m_position, rb2->m_position, halfX, halfY, halfX2, halfY2, penetration)) {
+			cache.Set(rb2, i);
+			return false;
 		}
-	} 
-	else return false;
-	axis = Vector2(0, 1).Rotate(rb2->m_rotation);
-	if (TestAxis( axis, m_position, rb2->m_position, rotExtents, rotExtents2, penetration)) {
-		if (penetration < minPen) {
+		if (i == 0 || penetration < minPen) {
+			//Store penetration and axis
 			minPen = penetration;
-			minAxis = axis;
-			collisionType = SatCollision::OBJ2;
+			minAxis = axes[i];
+			collisionType = (i < 2) ? SatCollision::OBJ1 : SatCollision::OBJ2;
 		}
 	}
-	else return false;
 
 	//#Contact retrieval
 	//We may need to know which face the axis comes from, as well as the side planes, so that we can build a plane and clip the incident face against it
@@ -110,9 +110,9 @@ bool OrientedBox::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 	case SatCollision::OBJ1: 
 	{
 		//Build reference planes
-		planeNormals[0] = Vector2(1, 0).Rotate(m_rotation);
+		planeNormals[0] = Vector2(1, 0).Rotate(m_rotationMatrix);
 		planeNormals[1] = -planeNormals[0];
-		planeNormals[2] = Vector2(0, 1).Rotate(m_rotation);
+		planeNormals[2] = Vector2(0, 1).Rotate(m_rotationMatrix);
 		planeNormals[3] = -planeNormals[2];
 		
 		planeDists[0] = (m_position + m_halfExtents.x * planeNormals[0]).Dot(planeNormals[0]);
@@ -120,17 +120,14 @@ bool OrientedBox::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 		planeDists[2] = (m_position + m_halfExtents.y * planeNormals[2]).Dot(planeNormals[2]);
 		planeDists[3] = (m_position + m_halfExtents.y * planeNormals[3]).Dot(planeNormals[3]);
 		//Points to clip (Need to be in order for clipping to work!)
-		boxPoints[0] = rb2->m_position + rotExtents2;
-		boxPoints[1] = rb2->m_position + rotExtents2.Perp();
-		boxPoints[2] = rb2->m_position - rotExtents2;
-		boxPoints[3] = rb2->m_position - rotExtents2.Perp();
+		rb2->GetCorners(boxPoints);
 	}
 	break;
 	case SatCollision::OBJ2:
 	{
-		planeNormals[0] = Vector2(1, 0).Rotate(rb2->m_rotation);
+		planeNormals[0] = Vector2(1, 0).Rotate(rb2->m_rotationMatrix);
 		planeNormals[1] = -planeNormals[0];
-		planeNormals[2] = Vector2(0, 1).Rotate(rb2->m_rotation);
+		planeNormals[2] = Vector2(0, 1).Rotate(rb2->m_rotationMatrix);
 		planeNormals[3] = -planeNormals[2];
 
 		planeDists[0] = (rb2->m_position + rb2->m_halfExtents.x * planeNormals[0]).Dot(planeNormals[0]);
@@ -138,10 +135,7 @@ bool OrientedBox::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 		planeDists[2] = (rb2->m_position + rb2->m_halfExtents.y * planeNormals[2]).Dot(planeNormals[2]);
 		planeDists[3] = (rb2->m_position + rb2->m_halfExtents.y * planeNormals[3]).Dot(planeNormals[3]);
 
-		boxPoints[0] = m_position + rotExtents;
-		boxPoints[1] = m_position + rotExtents.Perp();
-		boxPoints[2] = m_position - rotExtents;
-		boxPoints[3] = m_position - rotExtents.Perp();
+		GetCorners(boxPoints);
 	}
 	break;
 	}
@@ -167,6 +161,8 @@ bool OrientedBox::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 			}
 		}
 
+		//Manifold holds up to two points, an incident box fully inside the reference box would clip all four
+		if (manifold.numContactPoints >= 2) break;
 		if (!ptIn)
 		{
 			if (nextPtIn) {
@@ -185,47 +181,115 @@ bool OrientedBox::IntersectWith(OrientedBox* rb2, Manifold& manifold)
 	manifold.rb1 = this;
 	manifold.rb2 = rb2;
 	manifold.normal = minAxis.Dot(aToB) > 0 ? -minAxis : minAxis;
+	if (!manifold.numContactPoints)
+	{
+		//Short reference face resting on a longer incident one: the reference corners inside the incident box touch
+		OrientedBox* incident = (collisionType == SatCollision::OBJ1) ? rb2 : this;
+		Vector2 referencePoints[4];
+		((collisionType == SatCollision::OBJ1) ? this : rb2)->GetCorners(referencePoints);
+		for (int i = 0; i < 4 && manifold.numContactPoints < 2; i++) {
+			Vector2 local = (referencePoints[i] - incident->m_position).InvRotate(incident->m_rotationMatrix);
+			if (Abs(local.x) > incident->m_halfExtents.x || Abs(local.y) > incident->m_halfExtents.y) continue;
+			manifold.contactPoints[manifold.numContactPoints] = referencePoints[i];
+			manifold.numContactPoints++;
+		}
+	}
+	if (!manifold.numContactPoints)
+	{
+		//Edges crossing without any corner inside the other box, use the deepest incident corner
+		//Normal points to A: incident rb2 corners go deepest along it, incident rb1 corners against it
+		decimal sign = (collisionType == SatCollision::OBJ1) ? 1 : -1;
+		int deepest = 0;
+		for (int i = 1; i < 4; i++) {
+			if (sign * boxPoints[i].Dot(manifold.normal) > sign * boxPoints[deepest].Dot(manifold.normal)) deepest = i;
+		}
+		manifold.contactPoints[0] = boxPoints[deepest];
+		manifold.numContactPoints = 1;
+	}
 	manifold.penetration = minPen;
 	return true;
 }
 
-decimal OrientedBox::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(ConvexPolygon* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+bool BasicOrientedBox<T>::IntersectWith(Compound* rb2, Manifold& manifold)
+{
+	return rb2->IntersectWith(this, manifold);
+}
+
+template <typename T>
+T BasicOrientedBox<T>::SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold)
 {
 	return rb2->SweepWith(this, dt, manifold);
 }
 
-decimal OrientedBox::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicOrientedBox<T>::SweepWith(Circle* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+T BasicOrientedBox<T>::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
 
-decimal OrientedBox::SweepWith(Capsule* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicOrientedBox<T>::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
 
-decimal OrientedBox::SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold)
+template <typename T>
+T BasicOrientedBox<T>::SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold)
 {
 	return decimal();
 }
 
-bool OrientedBox::TestAxis(Vector2 axis, Vector2 pos1, Vector2 pos2, Vector2 rotExtents, Vector2 rotExtents2, decimal& penetration)
+template <typename T>
+T BasicOrientedBox<T>::SweepWith(Compound* rb2, decimal dt, Manifold& manifold)
+{
+	return decimal();
+}
+
+template <typename T>
+void BasicOrientedBox<T>::GetCorners(Vector2 corners[4])
+{
+	Vector2 halfX = Vector2(m_halfExtents.x, 0).Rotate(m_rotationMatrix);
+	Vector2 halfY = Vector2(0, m_halfExtents.y).Rotate(m_rotationMatrix);
+	corners[0] = m_position + halfX + halfY;
+	corners[1] = m_position - halfX + halfY;
+	corners[2] = m_position - halfX - halfY;
+	corners[3] = m_position + halfX - halfY;
+}
+
+template <typename T>
+void BasicOrientedBox<T>::ComputeAabb(Vector2& topRight, Vector2& bottomLeft)
+{
+	Vector2 halfX = Vector2(m_halfExtents.x, 0).Rotate(m_rotationMatrix);
+	Vector2 halfY = Vector2(0, m_halfExtents.y).Rotate(m_rotationMatrix);
+	Vector2 extents = Vector2(Abs(halfX.x) + Abs(halfY.x), Abs(halfX.y) + Abs(halfY.y));
+	topRight = m_position + extents;
+	bottomLeft = m_position - extents;
+}
+
+template <typename T>
+bool BasicOrientedBox<T>::TestAxis(Vector2 axis, Vector2 pos1, Vector2 pos2, Vector2 halfX, Vector2 halfY, Vector2 halfX2, Vector2 halfY2,
+ decimal& penetration)
 {
 	decimal pos1Axis = pos1.Dot(axis);
 	decimal pos2Axis = pos2.Dot(axis);
-	Vector2 p[4]{ rotExtents, -rotExtents, rotExtents.Perp(), -rotExtents.Perp() };
-	Vector2 p2[4]{ rotExtents2, -rotExtents2, rotExtents2.Perp(), -rotExtents2.Perp() };
-	decimal min = 0, max = 0;
-	decimal min2 = 0, max2 = 0;
-
-	for (int i = 0; i < 4; i++) {
-		decimal projection = p[i].Dot(axis);
-		decimal projection2 = p2[i].Dot(axis);
-		if (projection < min) min = projection;
-		if (projection > max) max = projection;
-		if (projection2 < min2) min2 = projection2;
-		if (projection2 > max2) max2 = projection2;
-	}
+	//Boxes are symmetric about their centre, projected radius is the sum of the projected half axii
+	decimal max = Abs(halfX.Dot(axis)) + Abs(halfY.Dot(axis));
+	decimal max2 = Abs(halfX2.Dot(axis)) + Abs(halfY2.Dot(axis));
+	decimal min = -max;
+	decimal min2 = -max2;
 
 	if (pos1Axis <= pos2Axis)
 	{
@@ -253,3 +317,6 @@ bool OrientedBox::TestAxis(Vector2 axis, Vector2 pos1, Vector2 pos2, Vector2 rot
 		}
 	}
 }
+
+template class BasicOrientedBox<float>;
+template class BasicOrientedBox<fp64::Fp64>;
@@ -1,34 +1,73 @@
 #pragma once
 
+#include <atomic>
+#include <stdint.h>
+
 #include "Rigidbody.h"
 
+#define PIP_SAT_AXIS_CACHE_SLOTS 4//Power of two
+
 //May get more complex in the future? All we need for now, just to know which object to clip against which
 enum class SatCollision {
 	OBJ1,
 	OBJ2
 };
 
-class OrientedBox :
-	public Rigidbody
+template <typename T>
+class BasicOrientedBox :
+	public BasicRigidbody<T>
 {
 public:
-	OrientedBox(PipMath::Vector2 halfExtents = PipMath::Vector2(1.f, 1.f), PipMath::Vector2 pos = PipMath::Vector2(),
-	 decimal rot = 0.0f, PipMath::Vector2 vel = PipMath::Vector2(),
+	PIP_SCALAR_TYPES(T)
+	PIP_RIGIDBODY_MEMBERS
+
+	BasicOrientedBox(Vector2 halfExtents = Vector2(1.f, 1.f), Vector2 pos = Vector2(),
+	 decimal rot = 0.0f, Vector2 vel = Vector2(),
 		decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
-	~OrientedBox();
-	virtual bool IntersectWith(PipMath::Vector2 topRight, PipMath::Vector2 bottomLeft) override;
-	virtual bool IntersectWith(Rigidbody* rb2, PipMath::Manifold& manifold) override;
-	virtual bool IntersectWith(Circle* rb2, PipMath::Manifold& manifold) override;
-	virtual bool IntersectWith(Capsule* rb2, PipMath::Manifold& manifold) override;
-	virtual bool IntersectWith(OrientedBox* rb2, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(Circle* rb2, decimal dt, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(Capsule* rb2, decimal dt, PipMath::Manifold& manifold) override;
-	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, PipMath::Manifold& manifold) override;
+	~BasicOrientedBox();
+	virtual bool IntersectWith(Vector2 topRight, Vector2 bottomLeft) override;
+	virtual bool IntersectWith(Rigidbody* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Circle* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Capsule* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(OrientedBox* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(ConvexPolygon* rb2, Manifold& manifold) override;
+	virtual bool IntersectWith(Compound* rb2, Manifold& manifold) override;
+	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Circle* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Capsule* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold) override;
+	virtual decimal SweepWith(Compound* rb2, decimal dt, Manifold& manifold) override;
+	virtual void ComputeAabb(Vector2& topRight, Vector2& bottomLeft) override;
+	void GetCorners(Vector2 corners[4]);//World space, counter clockwise starting at the +x +y corner
 private:
 	//#possibly apply Strategy design pattern?
-	bool TestAxis(PipMath::Vector2 axis, PipMath::Vector2 pos1, PipMath::Vector2 pos2, PipMath::Vector2 rotExtents,
-	 PipMath::Vector2 rotExtents2, decimal& penetration);
+	bool TestAxis(Vector2 axis, Vector2 pos1, Vector2 pos2, Vector2 halfX, Vector2 halfY, Vector2 halfX2, Vector2 halfY2,
+	 decimal& penetration);
 public:
-	PipMath::Vector2 m_halfExtents;
+	//Last separating axis (0-3) against a recent partner, direct mapped by its address. Only a hint to test that axis
+	//first, a stale or evicted slot costs an extra projection but never changes a result. Partner and axis share a word,
+	//pairs with this box tested on other threads can overwrite a slot but never leave it half written
+	struct SatAxisCache
+	{
+		SatAxisCache() : packed(0) {}
+		SatAxisCache(const SatAxisCache& other) : packed(other.packed.load(std::memory_order_relaxed)) {}
+		SatAxisCache& operator=(const SatAxisCache& other)
+		{
+			packed.store(other.packed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return *this;
+		}
+		int GetAxis(OrientedBox* partner) const//-1 unless the slot holds partner
+		{
+			uintptr_t value = packed.load(std::memory_order_relaxed);
+			return (value && (value & ~(uintptr_t)3) == (uintptr_t)partner) ? (int)(value & 3) : -1;
+		}
+		void Set(OrientedBox* partner, int axis) { packed.store((uintptr_t)partner | (uintptr_t)axis, std::memory_order_relaxed); }
+		void Clear() { packed.store(0, std::memory_order_relaxed); }
+		std::atomic<uintptr_t> packed;//Partner address with the axis in its low 2 bits, bodies are aligned to more than 4
+	};
+
+	Vector2 m_halfExtents;
+	SatAxisCache m_satAxisCache[PIP_SAT_AXIS_CACHE_SLOTS];
 };
+typedef BasicOrientedBox<decimal> OrientedBox;
@@ -12,102 +12,211 @@
 #define RAD2DEG 180/(PI)
  
 //Inline Base Math, Vector, Matrix, Quaternion library
+//The engine is templated on its scalar, float and fp64::Fp64 are both instantiated.
+//USE_FIXEDPOINT only picks the scalar behind the 'decimal' typedefs (Solver, Vector2, Circle...)
 #if USE_FIXEDPOINT
 typedef fp64::Fp64 decimal;
 #else
 typedef float decimal;
 #endif
 
-class Rigidbody;//Manifold needs fwdecl
+template <typename T> class BasicRigidbody;//Manifold needs fwdecl
 
 namespace PipMath 
 {
+	//Scalar functions, one overload per scalar type
+	inline float Abs(float x) 
+	{
+		return std::abs(x);
+	}
 
-	inline decimal Abs(decimal x) 
+	inline fp64::Fp64 Abs(fp64::Fp64 x) 
 	{
-#if USE_FIXEDPOINT
 		return fp64::Fp64::Abs(x);
-#else 
-		return std::abs(x);
-#endif
 	}
 
-	inline decimal Min(decimal x, decimal max) 
+	inline float Min(float x, float max) 
 	{
 		return x < max ? x : max;
 	}
 
-	inline decimal Max(decimal x, decimal min) 
+	inline fp64::Fp64 Min(fp64::Fp64 x, fp64::Fp64 max) 
+	{
+		return x < max ? x : max;
+	}
+
+	inline float Max(float x, float min) 
 	{
 		return x > min ? x : min;
 	}
 
-	inline decimal Clamp(decimal x, decimal min, decimal max) 
+	inline fp64::Fp64 Max(fp64::Fp64 x, fp64::Fp64 min) 
+	{
+		return x > min ? x : min;
+	}
+
+	inline float Clamp(float x, float min, float max) 
 	{
-#if USE_FIXEDPOINT
-		return Max(min, Min(x, max));
-#else
 		return fmaxf(min, fminf(x, max));
-#endif
 	}
 
-	inline decimal Sqrt(decimal x) 
+	inline fp64::Fp64 Clamp(fp64::Fp64 x, fp64::Fp64 min, fp64::Fp64 max) 
+	{
+		return Max(min, Min(x, max));
+	}
+
+	inline float Sqrt(float x) 
 	{
-#if USE_FIXEDPOINT
-		return fp64::Fp64::EasySqrt(x);
-#else
 		return sqrt(x);
-#endif
 	}
 
-	inline decimal Pow(decimal x, unsigned short exponent) 
+	inline fp64::Fp64 Sqrt(fp64::Fp64 x) 
+	{
+		return fp64::Fp64::FastSqrt(x);
+	}
+
+	inline float InvSqrt(float x)
+	{
+		return 1.f / sqrt(x);
+	}
+
+	//0 for x <= 0
+	inline fp64::Fp64 InvSqrt(fp64::Fp64 x)
+	{
+		return fp64::Fp64::FastReciprocalSqrt(x);
+	}
+
+	inline float Pow(float x, unsigned short exponent) 
 	{
-#if USE_FIXEDPOINT
-		return fp64::Fp64::Pow(x, exponent);
-#else
 		return powf(x, exponent);
-#endif
 	}
 
-	inline decimal Cos(decimal rad) 
+	inline fp64::Fp64 Pow(fp64::Fp64 x, unsigned short exponent) 
+	{
+		return fp64::Fp64::Pow(x, exponent);
+	}
+
+	inline float Cos(float rad) 
 	{
-#if USE_FIXEDPOINT
-		return fp64::Fp64::Cos(rad);
-#else
 		return cos(rad);
-#endif
 	}
 
-	inline decimal Sin(decimal rad) 
+	inline fp64::Fp64 Cos(fp64::Fp64 rad) 
+	{
+		return fp64::Fp64::FastCos(rad);
+	}
+
+	inline float Sin(float rad) 
 	{
-#if USE_FIXEDPOINT
-		return fp64::Fp64::Sin(rad);
-#else 
 		return sin(rad);
-#endif
 	}
 
-	inline decimal Tan(decimal rad)
+	inline fp64::Fp64 Sin(fp64::Fp64 rad) 
+	{
+		return fp64::Fp64::FastSin(rad);
+	}
+
+	inline float Tan(float rad)
 	{
-#if USE_FIXEDPOINT
-		return fp64::Fp64::Sin(rad) / fp64::Fp64::Cos(rad);
-#else
 		return tan(rad);
-#endif
+	}
+
+	inline fp64::Fp64 Tan(fp64::Fp64 rad)
+	{
+		fp64::Fp64 s, c;
+		fp64::Fp64::FastSinCos(rad, s, c);
+		return s / c;
+	}
+
+	inline void SinCos(float rad, float& s, float& c)
+	{
+		s = sin(rad);
+		c = cos(rad);
+	}
+
+	//One range reduction for both
+	inline void SinCos(fp64::Fp64 rad, fp64::Fp64& s, fp64::Fp64& c)
+	{
+		fp64::Fp64::FastSinCos(rad, s, c);
+	}
+
+	inline float Atan2(float y, float x)
+	{
+		return atan2(y, x);
+	}
+
+	inline fp64::Fp64 Atan2(fp64::Fp64 y, fp64::Fp64 x)
+	{
+		return fp64::Fp64::Atan2(y, x);
+	}
+
+	//Normalisation: fixed point multiplies by InvSqrt (one division instead of two, zero vectors stay zero),
+	//float keeps dividing by the length so its results don't change
+	inline void NormalizeComponents(float& x, float& y)
+	{
+		float length = Sqrt(x * x + y * y);
+		x /= length;
+		y /= length;
+	}
+
+	inline void NormalizeComponents(fp64::Fp64& x, fp64::Fp64& y)
+	{
+		fp64::Fp64 invLength = InvSqrt(x * x + y * y);
+		x *= invLength;
+		y *= invLength;
 	}
 	
+	//2x2 rotation matrix [c -s; s c], only the first column is stored. Lets bodies pay for trig once per step
+	template <typename T>
+	struct BasicMat2
+	{
+		T c, s;
+
+		BasicMat2()
+			: c(1.f), s(0.f)
+		{
+		}
+
+		explicit BasicMat2(T rad)
+		{
+			SinCos(rad, s, c);
+		}
+
+		inline BasicMat2 Transposed() const
+		{
+			BasicMat2 t;
+			t.c = c;
+			t.s = -s;
+			return t;
+		}
+
+		//Rotation by both, same as Mat2(a + b) without the trig
+		inline BasicMat2 operator*(const BasicMat2& rhs) const
+		{
+			BasicMat2 r;
+			r.c = c * rhs.c - s * rhs.s;
+			r.s = s * rhs.c + c * rhs.s;
+			return r;
+		}
+	};
+	typedef BasicMat2<decimal> Mat2;
+
 	struct Vector3;
-	struct Vector2 
+	template <typename T>
+	struct BasicVector2 
 	{
+		typedef BasicVector2 Vector2;
+		typedef BasicMat2<T> Mat2;
+		typedef T decimal;
 
 		decimal x, y;
 
-		Vector2()
+		BasicVector2()
 			: x(0.f), y(0.f)
 		{
 		}
 
-		Vector2(decimal x, decimal y)
+		BasicVector2(decimal x, decimal y)
 			: x(x), y(y) 
 		{
 		}
@@ -136,9 +245,15 @@ namespace PipMath
 			return Vector2(-x, -y);
 		}
 
-		inline friend Vector2 operator*(const Vector2& v, const decimal& scalar);
+		inline friend Vector2 operator*(const Vector2& v, const decimal& scalar)
+		{
+			return Vector2(v.x * scalar, v.y * scalar);
+		}
 
-		inline friend Vector2 operator*(const decimal& scalar, const Vector2& v);
+		inline friend Vector2 operator*(const decimal& scalar, const Vector2& v)
+		{
+			return v * scalar;
+		}
 
 		inline Vector2 operator/(const decimal& scalar) const
 		{
@@ -192,16 +307,14 @@ namespace PipMath
 
 		inline Vector2 Normalize() 
 		{
-			decimal length = Length();
-			x /= length;
-			y /= length;
+			NormalizeComponents(x, y);
 			return *this;
 		}
 		
 		inline Vector2 Normalized() 
 		{
-			decimal length = Length();
-			return Vector2(x / length, y / length);
+			Vector2 copy = *this;
+			return copy.Normalize();
 		}
 		
 		inline decimal LengthSqr()
@@ -229,6 +342,32 @@ namespace PipMath
 			return *this;
 		}
 
+		//Same as Rotate(rad) with a precomputed Mat2(rad)
+		inline Vector2 Rotated(const Mat2& rot) const
+		{
+			Vector2 copy = *this;
+			return copy.Rotate(rot);
+		}
+
+		inline Vector2 Rotate(const Mat2& rot)
+		{
+			decimal x2 = x * rot.c - y * rot.s;
+			decimal y2 = y * rot.c + x * rot.s;
+			x = x2;
+			y = y2;
+			return *this;
+		}
+
+		//Rotate by the inverse (transpose), Rotate(-rad)
+		inline Vector2 InvRotate(const Mat2& rot)
+		{
+			decimal x2 = x * rot.c + y * rot.s;
+			decimal y2 = y * rot.c - x * rot.s;
+			x = x2;
+			y = y2;
+			return *this;
+		}
+
 		inline decimal Dot(Vector2 v2) 
 		{
 			return x * v2.x + y * v2.y;//Same as LengthSqr if passing same vector
@@ -239,36 +378,26 @@ namespace PipMath
 			return (x * v2.y) - (y * v2.x);
 		}
 	};
+	typedef BasicVector2<decimal> Vector2;
 
-
-	inline Vector2 operator*( const Vector2& v, const decimal& scalar ) 
-	{
-		return Vector2(v.x * scalar, v.y * scalar);
-	}
-
-	inline Vector2 operator*( const decimal& scalar, const Vector2& v )
-	{
-		return v * scalar;
-	}
-
-	inline std::ostream& operator << (std::ostream& out, const Vector2& v)
+	template <typename T>
+	inline std::ostream& operator << (std::ostream& out, const BasicVector2<T>& v)
 	{
 		out << "x(" << (float)v.x << ")" << " y(" << (float)v.y << ")";
 		return out;
 	}
 	
-#if USE_FIXEDPOINT
-	inline std::ostream& operator << (std::ostream& out, const decimal& v)
+	inline std::ostream& operator << (std::ostream& out, const fp64::Fp64& v)
 	{
 		out << (float)v;
 		return out;
 	}
-#else
-#endif
 
 	//Return point in segment ab closest to point p
-	inline Vector2 ClosestPtToSegment(Vector2 a, Vector2 b, Vector2 p)
+	template <typename T>
+	inline BasicVector2<T> ClosestPtToSegment(BasicVector2<T> a, BasicVector2<T> b, BasicVector2<T> p)
 	{
+		typedef BasicVector2<T> Vector2;
 		Vector2 ab = b - a;
 		Vector2 ap = p - a;
 		Vector2 bp = p - b;
@@ -290,8 +419,10 @@ namespace PipMath
 		}
 	}
 	//Point, plane normal, plane dist to origin along n
-	inline decimal DistPtToPlane(Vector2 p, Vector2 n, decimal dist)
+	template <typename T>
+	inline T DistPtToPlane(BasicVector2<T> p, BasicVector2<T> n, typename BasicVector2<T>::decimal dist)
 	{
+		typedef BasicVector2<T> Vector2;
 		n.Normalize();
 		Vector2 q = n * dist;//Plane's centre
 		Vector2 planeToP = p - q;
@@ -433,9 +564,10 @@ namespace PipMath
 		}
 	};
 
-	inline Vector3 Vector2::ToVector3()
+	template <typename T>
+	inline Vector3 BasicVector2<T>::ToVector3()
 	{
-		return Vector3(x, y, 0);
+		return Vector3((::decimal)x, (::decimal)y, 0);
 	}
 
 	inline Vector3 operator*(const Vector3& v, const decimal& scalar) 
@@ -645,16 +777,19 @@ namespace PipMath
 
 	}Matrix;
 	//Collision info necessary for solver, normal points from objA to B
-	struct Manifold 
+	template <typename T>
+	struct BasicManifold 
 	{
+		typedef BasicVector2<T> Vector2;
+
 		int numContactPoints;
-		decimal penetration;
-		PipMath::Vector2 normal;
-		PipMath::Vector2 contactPoints[2] = { Vector2(0,0), Vector2(0,0) };//Obb to Obb may use 2 contact points (If incident face complete interpenetrates reference face)
-		Rigidbody* rb1;
-		Rigidbody* rb2;
+		T penetration;
+		Vector2 normal;
+		Vector2 contactPoints[2] = { Vector2(0,0), Vector2(0,0) };//Obb to Obb may use 2 contact points (If incident face complete interpenetrates reference face)
+		BasicRigidbody<T>* rb1;
+		BasicRigidbody<T>* rb2;
 
-		Manifold() 
+		BasicManifold() 
 		{
 			numContactPoints = 0;
 			penetration = 0.0f;
@@ -663,5 +798,6 @@ namespace PipMath
 			rb2 = nullptr;
 		}
 	};
+	typedef BasicManifold<decimal> Manifold;
 }
 
@@ -1,6 +1,10 @@
 #include "QuadNode.h"
 
 #include <assert.h>
+#include <algorithm>
+#include <new>
+
+#include "AllocationHooks.h"
 
 #define QNODE_MERGE_THRESHOLD 8 // 8 objects in 1 node = 28 tests. 8 objects in 4 nodes = 32 + 1*4 = 36 tests if fully balanced
 #define QNODE_SUBDIVIDE_THRESHOLD 12 //12 objects in 1 node = 66 tests. 12 objects in 4 nodes = 48 + 3*4 = 60 tests if fully balanced
@@ -8,18 +12,21 @@
 using namespace PipMath;
 
 
-QuadNode::QuadNode(Vector2 topRight, Vector2 bottomLeft, bool isLeaf)
-	: m_topRight(topRight), m_bottomLeft(bottomLeft), m_isLeaf(isLeaf), m_owner(nullptr), m_children (nullptr)
+template <typename T>
+BasicQuadNode<T>::BasicQuadNode(Vector2 topRight, Vector2 bottomLeft, bool isLeaf)
+	: m_topRight(topRight), m_bottomLeft(bottomLeft), m_isLeaf(isLeaf), m_ownedBodyCount(0), m_owner(nullptr), m_children (nullptr), m_freeChildren(nullptr)
 {
 	bool debugBreak = false;
 }
 
-QuadNode::~QuadNode()
+template <typename T>
+BasicQuadNode<T>::~BasicQuadNode()
 {
-	delete[] m_children;
+	DestroyChildren(false);
 }
 
-unsigned int QuadNode::GetLeafNodes(std::vector<QuadNode*>& leafNodes)
+template <typename T>
+unsigned int BasicQuadNode<T>::GetLeafNodes(std::vector<QuadNode*>& leafNodes)
 {
 	unsigned int leafCount = 0;
 	if (m_isLeaf) {
@@ -35,58 +42,142 @@ unsigned int QuadNode::GetLeafNodes(std::vector<QuadNode*>& leafNodes)
 	return leafCount;
 }
 
-void QuadNode::TrySubdivide()
+template <typename T>
+unsigned int BasicQuadNode<T>::GetDepth()
+{
+	unsigned int depth = 0;
+	if (!m_isLeaf) {
+		for (int i = 0; i < 4; i++) depth = std::max(depth, m_children[i].GetDepth());
+	}
+	return depth + 1;
+}
+
+template <typename T>
+void BasicQuadNode<T>::TrySubdivide()
 {
 	assert(m_isLeaf && !m_children);//Assert were leaf node and thus have no children
 	//Measure owned bodies
-	if (m_ownedBodies.size() >= QNODE_SUBDIVIDE_THRESHOLD) 
+	if (m_ownedBodyCount >= QNODE_SUBDIVIDE_THRESHOLD) 
 	{
-		if (!m_ownedBodies.empty()) m_ownedBodies.clear();
-		m_isLeaf = false;
-		m_children = new QuadNode[4];
-		Vector2 midPoint = m_topRight + (m_bottomLeft - m_topRight) / 2;
-		//Nodes: top left);
-		m_children[0].m_owner = this;
-		m_children[0].m_topRight = Vector2(midPoint.x, m_topRight.y);
-		m_children[0].m_bottomLeft = Vector2(m_bottomLeft.x, midPoint.y);
-		//top right
-		m_children[1].m_owner = this;
-		m_children[1].m_topRight = Vector2(m_topRight.x, m_topRight.y);
-		m_children[1].m_bottomLeft = Vector2(midPoint.x, midPoint.y);
-		//bottom left
-		m_children[2].m_owner = this;
-		m_children[2].m_topRight = Vector2(midPoint.x, midPoint.y);
-		m_children[2].m_bottomLeft = Vector2(m_bottomLeft.x, m_bottomLeft.y);
-		//bottom right
-		m_children[3].m_owner = this;
-		m_children[3].m_topRight = Vector2(m_topRight.x, midPoint.y);
-		m_children[3].m_bottomLeft = Vector2(midPoint.x, m_bottomLeft.y);
+		Subdivide();
 	}
 }
 
-void QuadNode::TryMerge()
+template <typename T>
+void BasicQuadNode<T>::TryMerge()
 {
 	//Assert were not a leaf node, return if our children just subdivided and thus are not leaf anymore, as they probably fulfill the merge threshold
 	assert(!m_isLeaf);
 	assert(m_children);
 	
-	if (!m_children[0].m_isLeaf) return;
+	//Any grandchildren means this node isn't a leaf parent anymore. Merging it could also free another leaf parent still queued for TryMerge
+	for (int i = 0; i < 4; i++)
+	{
+		if (!m_children[i].m_isLeaf) return;
+	}
 
-	//Count children bodies see if they add up to threshold
-	unsigned int childrenBodyTotal = 0;
-	std::vector<QuadNode*> leafNodes;
-	GetLeafNodes(leafNodes);
-	for (int i = 0; i <leafNodes.size(); i++)
+	//Count children bodies see if they add up to threshold, they're all leaves by now
+	size_t childrenBodyTotal = 0;
+	for (int i = 0; i < 4; i++)
 	{
-		QuadNode* childLeaf = leafNodes[i];
-		childrenBodyTotal += (unsigned int)childLeaf->m_ownedBodies.size();
+		childrenBodyTotal += m_children[i].m_ownedBodyCount;
 	}
 	if (childrenBodyTotal <= QNODE_MERGE_THRESHOLD)
 	{
-		delete[] m_children;//Should delete recursively
-		m_children = nullptr;
-		m_isLeaf = true;
+		Merge();
+	}
+}
+
+template <typename T>
+void BasicQuadNode<T>::Subdivide()
+{
+	assert(m_isLeaf && !m_children);
+	m_ownedBodyCount = 0;
+	m_isLeaf = false;
+	//A block a merge gave back saves the allocation, nodes subdividing and merging back every few steps is common
+	if (m_freeChildren && !m_freeChildren->empty())
+	{
+		m_children = m_freeChildren->back();
+		m_freeChildren->pop_back();
+	}
+	else m_children = (QuadNode*)PipAllocate(4 * sizeof(QuadNode));
+	for (int i = 0; i < 4; i++)
+	{
+		new (&m_children[i]) QuadNode();
+		m_children[i].m_freeChildren = m_freeChildren;
+	}
+	Vector2 midPoint = m_topRight + (m_bottomLeft - m_topRight) / 2;
+	//Nodes: top left);
+	m_children[0].m_owner = this;
+	m_children[0].m_topRight = Vector2(midPoint.x, m_topRight.y);
+	m_children[0].m_bottomLeft = Vector2(m_bottomLeft.x, midPoint.y);
+	//top right
+	m_children[1].m_owner = this;
+	m_children[1].m_topRight = Vector2(m_topRight.x, m_topRight.y);
+	m_children[1].m_bottomLeft = Vector2(midPoint.x, midPoint.y);
+	//bottom left
+	m_children[2].m_owner = this;
+	m_children[2].m_topRight = Vector2(midPoint.x, midPoint.y);
+	m_children[2].m_bottomLeft = Vector2(m_bottomLeft.x, m_bottomLeft.y);
+	//bottom right
+	m_children[3].m_owner = this;
+	m_children[3].m_topRight = Vector2(m_topRight.x, midPoint.y);
+	m_children[3].m_bottomLeft = Vector2(midPoint.x, m_bottomLeft.y);
+}
+
+template <typename T>
+void BasicQuadNode<T>::Merge()
+{
+	DestroyChildren(true);
+	m_isLeaf = true;
+}
+
+template <typename T>
+void BasicQuadNode<T>::SaveShape(std::vector<char>& shape)
+{
+	shape.push_back(m_isLeaf);
+	if (m_isLeaf) return;
+	for (int i = 0; i < 4; i++) m_children[i].SaveShape(shape);
+}
+
+template <typename T>
+size_t BasicQuadNode<T>::RestoreShape(const char* shape, size_t shapeSize, size_t idx)
+{
+	assert(idx < shapeSize);
+	//Owned bodies are rebuilt every step, only the tree layout matters
+	m_ownedBodyCount = 0;
+	bool isLeaf = shape[idx++] != 0;
+	if (isLeaf)
+	{
+		if (!m_isLeaf) Merge();
+		return idx;
 	}
+	if (m_isLeaf) Subdivide();
+	for (int i = 0; i < 4; i++) idx = m_children[i].RestoreShape(shape, shapeSize, idx);
+	return idx;
+}
+
+template <typename T>
+size_t BasicQuadNode<T>::GetNodeCount()
+{
+	size_t count = 1;
+	for (int i = 0; m_children && i < 4; i++) count += m_children[i].GetNodeCount();
+	return count;
 }
 
+template <typename T>
+void BasicQuadNode<T>::DestroyChildren(bool recycle)
+{
+	if (!m_children) return;
+	for (int i = 0; i < 4; i++)
+	{
+		m_children[i].DestroyChildren(recycle);
+		m_children[i].~QuadNode();
+	}
+	if (recycle && m_freeChildren) m_freeChildren->push_back(m_children);
+	else PipFree(m_children);
+	m_children = nullptr;
+}
 
+template class BasicQuadNode<float>;
+template class BasicQuadNode<fp64::Fp64>;
@@ -4,21 +4,38 @@
 
 #include "PipMath.h"
 
-class QuadNode
+template <typename T> class BasicRigidbody;
+
+template <typename T>
+class BasicQuadNode
 {
 public:
-	QuadNode(PipMath::Vector2 topRight = PipMath::Vector2(), PipMath::Vector2 bottomLeft = PipMath::Vector2(),
+	typedef PipMath::BasicVector2<T> Vector2;
+	typedef BasicRigidbody<T> Rigidbody;
+	typedef BasicQuadNode QuadNode;
+
+	BasicQuadNode(Vector2 topRight = Vector2(), Vector2 bottomLeft = Vector2(),
 	 bool isLeaf = true);
-	~QuadNode();
+	~BasicQuadNode();
 	unsigned int GetLeafNodes(std::vector<QuadNode*>& leafNodes);//RECURSIVE
+	unsigned int GetDepth();//RECURSIVE, levels from this node to its deepest leaf, 1 for a leaf
 	void TrySubdivide();//See if conditions are fulfilled for subdividing this leaf node into 4 children
 	void TryMerge();//See if conditions are fulfilled for merging children nodes on this leaf nodes parent	
+	void Subdivide();
+	void Merge();
+	void SaveShape(std::vector<char>& shape);//RECURSIVE, preorder leaf flags
+	size_t RestoreShape(const char* shape, size_t shapeSize, size_t idx = 0);//RECURSIVE, returns idx past this subtree
+	size_t GetNodeCount();//RECURSIVE, this node included
+private:
+	void DestroyChildren(bool recycle);//RECURSIVE, children come from PipAllocate. Recycling hands their blocks to m_freeChildren
 public:
-	PipMath::Vector2 m_topRight;
-	PipMath::Vector2 m_bottomLeft;
+	Vector2 m_topRight;
+	Vector2 m_bottomLeft;
 	bool m_isLeaf;
-	std::vector<Rigidbody*> m_ownedBodies;//Data owned by memory allocator
+	size_t m_ownedBodyCount;//Bodies the last step binned here, their list is in Solver::m_leafBodies
 	QuadNode* m_children;
 	QuadNode* m_owner;
+	std::vector<QuadNode*>* m_freeChildren;//Blocks of 4 that merges gave back, shared down the tree. Null frees them instead
 };
+typedef BasicQuadNode<decimal> QuadNode;
 
@@ -2,13 +2,30 @@
 
 using namespace PipMath;
 
-Rigidbody::Rigidbody(Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass, decimal e, bool isKinematic)
+template <typename T>
+BasicRigidbody<T>::BasicRigidbody(Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass, decimal e, bool isKinematic)
 	: m_position(pos), m_rotation(rot), m_velocity(vel), m_angularVelocity(angVel), m_mass(mass), m_e(e), m_isKinematic(isKinematic), 
-	m_isSleeping(false), m_timeInSleep(0.f), m_inertia(0.f), m_prevPos(), m_prevRot(), m_acceleration(), m_angularAccel()
+	m_isSleeping(false), m_timeInSleep(0.f), m_inertia(0.f), m_prevPos(pos), m_prevRot(rot), m_acceleration(), m_angularAccel(), m_rotationMatrix(rot)
 {
 }
 
-Rigidbody::~Rigidbody()
+template <typename T>
+BasicRigidbody<T>::~BasicRigidbody()
 {
 }
 
+template <typename T>
+void BasicRigidbody<T>::SetRotation(decimal rad)
+{
+	m_rotation = rad;
+	UpdateRotation();
+}
+
+template <typename T>
+void BasicRigidbody<T>::UpdateRotation()
+{
+	m_rotationMatrix = Mat2(m_rotation);
+}
+
+template class BasicRigidbody<float>;
+template class BasicRigidbody<fp64::Fp64>;
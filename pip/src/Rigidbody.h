@@ -3,43 +3,90 @@
 #include "PipMath.h"
 #include "QuadNode.h"
 
-class Circle;
-class Capsule;
-class OrientedBox;
+template <typename T> class BasicCircle;
+template <typename T> class BasicCapsule;
+template <typename T> class BasicOrientedBox;
+template <typename T> class BasicConvexPolygon;
+template <typename T> class BasicCompound;
 
 enum class BodyType
 {
 	Circle,
 	Capsule,
-	Obb
+	Obb,
+	Polygon,
+	Compound
 };
 
-class Rigidbody
+//Scalar dependent names for the engine's class templates, member definitions read the same for every scalar
+#define PIP_SCALAR_TYPES(T) \
+	typedef T decimal; \
+	typedef PipMath::BasicVector2<T> Vector2; \
+	typedef PipMath::BasicMat2<T> Mat2; \
+	typedef PipMath::BasicManifold<T> Manifold; \
+	typedef BasicRigidbody<T> Rigidbody; \
+	typedef BasicCircle<T> Circle; \
+	typedef BasicCapsule<T> Capsule; \
+	typedef BasicOrientedBox<T> OrientedBox; \
+	typedef BasicConvexPolygon<T> ConvexPolygon; \
+	typedef BasicCompound<T> Compound;
+
+//Shapes derive from a dependent base, bring its members into scope
+#define PIP_RIGIDBODY_MEMBERS \
+	using Rigidbody::m_bodyType; \
+	using Rigidbody::m_position; \
+	using Rigidbody::m_prevPos; \
+	using Rigidbody::m_rotation; \
+	using Rigidbody::m_rotationMatrix; \
+	using Rigidbody::m_prevRot; \
+	using Rigidbody::m_velocity; \
+	using Rigidbody::m_angularVelocity; \
+	using Rigidbody::m_acceleration; \
+	using Rigidbody::m_angularAccel; \
+	using Rigidbody::m_mass; \
+	using Rigidbody::m_e; \
+	using Rigidbody::m_timeInSleep; \
+	using Rigidbody::m_isKinematic; \
+	using Rigidbody::m_isSleeping; \
+	using Rigidbody::m_inertia;
+
+template <typename T>
+class BasicRigidbody
 {
 public:
-	Rigidbody(PipMath::Vector2 pos = PipMath::Vector2(), decimal rot = (decimal)0.f,
-	 PipMath::Vector2 vel = PipMath::Vector2(), decimal angVel = (decimal)0.f, decimal mass = 1.f, decimal e = 1.f,
+	PIP_SCALAR_TYPES(T)
+
+	BasicRigidbody(Vector2 pos = Vector2(), decimal rot = (decimal)0.f,
+	 Vector2 vel = Vector2(), decimal angVel = (decimal)0.f, decimal mass = 1.f, decimal e = 1.f,
 	 bool isKinematic = false);
-	~Rigidbody();
+	~BasicRigidbody();
+	void SetRotation(decimal rad);
+	void UpdateRotation();//Refresh m_rotationMatrix after writing m_rotation directly
 	//Visitor pattern
-	virtual bool IntersectWith(PipMath::Vector2 topRight, PipMath::Vector2 bottomLeft) = 0;
-	virtual bool IntersectWith(Rigidbody* rb2, PipMath::Manifold& manifold) = 0;
-	virtual bool IntersectWith(Circle* rb2, PipMath::Manifold& manifold) = 0;
-	virtual bool IntersectWith(Capsule* rb2, PipMath::Manifold& manifold) = 0;
-	virtual bool IntersectWith(OrientedBox* rb2, PipMath::Manifold& manifold) = 0;
-	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, PipMath::Manifold& manifold) = 0;
-	virtual decimal SweepWith(Circle* rb2, decimal dt, PipMath::Manifold& manifold) = 0;
-	virtual decimal SweepWith(Capsule* rb2, decimal dt, PipMath::Manifold& manifold) = 0;
-	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, PipMath::Manifold& manifold) = 0;
+	virtual bool IntersectWith(Vector2 topRight, Vector2 bottomLeft) = 0;
+	virtual bool IntersectWith(Rigidbody* rb2, Manifold& manifold) = 0;
+	virtual bool IntersectWith(Circle* rb2, Manifold& manifold) = 0;
+	virtual bool IntersectWith(Capsule* rb2, Manifold& manifold) = 0;
+	virtual bool IntersectWith(OrientedBox* rb2, Manifold& manifold) = 0;
+	virtual bool IntersectWith(ConvexPolygon* rb2, Manifold& manifold) = 0;
+	virtual bool IntersectWith(Compound* rb2, Manifold& manifold) = 0;
+	virtual decimal SweepWith(Rigidbody* rb2, decimal dt, Manifold& manifold) = 0;
+	virtual decimal SweepWith(Circle* rb2, decimal dt, Manifold& manifold) = 0;
+	virtual decimal SweepWith(Capsule* rb2, decimal dt, Manifold& manifold) = 0;
+	virtual decimal SweepWith(OrientedBox* rb2, decimal dt, Manifold& manifold) = 0;
+	virtual decimal SweepWith(ConvexPolygon* rb2, decimal dt, Manifold& manifold) = 0;
+	virtual decimal SweepWith(Compound* rb2, decimal dt, Manifold& manifold) = 0;
+	virtual void ComputeAabb(Vector2& topRight, Vector2& bottomLeft) = 0;//World space bounds
 public:
 	BodyType m_bodyType;
-	PipMath::Vector2 m_position;
-	PipMath::Vector2 m_prevPos;
+	Vector2 m_position;
+	Vector2 m_prevPos;
 	decimal m_rotation;//In radians
+	Mat2 m_rotationMatrix;//Cached from m_rotation, geometric queries read this instead of calling Cos/Sin
 	decimal m_prevRot;
-	PipMath::Vector2 m_velocity;
+	Vector2 m_velocity;
 	decimal m_angularVelocity;
-	PipMath::Vector2 m_acceleration;
+	Vector2 m_acceleration;
 	decimal m_angularAccel;
 	decimal m_mass;
 	decimal m_e;//coefficient of restitution
@@ -47,3 +94,4 @@ public:
 	bool m_isKinematic, m_isSleeping;
 	decimal m_inertia;//Scalar in 2D aka 2nd moment of mass, tensor or matrix in 3D
 };
+typedef BasicRigidbody<decimal> Rigidbody;
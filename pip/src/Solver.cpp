@@ -2,35 +2,86 @@
 #include <assert.h>
 #include <float.h>
 #include <algorithm>
+#include <string.h>
+#include <chrono>
+#include <stdint.h>
 
 #include "Solver.h"
 #include "Circle.h"
 #include "Capsule.h"
 #include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
+#include "CollisionDispatch.h"
+#include "Chain.h"
+#include "Heightfield.h"
+#include "AllocationHooks.h"
 
 using namespace std;
 using namespace PipMath;
 
-Solver::Solver()
+#define PIP_BODY_GRAIN 128//Bodies per parallel-for range
+#define PIP_ISLAND_GRAIN 16
+#define PIP_FNV_OFFSET 14695981039346656037ull
+
+const char* GetStepPhaseName(StepPhase phase)
+{
+	static const char* names[(int)StepPhase::Count] = { "Integration", "Broadphase", "Narrowphase", "Response" };
+	return names[(int)phase];
+}
+
+template <typename V>
+static size_t VectorBytes(const V& vector)
+{
+	return vector.capacity() * sizeof(typename V::value_type);
+}
+
+static void FnvMix(uint64_t& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+template <typename T>
+BasicSolver<T>::BasicSolver()
+	: BasicSolver(50 * sizeof(OrientedBox))
+{
+}
+
+template <typename T>
+BasicSolver<T>::BasicSolver(size_t poolSize)
 	: m_continuousCollision(false), m_stepMode(true), m_stepOnce(false), m_quadTreeSubdivision(true), m_staticResolution(true), m_logCollisionInfo(false),
-		m_frictionModel(true), m_allocator(50 * sizeof(OrientedBox)), m_quadTreeRoot(Vector2(10, 10), Vector2(-10, -10)), m_accumulator(0.f), m_timestep(0.02f), m_gravity(9.8f),
-		m_airViscosity(0.133f)
+		m_frictionModel(true), m_batchNarrowphase(true), m_speculativeContacts(false), m_allocator(poolSize), m_quadTreeRoot(Vector2(10, 10), Vector2(-10, -10)), m_accumulator(0.f), m_timestep(0.02f), m_gravity(9.8f),
+		m_airViscosity(0.133f), m_scheduler(&m_jobSystem), m_phaseTimes(), m_stepStats(), m_stateHash(0), m_stateHashStale(true), m_trace(nullptr)
 {
+	m_quadTreeRoot.m_freeChildren = &m_freeQuadNodes;
 }
 
-Solver::~Solver()
+template <typename T>
+BasicSolver<T>::~BasicSolver()
 {
+	DestroyStaticShapes();
+	//Blocks still in the tree go with the root, the ones merges gave back are raw memory
+	for (QuadNode* children : m_freeQuadNodes) PipFree(children);
 }
 
-void Solver::Update(decimal dt)
+template <typename T>
+void BasicSolver<T>::Update(decimal dt)
 {
 	//Step through mem allocated bodies
 
+	chrono::steady_clock::time_point updateStart = chrono::steady_clock::now();
+	unsigned int steps = 0;
 	//Fixed timestep with accumulator (50fps)
 	if (m_stepMode) {
 		if (m_stepOnce) {
 			(m_continuousCollision) ? ContinuousStep(m_timestep) : Step(m_timestep);
 			m_stepOnce = false;
+			steps++;
 		}
 	}
 	else {
@@ -39,15 +90,23 @@ void Solver::Update(decimal dt)
 		while (m_accumulator > m_timestep) {
 			(m_continuousCollision) ? ContinuousStep(m_timestep) : Step(m_timestep);
 			m_accumulator -= m_timestep;
+			steps++;
 		}
 	}
-	//@UP TO THE GRAPHICS APPLICATION:
-	//To create a lerp between this frame and the next, interact with the graphic system.
-	//ApproxTransform.position = transform.position + m_velocity*m_accumulator ?
-	//float alpha = m_accumulator / m_timestep;
+	if (m_trace) m_trace->Complete(0, "Update", updateStart, chrono::steady_clock::now(), "steps", steps);
+	//Whatever is left in the accumulator is drawn as a blend of the last two steps, see GetInterpolationAlpha
+}
+
+template <typename T>
+T BasicSolver<T>::GetInterpolationAlpha()
+{
+	//Step mode doesn't accumulate, the last step is drawn as it is
+	if (m_stepMode) return 1;
+	return Min(m_accumulator / m_timestep, (decimal)1);
 }
 
-void Solver::ContinuousStep(decimal dt) 
+template <typename T>
+void BasicSolver<T>::ContinuousStep(decimal dt) 
 {
 	//#Move code onto pool iterator
 	//We need to have up to date velocities to perform sweeps
@@ -96,111 +155,291 @@ void Solver::ContinuousStep(decimal dt)
 	}*/
 }
 
-void Solver::Step(decimal dt)
+template <typename T>
+void BasicSolver<T>::Step(decimal dt)
 {
+	//Speculative contacts are found before bodies move and the response runs before positions are integrated, so no pair
+	//can close more than the gap between them. Tunneling is caught at the cost of one step
+	bool speculative = m_speculativeContacts;
+	//Phases run as parallel-fors on m_scheduler, only the quadtree's upkeep stays serial. Each range writes its own bodies,
+	//leaves or output slots and outputs are gathered in serial order, so any thread count takes the same step
+	TaskScheduler* scheduler = m_scheduler;
+	unsigned int threadCount = scheduler ? scheduler->GetThreadCount() : 1;
+	//Tracing records every range through m_traceScheduler, on the thread that ran it
+	TraceRecorder* trace = m_trace;
+	if (trace)
+	{
+		trace->Reserve(threadCount);
+		m_traceScheduler.m_scheduler = scheduler;
+		m_traceScheduler.m_trace = trace;
+		scheduler = &m_traceScheduler;
+	}
+	for (double& phaseTime : m_phaseTimes) phaseTime = 0;
+	chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
+	chrono::steady_clock::time_point lapStart = stepStart;
+	auto lap = [&](StepPhase phase) {
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		m_phaseTimes[(int)phase] += chrono::duration<double, milli>(now - lapStart).count();
+		if (trace) trace->Complete(0, GetStepPhaseName(phase), lapStart, now);
+		lapStart = now;
+	};
 	//Integration
-	std::vector<Rigidbody*> rigidbodies;
-	for (Rigidbody* rb = m_allocator.GetFirstBody(); rb != nullptr; rb = m_allocator.GetNextBody(rb)) {
-		rigidbodies.push_back(rb);
-		rb->m_acceleration += Vector2(0, -m_gravity / rb->m_mass);
-		rb->m_acceleration -= m_airViscosity * rb->m_velocity / rb->m_mass;
-		rb->m_angularAccel -= m_airViscosity * rb->m_angularVelocity / rb->m_mass; 
-		if (!(rb->m_isKinematic || rb->m_isSleeping)) {
-			rb->m_velocity += rb->m_acceleration * dt;
-			rb->m_angularVelocity += rb->m_angularAccel * dt;	
+	m_traceScheduler.m_label = "Integrate";
+	//Scratch lists are members that keep their capacity, a step that needs no more than the ones before doesn't allocate
+	std::vector<Rigidbody*>& rigidbodies = m_stepBodies;
+	rigidbodies.clear();
+	for (Rigidbody* rb = m_allocator.GetFirstBody(); rb != nullptr; rb = m_allocator.GetNextBody(rb)) rigidbodies.push_back(rb);
+	ParallelFor(scheduler, rigidbodies.size(), PIP_BODY_GRAIN, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++) {
+			Rigidbody* rb = rigidbodies[i];
+			rb->m_acceleration += Vector2(0, -m_gravity / rb->m_mass);
+			rb->m_acceleration -= m_airViscosity * rb->m_velocity / rb->m_mass;
+			rb->m_angularAccel -= m_airViscosity * rb->m_angularVelocity / rb->m_mass; 
+			if (!(rb->m_isKinematic || rb->m_isSleeping)) {
+				rb->m_velocity += rb->m_acceleration * dt;
+				rb->m_angularVelocity += rb->m_angularAccel * dt;	
+			}
+			rb->m_prevPos = rb->m_position;
+			rb->m_prevRot = rb->m_rotation;
+			if (!speculative) {
+				rb->m_position += rb->m_velocity * dt;
+				rb->m_rotation += rb->m_angularVelocity * dt;
+				rb->UpdateRotation();
+			}
+			rb->m_acceleration = Vector2();
+			rb->m_angularAccel = 0;
+			//Placed here, later phases test the same compound from several threads
+			if (rb->m_bodyType == BodyType::Compound) ((Compound*)rb)->UpdateChildren();
 		}
-		rb->m_prevPos = rb->m_position;
-		rb->m_prevRot = rb->m_rotation;
-		rb->m_position += rb->m_velocity * dt;
-		rb->m_rotation += rb->m_angularVelocity * dt;
-		rb->m_acceleration = Vector2();
-		rb->m_angularAccel = 0;
-	}
+	});
+	lap(StepPhase::Integration);
 
 	//Q-tree: Assume space time coherence. Space: Objects cannot have a velocity bigger than the extent of a Q-node. Time: If we know what Q-node we were on
 	//previous frame, we know to only check against Q-nodes adjacent to it, up to a max of 9.
 	//When to subdivide Q-node? When number of body checks in one bin would surpass number of body checks in multiple bins (assuming uniform division?)
 	//+ checking each body against necessary bins (9 approx?)
-	std::vector<QuadNode*> quadTreeLeafNodes;
+	std::vector<QuadNode*>& quadTreeLeafNodes = m_leafNodes;
+	quadTreeLeafNodes.clear();
 	m_quadTreeRoot.GetLeafNodes(quadTreeLeafNodes);
+	m_stepStats.leafCount = quadTreeLeafNodes.size();
 
-	for (int i = 0; i < quadTreeLeafNodes.size(); i++)
-	{
-		QuadNode* leafNode = quadTreeLeafNodes[i];
-		if (!leafNode->m_ownedBodies.empty()) leafNode->m_ownedBodies.clear();
-		for (int j = 0; j < rigidbodies.size(); j++)
+	//Each leaf fills its own list. Lists go by leaf index rather than node, so nodes a subdivide makes reuse old capacity
+	if (m_leafBodies.size() < quadTreeLeafNodes.size()) m_leafBodies.resize(quadTreeLeafNodes.size());
+	m_traceScheduler.m_label = "Bin bodies";
+	ParallelFor(scheduler, quadTreeLeafNodes.size(), 1, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++)
 		{
-			//Figure which bin rigidbody is on
-			Rigidbody* rb = rigidbodies[j];
-			if (rb->IntersectWith(leafNode->m_topRight, leafNode->m_bottomLeft))
+			QuadNode* leafNode = quadTreeLeafNodes[i];
+			std::vector<Rigidbody*>& leafBodies = m_leafBodies[i];
+			leafBodies.clear();
+			for (int j = 0; j < rigidbodies.size(); j++)
 			{
-				leafNode->m_ownedBodies.push_back(rb);
+				//Figure which bin rigidbody is on
+				Rigidbody* rb = rigidbodies[j];
+				//Speculative: every node the body may reach this step, growing the node is the same as sweeping the body
+				Vector2 margin = speculative ? Vector2(Abs(rb->m_velocity.x), Abs(rb->m_velocity.y)) * dt : Vector2();
+				if (rb->IntersectWith(leafNode->m_topRight + margin, leafNode->m_bottomLeft - margin))
+				{
+					leafBodies.push_back(rb);
+				}
 			}
+			leafNode->m_ownedBodyCount = leafBodies.size();
 		}
-	}
+	});
+	lap(StepPhase::Broadphase);
 
 	m_currentManifolds.clear();
+	m_narrowphase.Clear();
 	//You might test twice for bodies that are both part of two QuadNodes at the same time, which is why m_ignoreSeparatingBodies should be true
-	for (int i = 0; i < quadTreeLeafNodes.size(); i++)
+	if (m_batchNarrowphase && !speculative)
 	{
-		QuadNode* leafNode = quadTreeLeafNodes[i];
-		for (int j = 0; j < leafNode->m_ownedBodies.size(); j++)
+		//Pairs are gathered in leaf order, the batch tests them in parallel and hands hits back in that order
+		for (int i = 0; i < quadTreeLeafNodes.size(); i++)
 		{
-			Rigidbody* rb1 = leafNode->m_ownedBodies[j];
-			for (int k = j + 1; k < leafNode->m_ownedBodies.size(); k++) 
+			std::vector<Rigidbody*>& leafBodies = m_leafBodies[i];
+			for (int j = 0; j < leafBodies.size(); j++)
 			{
-				Rigidbody* rb2 = leafNode->m_ownedBodies[k];
-				Manifold currentManifold;
-				//If both objects are sleeping/kinematic, skip test
-				if ((rb1->m_isSleeping || rb1->m_isKinematic) && (rb2->m_isSleeping || rb2->m_isKinematic)) continue;
-				if (rb1->IntersectWith(rb2, currentManifold))
+				Rigidbody* rb1 = leafBodies[j];
+				for (int k = j + 1; k < leafBodies.size(); k++) 
 				{
-					//They collide during the frame, store
-					m_currentManifolds.push_back(currentManifold);//add manifolds
+					Rigidbody* rb2 = leafBodies[k];
+					//If both objects are sleeping/kinematic, skip test
+					if ((rb1->m_isSleeping || rb1->m_isKinematic) && (rb2->m_isSleeping || rb2->m_isKinematic)) continue;
+					m_narrowphase.AddPair(rb1, rb2);
 				}
 			}
 		}
+		m_stepStats.pairTests = m_narrowphase.m_pairs.size() / 2;
+		m_traceScheduler.m_label = "Pair tests";
+		m_narrowphase.Run(m_currentManifolds, scheduler);
 	}
-
-	//Collision response, may displace objects directly for static collision resolution
-	for (const Manifold& manifold : m_currentManifolds) ComputeResponse(manifold);
-	//Sleep check
-	for (int i = 0; i < rigidbodies.size(); i++)
+	else
 	{
-		Rigidbody* rb = rigidbodies[i];
-		if (!rb->m_isKinematic)
+		//Each leaf tests its pairs into its own list, lists are appended in leaf order
+		if (m_leafManifolds.size() < quadTreeLeafNodes.size()) m_leafManifolds.resize(quadTreeLeafNodes.size());
+		m_leafPairTests.resize(quadTreeLeafNodes.size());
+		m_traceScheduler.m_label = "Leaf pair tests";
+		ParallelFor(scheduler, quadTreeLeafNodes.size(), 1, [&](size_t begin, size_t end, unsigned int) {
+			for (size_t i = begin; i < end; i++)
+			{
+				std::vector<Rigidbody*>& leafBodies = m_leafBodies[i];
+				std::vector<Manifold>& leafManifolds = m_leafManifolds[i];
+				leafManifolds.clear();
+				size_t pairTests = 0;
+				for (int j = 0; j < leafBodies.size(); j++)
+				{
+					Rigidbody* rb1 = leafBodies[j];
+					for (int k = j + 1; k < leafBodies.size(); k++)
+					{
+						Rigidbody* rb2 = leafBodies[k];
+						Manifold currentManifold;
+						if ((rb1->m_isSleeping || rb1->m_isKinematic) && (rb2->m_isSleeping || rb2->m_isKinematic)) continue;
+						pairTests++;
+						if (IntersectPair(rb1, rb2, currentManifold))
+						{
+							//They collide during the frame, store
+							leafManifolds.push_back(currentManifold);//add manifolds
+						}
+						else if (speculative && SpeculativePair(rb1, rb2, (rb1->m_velocity - rb2->m_velocity).Length() * dt, currentManifold))
+						{
+							//Close enough to meet within the step
+							leafManifolds.push_back(currentManifold);
+						}
+					}
+				}
+				m_leafPairTests[i] = pairTests;
+			}
+		});
+		m_stepStats.pairTests = 0;
+		for (size_t i = 0; i < quadTreeLeafNodes.size(); i++)
 		{
-			if ((rb->m_position - rb->m_prevPos).LengthSqr() <= 0.001 * 0.001 &&
-			(rb->m_rotation - rb->m_prevRot) <= 0.001)
+			m_currentManifolds.insert(m_currentManifolds.end(), m_leafManifolds[i].begin(), m_leafManifolds[i].end());
+			m_stepStats.pairTests += m_leafPairTests[i];
+		}
+	}
+
+	//Static shapes: only segments near each awake body are tested, they're never binned. Keep the deepest contact per
+	//shape, resolving every segment under a box resting across a vertex would push it out twice
+	if (!m_staticShapes.empty())
+	{
+		size_t shapeCount = m_staticShapes.size();
+		m_staticManifolds.assign(rigidbodies.size() * shapeCount, Manifold());
+		if (m_staticCandidates.size() < threadCount) m_staticCandidates.resize(threadCount);
+		m_traceScheduler.m_label = "Static shapes";
+		ParallelFor(scheduler, rigidbodies.size(), PIP_BODY_GRAIN, [&](size_t begin, size_t end, unsigned int threadIdx) {
+			std::vector<OrientedBox*>& candidates = m_staticCandidates[threadIdx];
+			for (size_t i = begin; i < end; i++)
 			{
-				//#Issues with bodies going to sleep when they shouldnt on fixed point mode
-				rb->m_timeInSleep += dt;
-				//If its static for two timesteps or more, put to sleep
-				if (!rb->m_isSleeping && rb->m_timeInSleep >= m_timestep * 2)
+				Rigidbody* rb = rigidbodies[i];
+				if (rb->m_isSleeping || rb->m_isKinematic) continue;
+				Vector2 topRight, bottomLeft;
+				rb->ComputeAabb(topRight, bottomLeft);
+				Vector2 margin = speculative ? Vector2(Abs(rb->m_velocity.x), Abs(rb->m_velocity.y)) * dt : Vector2();
+				decimal maxDistance = speculative ? rb->m_velocity.Length() * dt : 0;
+				for (size_t s = 0; s < shapeCount; s++)
 				{
-					rb->m_isSleeping = true;
-					rb->m_velocity = Vector2();
-					rb->m_angularVelocity = 0;
+					candidates.clear();
+					m_staticShapes[s]->Query(topRight + margin, bottomLeft - margin, candidates);
+					Manifold& deepest = m_staticManifolds[i * shapeCount + s];
+					for (OrientedBox* segment : candidates)
+					{
+						Manifold currentManifold;
+						if (!IntersectPair(rb, (Rigidbody*)segment, currentManifold)
+						 && !(speculative && SpeculativePair(rb, (Rigidbody*)segment, maxDistance, currentManifold))) continue;
+						if (!deepest.rb1 || currentManifold.penetration > deepest.penetration) deepest = currentManifold;
+					}
 				}
 			}
-			else
+		});
+		//Which thread ran the busiest range changes from step to step, give every list the capacity any of them needed
+		size_t candidateCapacity = 0;
+		for (std::vector<OrientedBox*>& candidates : m_staticCandidates) candidateCapacity = std::max(candidateCapacity, candidates.capacity());
+		for (std::vector<OrientedBox*>& candidates : m_staticCandidates) candidates.reserve(candidateCapacity);
+		for (const Manifold& manifold : m_staticManifolds)
+		{
+			if (manifold.rb1) m_currentManifolds.push_back(manifold);
+		}
+	}
+	m_stepStats.manifolds = m_currentManifolds.size();
+	lap(StepPhase::Narrowphase);
+
+	//Collision response, may displace objects directly for static collision resolution. Islands share no dynamic body,
+	//they're solved in parallel and each one in the order its manifolds were found, same as solving them all in a row.
+	//Logging keeps to one thread so the output doesn't interleave
+	BuildIslands(rigidbodies);
+	size_t islandCount = m_islandOffsets.size() - 1;
+	m_stepStats.islands = islandCount;
+	m_traceScheduler.m_label = "Islands";
+	ParallelFor(scheduler, islandCount, m_logCollisionInfo ? islandCount : PIP_ISLAND_GRAIN, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++)
+		{
+			for (size_t j = m_islandOffsets[i]; j < m_islandOffsets[i + 1]; j++) ComputeResponse(m_currentManifolds[m_islandManifolds[j]], dt);
+		}
+	});
+	lap(StepPhase::Response);
+
+	//Bodies are final once past the sleep check, each is hashed there while it's still in cache
+	m_bodyHashes.resize(rigidbodies.size());
+	m_traceScheduler.m_label = "Sleep check";
+	ParallelFor(scheduler, rigidbodies.size(), PIP_BODY_GRAIN, [&](size_t begin, size_t end, unsigned int threadIdx) {
+		for (size_t i = begin; i < end; i++)
+		{
+			Rigidbody* rb = rigidbodies[i];
+			if (speculative)
 			{
-				if (rb->m_isSleeping)
+				rb->m_position += rb->m_velocity * dt;
+				rb->m_rotation += rb->m_angularVelocity * dt;
+				rb->UpdateRotation();
+			}
+			//Sleep check
+			if (!rb->m_isKinematic)
+			{
+				if ((rb->m_position - rb->m_prevPos).LengthSqr() <= 0.001 * 0.001 &&
+				(rb->m_rotation - rb->m_prevRot) <= 0.001)
 				{
-					rb->m_isSleeping = false;
+					//#Issues with bodies going to sleep when they shouldnt on fixed point mode
+					rb->m_timeInSleep += dt;
+					//If its static for two timesteps or more, put to sleep
+					if (!rb->m_isSleeping && rb->m_timeInSleep >= m_timestep * 2)
+					{
+						if (trace) trace->Instant(threadIdx, "Sleep", "handle", (int64_t)m_allocator.m_objectToMappingIdx[i]);
+						rb->m_isSleeping = true;
+						rb->m_velocity = Vector2();
+						rb->m_angularVelocity = 0;
+					}
 				}
-				if (rb->m_timeInSleep > 0)
+				else
 				{
-					rb->m_timeInSleep = 0;
+					if (rb->m_isSleeping)
+					{
+						if (trace) trace->Instant(threadIdx, "Wake", "handle", (int64_t)m_allocator.m_objectToMappingIdx[i]);
+						rb->m_isSleeping = false;
+					}
+					if (rb->m_timeInSleep > 0)
+					{
+						rb->m_timeInSleep = 0;
+					}
 				}
 			}
+			m_bodyHashes[i] = HashBody(rb);
 		}
+	});
+	m_stateHash = CombineBodyHashes();
+	m_stateHashStale = false;
+	m_stepStats.awakeBodies = m_stepStats.sleepingBodies = m_stepStats.kinematicBodies = 0;
+	for (Rigidbody* rb : rigidbodies)
+	{
+		if (rb->m_isKinematic) m_stepStats.kinematicBodies++;
+		else if (rb->m_isSleeping) m_stepStats.sleepingBodies++;
+		else m_stepStats.awakeBodies++;
 	}
+	lap(StepPhase::Integration);
 
 	//Before clearing their ownedBodies we wanna know which qnodes need merging/subdividing
 	if (m_quadTreeSubdivision)
 	{
-		std::vector<QuadNode*> quadTreeLeafParentNodes;
+		std::vector<QuadNode*>& quadTreeLeafParentNodes = m_leafParents;
+		quadTreeLeafParentNodes.clear();
 		for (int i = 0; i < quadTreeLeafNodes.size(); i++)
 		{
 			QuadNode* leafNode = quadTreeLeafNodes[i];
@@ -217,18 +456,26 @@ void Solver::Step(decimal dt)
 		for (int i = 0; i < quadTreeLeafNodes.size(); i++)
 		{
 			QuadNode* leafNode = quadTreeLeafNodes[i];
+			size_t bodyCount = leafNode->m_ownedBodyCount;
 			leafNode->TrySubdivide();
+			if (trace && !leafNode->m_isLeaf) trace->Instant(0, "Subdivide", "bodies", (int64_t)bodyCount);
 		}
 
 		for (int i = 0; i < quadTreeLeafParentNodes.size(); i++)
 		{
 			QuadNode* leafParent = quadTreeLeafParentNodes[i];
+			bool wasLeaf = leafParent->m_isLeaf;
 			leafParent->TryMerge();
+			if (trace && !wasLeaf && leafParent->m_isLeaf) trace->Instant(0, "Merge");
 		}
 	}
+	m_stepStats.quadTreeDepth = m_quadTreeRoot.GetDepth();
+	lap(StepPhase::Broadphase);
+	if (trace) trace->Complete(0, "Step", stepStart, lapStart, "bodies", (int64_t)rigidbodies.size());
 }
 
-void Solver::ComputeResponse(const Manifold& manifold)
+template <typename T>
+void BasicSolver<T>::ComputeResponse(const Manifold& manifold, decimal dt)
 {
 
 	Rigidbody* rb1 = manifold.rb1;
@@ -263,19 +510,35 @@ void Solver::ComputeResponse(const Manifold& manifold)
 	Vector2 vb = rb2->m_velocity + rb2->m_angularVelocity * rbP;
 	Vector2 vba = va - vb;
 	decimal vbaDotN = vba.Dot(n);
-	if (m_staticResolution) {
+	bool speculative = pen < 0;//Not touching yet, nothing to push apart
+	if (speculative)
+	{
+		//Linear only, the gap doesn't hold once they spin. Contacts from spin get sorted out once they touch
+		raP = Vector2();
+		rbP = Vector2();
+		vbaDotN = (rb1->m_velocity - rb2->m_velocity).Dot(n);
+	}
+	if (m_staticResolution && !speculative) {
 		//Generic solution that uses manifold's penetration to displace rigidbodies along the normal
 		//If we do this, will kinematic objects get displaced by much?
 		decimal dispFactor = (rb1->m_isKinematic) ? 0 : (rb2->m_isKinematic) ? 1 : 0.5f;
-		rb1->m_position += pen * n * dispFactor;
-		rb2->m_position -= pen * n * (1 - dispFactor);
+		if (!rb1->m_isKinematic) rb1->m_position += pen * n * dispFactor;
+		if (!rb2->m_isKinematic) rb2->m_position -= pen * n * (1 - dispFactor);
 	}
 	//assert(vbaDotN < 0 || !m_staticResolution);
 	if (vbaDotN >= 0) return;//Possibly log this, helps solve interpenetration after response, by ignoring separating bodies
 	decimal num = -(1 + e) * vbaDotN;
+	if (speculative)
+	{
+		//Keep the approach that closes the gap by the end of the step, no bounce since they never touched. They're let
+		//through by a small slop so the next step finds a real contact instead of two faces exactly touching
+		decimal speculativeSlop = 0.01f;
+		num = -vbaDotN + (pen - speculativeSlop) / dt;
+		if (num <= 0) return;
+	}
 	decimal denom = invMassA + invMassB + Pow(raP.Dot(n), 2) * invIA + Pow(rbP.Dot(n), 2) * invIB;
 	decimal impulseReactionary = num / denom;
-	assert(impulseReactionary > 0);
+	assert(impulseReactionary >= 0);//Fixed point rounds an approach of a few ulps down to no impulse
 	resultVelA += impulseReactionary * n * invMassA;
 	resultAngVelA += raP.Dot(impulseReactionary * n) * invIA;
 	resultVelB -= impulseReactionary * n * invMassB;
@@ -285,7 +548,7 @@ void Solver::ComputeResponse(const Manifold& manifold)
 	//If friction is bigger than this force, scale friction back to match
 	//https://en.wikipedia.org/wiki/Collision_response#:~:text=Impulse%2Dbased%20friction%20model,-Coulomb%20friction%20model&text=The%20Coulomb%20friction%20model%20effectively,the%20static%20configuration%20is%20maintained.
 	//Coulomb impulse based friction model
-	if (m_frictionModel)
+	if (m_frictionModel && !speculative)
 	{
 		/// <summary>
 		///#3D formula
@@ -338,34 +601,451 @@ void Solver::ComputeResponse(const Manifold& manifold)
 			<< "angVelA = " << resultAngVelA << " angVelB = " << resultAngVelB << endl;
 	}
 
-	rb1->m_velocity = resultVelA;
-	rb1->m_angularVelocity = resultAngVelA;
-	rb2->m_velocity = resultVelB;
-	rb2->m_angularVelocity = resultAngVelB;
+	//Kinematic bodies are never written, islands solved on other threads may be reading them
+	if (!rb1->m_isKinematic)
+	{
+		rb1->m_velocity = resultVelA;
+		rb1->m_angularVelocity = resultAngVelA;
+	}
+	if (!rb2->m_isKinematic)
+	{
+		rb2->m_velocity = resultVelB;
+		rb2->m_angularVelocity = resultAngVelB;
+	}
+}
+
+template <typename T>
+void BasicSolver<T>::BuildIslands(const std::vector<Rigidbody*>& rigidbodies)
+{
+	//Union find over dynamic bodies. Kinematic bodies and static segments are only read, they don't join islands
+	size_t bodyCount = rigidbodies.size();
+	size_t manifoldCount = m_currentManifolds.size();
+	m_islandParents.resize(bodyCount);
+	for (size_t i = 0; i < bodyCount; i++) m_islandParents[i] = i;
+	auto bodyIdx = [&](Rigidbody* rb) -> size_t {
+		if (rb->m_isKinematic) return SIZE_MAX;
+		//Pool order is address order
+		return std::lower_bound(rigidbodies.begin(), rigidbodies.end(), rb) - rigidbodies.begin();
+	};
+	auto find = [&](size_t i) {
+		while (m_islandParents[i] != i)
+		{
+			m_islandParents[i] = m_islandParents[m_islandParents[i]];
+			i = m_islandParents[i];
+		}
+		return i;
+	};
+	for (const Manifold& manifold : m_currentManifolds)
+	{
+		size_t a = bodyIdx(manifold.rb1);
+		size_t b = bodyIdx(manifold.rb2);
+		if (a == SIZE_MAX || b == SIZE_MAX) continue;
+		a = find(a);
+		b = find(b);
+		if (a != b) m_islandParents[std::max(a, b)] = std::min(a, b);
+	}
+	//Islands are numbered by their first manifold, m_islandOffsets counts each island's manifolds one slot ahead
+	m_islandIds.assign(bodyCount, SIZE_MAX);
+	m_manifoldIslands.resize(manifoldCount);
+	m_islandOffsets.assign(1, 0);
+	for (size_t i = 0; i < manifoldCount; i++)
+	{
+		size_t a = bodyIdx(m_currentManifolds[i].rb1);
+		if (a == SIZE_MAX) a = bodyIdx(m_currentManifolds[i].rb2);
+		size_t island;
+		if (a == SIZE_MAX)
+		{
+			//Nothing dynamic to write, an island of its own
+			island = m_islandOffsets.size() - 1;
+			m_islandOffsets.push_back(0);
+		}
+		else
+		{
+			size_t root = find(a);
+			if (m_islandIds[root] == SIZE_MAX)
+			{
+				m_islandIds[root] = m_islandOffsets.size() - 1;
+				m_islandOffsets.push_back(0);
+			}
+			island = m_islandIds[root];
+		}
+		m_manifoldIslands[i] = island;
+		m_islandOffsets[island + 1]++;
+	}
+	size_t islandCount = m_islandOffsets.size() - 1;
+	for (size_t i = 0; i < islandCount; i++) m_islandOffsets[i + 1] += m_islandOffsets[i];
+	//Parents are done with, they become each island's fill position
+	m_islandParents.assign(m_islandOffsets.begin(), m_islandOffsets.end() - 1);
+	m_islandManifolds.resize(manifoldCount);
+	for (size_t i = 0; i < manifoldCount; i++) m_islandManifolds[m_islandParents[m_manifoldIslands[i]]++] = i;
 }
 
 //Go through custom allocator
-int Solver::CreateCircle(Handle& handle, decimal rad, PipMath::Vector2 pos, decimal rot, PipMath::Vector2 vel, decimal angVel, decimal mass,
+template <typename T>
+int BasicSolver<T>::CreateCircle(Handle& handle, decimal rad, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass,
  decimal e, bool isKinematic)
 {
 	// Create the collision body, presumably a pool has been created beforehand
-	Handle circleHandle;
-	Circle* circle = new (m_allocator.AllocateBody(sizeof(Circle), circleHandle)) Circle(rad, pos, rot, vel, angVel, mass, e, isKinematic);
+	Circle* circle = new (m_allocator.AllocateBody(sizeof(Circle), handle)) Circle(rad, pos, rot, vel, angVel, mass, e, isKinematic);
+	m_stateHashStale = true;
 	return circle ? 0 : -1;
 }
 
-int Solver::CreateCapsule(Handle& handle, decimal length, decimal rad, PipMath::Vector2 pos, decimal rot, PipMath::Vector2 vel, decimal angVel, decimal mass, decimal e, bool isKinematic)
+template <typename T>
+int BasicSolver<T>::CreateCapsule(Handle& handle, decimal length, decimal rad, Vector2 pos, decimal rot, Vector2 vel, decimal angVel, decimal mass, decimal e, bool isKinematic)
 {
-	Handle capsuleHandle;
-	Capsule* capsule = new (m_allocator.AllocateBody(sizeof(Capsule), capsuleHandle)) Capsule(length, rad, pos, rot, vel, angVel, mass, e, isKinematic);
+	Capsule* capsule = new (m_allocator.AllocateBody(sizeof(Capsule), handle)) Capsule(length, rad, pos, rot, vel, angVel, mass, e, isKinematic);
+	m_stateHashStale = true;
 	return capsule ? 0 : -1;
 }
 
-int Solver::CreateOrientedBox(Handle& handle, PipMath::Vector2 halfExtents, PipMath::Vector2 pos, decimal rot, PipMath::Vector2 vel, decimal angVel,
+template <typename T>
+int BasicSolver<T>::CreateOrientedBox(Handle& handle, Vector2 halfExtents, Vector2 pos, decimal rot, Vector2 vel, decimal angVel,
  decimal mass, decimal e, bool isKinematic)
 {
-	Handle obbHandle;
-	OrientedBox* obb = new (m_allocator.AllocateBody(sizeof(OrientedBox), obbHandle)) OrientedBox(halfExtents, pos, rot, vel, angVel, mass, e, isKinematic);
+	OrientedBox* obb = new (m_allocator.AllocateBody(sizeof(OrientedBox), handle)) OrientedBox(halfExtents, pos, rot, vel, angVel, mass, e, isKinematic);
+	m_stateHashStale = true;
 	return obb ? 0 : -1;
 }
 
+template <typename T>
+int BasicSolver<T>::CreatePolygon(Handle& handle, const Vector2* vertices, size_t vertexCount, Vector2 pos, decimal rot, Vector2 vel,
+ decimal angVel, decimal mass, decimal e, bool isKinematic)
+{
+	if (!ConvexPolygon::IsValid(vertices, vertexCount))
+	{
+		cout << "PiP Error: CreatePolygon::Vertices don't make a convex polygon of 3 to " << POLYGON_MAX_VERTICES << " vertices" << endl;
+		return -1;
+	}
+	ConvexPolygon* polygon = new (m_allocator.AllocateBody(sizeof(ConvexPolygon), handle)) ConvexPolygon(vertices, vertexCount, pos, rot,
+	 vel, angVel, mass, e, isKinematic);
+	m_stateHashStale = true;
+	return polygon ? 0 : -1;
+}
+
+template <typename T>
+int BasicSolver<T>::CreateCompound(Handle& handle, const BodyDesc* children, size_t childCount, Vector2 pos, decimal rot, Vector2 vel,
+ decimal angVel, decimal mass, decimal e, bool isKinematic)
+{
+	if (!Compound::IsValid(children, childCount))
+	{
+		cout << "PiP Error: CreateCompound::Needs 1 to " << COMPOUND_MAX_CHILDREN << " Circle, Capsule or Obb children with positive areas" << endl;
+		return -1;
+	}
+	Compound* compound = new (m_allocator.AllocateBody(sizeof(Compound), handle)) Compound(children, childCount, pos, rot, vel, angVel,
+	 mass, e, isKinematic);
+	m_stateHashStale = true;
+	return compound ? 0 : -1;
+}
+
+
+template <typename T>
+int BasicSolver<T>::CreateBodies(const BodyDesc* descs, size_t count, Handle* handles)
+{
+	if (count == 0) return 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (descs[i].bodyType == BodyType::Polygon && !ConvexPolygon::IsValid(descs[i].vertices, descs[i].vertexCount))
+		{
+			cout << "PiP Error: CreateBodies::Descriptor " << i << " isn't a convex polygon" << endl;
+			return -1;
+		}
+		if (descs[i].bodyType == BodyType::Compound && !Compound::IsValid(descs[i].children, descs[i].childCount))
+		{
+			cout << "PiP Error: CreateBodies::Descriptor " << i << " has invalid compound children" << endl;
+			return -1;
+		}
+	}
+	std::vector<size_t> lengths(count);
+	for (size_t i = 0; i < count; i++) lengths[i] = m_allocator.GetBodyByteSize(descs[i].bodyType);
+	char* memory = (char*)m_allocator.AllocateBodies(lengths.data(), count, handles);
+	if (!memory) return -1;
+	m_stateHashStale = true;
+	//Bodies are laid out in descriptor order, construct them in place
+	for (size_t i = 0; i < count; i++)
+	{
+		const BodyDesc& desc = descs[i];
+		switch (desc.bodyType)
+		{
+		case BodyType::Circle:
+		{
+			new (memory) Circle(desc.radius, desc.position, desc.rotation, desc.velocity, desc.angularVelocity, desc.mass, desc.e,
+			 desc.isKinematic);
+			break;
+		}
+		case BodyType::Capsule:
+		{
+			new (memory) Capsule(desc.length, desc.radius, desc.position, desc.rotation, desc.velocity, desc.angularVelocity, desc.mass,
+			 desc.e, desc.isKinematic);
+			break;
+		}
+		case BodyType::Obb:
+		{
+			new (memory) OrientedBox(desc.halfExtents, desc.position, desc.rotation, desc.velocity, desc.angularVelocity, desc.mass,
+			 desc.e, desc.isKinematic);
+			break;
+		}
+		case BodyType::Polygon:
+		{
+			new (memory) ConvexPolygon(desc.vertices, desc.vertexCount, desc.position, desc.rotation, desc.velocity, desc.angularVelocity,
+			 desc.mass, desc.e, desc.isKinematic);
+			break;
+		}
+		case BodyType::Compound:
+		{
+			new (memory) Compound(desc.children, desc.childCount, desc.position, desc.rotation, desc.velocity, desc.angularVelocity,
+			 desc.mass, desc.e, desc.isKinematic);
+			break;
+		}
+		}
+		memory += lengths[i];
+	}
+	return 0;
+}
+
+template <typename T>
+int BasicSolver<T>::CreateChain(const Vector2* vertices, size_t vertexCount, bool loop, decimal thickness, decimal e)
+{
+	if (vertexCount < 2)
+	{
+		cout << "PiP Error: CreateChain::A chain needs at least 2 vertices" << endl;
+		return -1;
+	}
+	m_staticShapes.push_back(new BasicChain<T>(vertices, vertexCount, loop, thickness, e));
+	return 0;
+}
+
+template <typename T>
+int BasicSolver<T>::CreateHeightfield(const decimal* heights, size_t sampleCount, Vector2 origin, decimal spacing, decimal depth, decimal e)
+{
+	if (sampleCount < 2 || spacing <= 0)
+	{
+		cout << "PiP Error: CreateHeightfield::A heightfield needs at least 2 samples and a positive spacing" << endl;
+		return -1;
+	}
+	m_staticShapes.push_back(new BasicHeightfield<T>(heights, sampleCount, origin, spacing, depth, e));
+	return 0;
+}
+
+template <typename T>
+void BasicSolver<T>::DestroyStaticShapes()
+{
+	for (StaticShape* shape : m_staticShapes) delete shape;
+	m_staticShapes.clear();
+	//Manifolds may point at their segments
+	m_currentManifolds.clear();
+}
+
+template <typename T>
+void BasicSolver<T>::DestroyBodies(const Handle* handles, size_t count)
+{
+	m_allocator.DestroyBodies(handles, count);
+	//Manifolds and leaf nodes may point at displaced bodies, they get rebuilt next Step()
+	m_currentManifolds.clear();
+	m_stateHashStale = true;
+}
+
+template <typename T>
+void BasicSolver<T>::ReservePool(size_t size)
+{
+	m_allocator.ReservePool(size);
+	//Manifolds may point into the old pool, they get rebuilt next Step()
+	m_currentManifolds.clear();
+}
+
+template <typename T>
+size_t BasicSolver<T>::DestroyBodiesInRegion(Vector2 topRight, Vector2 bottomLeft)
+{
+	std::vector<Handle> handles;
+	size_t objIdx = 0;
+	for (Rigidbody* rb = m_allocator.GetFirstBody(); rb != nullptr; rb = m_allocator.GetNextBody(rb), objIdx++)
+	{
+		if (rb->IntersectWith(topRight, bottomLeft))
+		{
+			size_t mappingIdx = m_allocator.m_objectToMappingIdx[objIdx];
+			handles.push_back(Handle(mappingIdx, m_allocator.m_mappings[mappingIdx].generation));
+		}
+	}
+	DestroyBodies(handles.data(), handles.size());
+	return handles.size();
+}
+
+template <typename T>
+size_t BasicSolverState<T>::ByteSize() const
+{
+	return pool.size() + mappings.size() * sizeof(Idx) + objectToMappingIdx.size() * sizeof(size_t) + quadTreeShape.size() + sizeof(accumulator);
+}
+
+template <typename T>
+void BasicSolver<T>::SaveState(SolverState& state)
+{
+	state.pool.assign(m_allocator.m_pool.start, m_allocator.m_pool.next);
+	state.mappings.assign(m_allocator.m_mappings.begin(), m_allocator.m_mappings.end());
+	state.objectToMappingIdx.assign(m_allocator.m_objectToMappingIdx.begin(), m_allocator.m_objectToMappingIdx.end());
+	state.quadTreeShape.clear();
+	m_quadTreeRoot.SaveShape(state.quadTreeShape);
+	state.accumulator = m_accumulator;
+}
+
+template <typename T>
+int BasicSolver<T>::RestoreState(const SolverState& state)
+{
+	Pool& pool = m_allocator.m_pool;
+	if (state.pool.size() > (size_t)(pool.end - pool.start))
+	{
+		cout << "PiP Error: RestoreState::State doesn't fit in pool" << endl;
+		return -1;
+	}
+	char* prevNext = pool.next;
+	if (!state.pool.empty()) memcpy(pool.start, state.pool.data(), state.pool.size());
+	pool.next = pool.start + state.pool.size();
+	if (prevNext > pool.next) memset(pool.next, 0, prevNext - pool.next);//Keep unused pool zeroed
+	m_allocator.m_mappings.assign(state.mappings.begin(), state.mappings.end());
+	m_allocator.m_objectToMappingIdx.assign(state.objectToMappingIdx.begin(), state.objectToMappingIdx.end());
+	m_quadTreeRoot.RestoreShape(state.quadTreeShape.data(), state.quadTreeShape.size());
+	m_accumulator = state.accumulator;
+	//Manifolds point at bodies from the discarded timeline
+	m_currentManifolds.clear();
+	m_stateHashStale = true;
+	return 0;
+}
+
+template <typename T>
+int BasicSolver<T>::Resimulate(const SolverState& state, unsigned int steps)
+{
+	if (RestoreState(state) == -1) return -1;
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		(m_continuousCollision) ? ContinuousStep(m_timestep) : Step(m_timestep);
+	}
+	return 0;
+}
+
+template <typename T>
+uint64_t BasicSolver<T>::HashState()
+{
+	m_bodyHashes.clear();
+	for (Rigidbody* rb = m_allocator.GetFirstBody(); rb != nullptr; rb = m_allocator.GetNextBody(rb)) m_bodyHashes.push_back(HashBody(rb));
+	m_stateHash = CombineBodyHashes();
+	m_stateHashStale = false;
+	return m_stateHash;
+}
+
+template <typename T>
+void BasicSolver<T>::GetBroadphaseDiagnostics(BroadphaseDiagnostics& diagnostics)
+{
+	std::vector<Rigidbody*> rigidbodies;
+	for (Rigidbody* rb = m_allocator.GetFirstBody(); rb != nullptr; rb = m_allocator.GetNextBody(rb)) rigidbodies.push_back(rb);
+	std::vector<QuadNode*> leafNodes;
+	m_quadTreeRoot.GetLeafNodes(leafNodes);
+	diagnostics.leavesPerDepth.clear();
+	diagnostics.leavesPerBodyCount.clear();
+	diagnostics.leafBodies.assign(leafNodes.size(), 0);
+	diagnostics.leafPairTests.assign(leafNodes.size(), 0);
+	diagnostics.pairTests = 0;
+	//Pairs are keyed by both bodies' pool positions, lower first
+	std::vector<size_t> leavesPerBody(rigidbodies.size(), 0);
+	std::vector<uint64_t> pairs;
+	std::vector<size_t> leafBodies;
+	for (size_t i = 0; i < leafNodes.size(); i++)
+	{
+		QuadNode* leafNode = leafNodes[i];
+		size_t depth = 0;
+		for (QuadNode* node = leafNode->m_owner; node; node = node->m_owner) depth++;
+		if (diagnostics.leavesPerDepth.size() <= depth) diagnostics.leavesPerDepth.resize(depth + 1, 0);
+		diagnostics.leavesPerDepth[depth]++;
+		leafBodies.clear();
+		for (size_t j = 0; j < rigidbodies.size(); j++)
+		{
+			if (!rigidbodies[j]->IntersectWith(leafNode->m_topRight, leafNode->m_bottomLeft)) continue;
+			leafBodies.push_back(j);
+			leavesPerBody[j]++;
+		}
+		diagnostics.leafBodies[i] = leafBodies.size();
+		if (diagnostics.leavesPerBodyCount.size() <= leafBodies.size()) diagnostics.leavesPerBodyCount.resize(leafBodies.size() + 1, 0);
+		diagnostics.leavesPerBodyCount[leafBodies.size()]++;
+		for (size_t j = 0; j < leafBodies.size(); j++)
+		{
+			Rigidbody* rb1 = rigidbodies[leafBodies[j]];
+			for (size_t k = j + 1; k < leafBodies.size(); k++)
+			{
+				Rigidbody* rb2 = rigidbodies[leafBodies[k]];
+				//Same skip as Step
+				if ((rb1->m_isSleeping || rb1->m_isKinematic) && (rb2->m_isSleeping || rb2->m_isKinematic)) continue;
+				diagnostics.leafPairTests[i]++;
+				pairs.push_back((uint64_t)leafBodies[j] << 32 | (uint64_t)leafBodies[k]);
+			}
+		}
+		diagnostics.pairTests += diagnostics.leafPairTests[i];
+	}
+	diagnostics.bodiesInSeveralLeaves = std::count_if(leavesPerBody.begin(), leavesPerBody.end(), [](size_t leaves) { return leaves > 1; });
+	sort(pairs.begin(), pairs.end());
+	pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+	diagnostics.uniquePairs = pairs.size();
+	diagnostics.overlaps = 0;
+	for (uint64_t pair : pairs)
+	{
+		Manifold manifold;
+		if (IntersectPair(rigidbodies[pair >> 32], rigidbodies[pair & 0xffffffff], manifold)) diagnostics.overlaps++;
+	}
+	diagnostics.efficiency = diagnostics.pairTests ? (float)diagnostics.overlaps / (float)diagnostics.pairTests : 1.f;
+}
+
+template <typename T>
+void BasicSolver<T>::GetMemoryReport(MemoryReport& report)
+{
+	report.solver = sizeof(*this);
+	report.poolUsed = m_allocator.m_pool.next - m_allocator.m_pool.start;
+	report.poolReserved = m_allocator.m_ownsPool ? m_allocator.m_pool.end - m_allocator.m_pool.start : 0;
+	report.mappingTables = VectorBytes(m_allocator.m_mappings) + VectorBytes(m_allocator.m_objectToMappingIdx);
+	report.quadTreeNodes = m_quadTreeRoot.GetNodeCount();
+	report.quadTreeBytes = (report.quadTreeNodes - 1 + m_freeQuadNodes.size() * 4) * sizeof(QuadNode) + VectorBytes(m_freeQuadNodes);
+	report.leafVectors = VectorBytes(m_leafBodies);
+	for (std::vector<Rigidbody*>& leafBodies : m_leafBodies) report.leafVectors += VectorBytes(leafBodies);
+	report.manifolds = VectorBytes(m_currentManifolds) + VectorBytes(m_staticManifolds) + VectorBytes(m_leafManifolds);
+	for (std::vector<Manifold>& leafManifolds : m_leafManifolds) report.manifolds += VectorBytes(leafManifolds);
+	report.narrowphase = m_narrowphase.GetByteSize();
+	report.staticShapes = VectorBytes(m_staticShapes);
+	for (StaticShape* shape : m_staticShapes) report.staticShapes += shape->GetByteSize();
+	report.scratch = VectorBytes(m_stepBodies) + VectorBytes(m_leafNodes) + VectorBytes(m_leafParents) + VectorBytes(m_staticCandidates) + VectorBytes(m_leafPairTests) + VectorBytes(m_bodyHashes) + VectorBytes(m_islandParents) + VectorBytes(m_islandIds)
+	 + VectorBytes(m_manifoldIslands) + VectorBytes(m_islandManifolds) + VectorBytes(m_islandOffsets);
+	for (std::vector<OrientedBox*>& candidates : m_staticCandidates) report.scratch += VectorBytes(candidates);
+	report.total = report.solver + report.poolReserved + report.mappingTables + report.quadTreeBytes + report.leafVectors
+	 + report.manifolds + report.narrowphase + report.staticShapes + report.scratch;
+}
+
+template <typename T>
+uint64_t BasicSolver<T>::HashBody(const Rigidbody* rb)
+{
+	uint64_t hash = PIP_FNV_OFFSET;
+	FnvMix(hash, &rb->m_bodyType, sizeof(rb->m_bodyType));
+	FnvMix(hash, &rb->m_position, sizeof(rb->m_position));
+	FnvMix(hash, &rb->m_rotation, sizeof(rb->m_rotation));
+	FnvMix(hash, &rb->m_velocity, sizeof(rb->m_velocity));
+	FnvMix(hash, &rb->m_angularVelocity, sizeof(rb->m_angularVelocity));
+	FnvMix(hash, &rb->m_isSleeping, sizeof(rb->m_isSleeping));
+	FnvMix(hash, &rb->m_timeInSleep, sizeof(rb->m_timeInSleep));
+	return hash;
+}
+
+template <typename T>
+uint64_t BasicSolver<T>::CombineBodyHashes()
+{
+	//Handles outlive pool moves, destroying a body reorders the pool but not the handles of the rest
+	uint64_t hash = PIP_FNV_OFFSET;
+	for (size_t i = 0; i < m_allocator.m_mappings.size(); i++)
+	{
+		const Idx& mapping = m_allocator.m_mappings[i];
+		if (!mapping.active || mapping.idx >= m_bodyHashes.size()) continue;
+		uint64_t handleIdx = i;
+		FnvMix(hash, &handleIdx, sizeof(handleIdx));
+		FnvMix(hash, &mapping.generation, sizeof(mapping.generation));
+		FnvMix(hash, &m_bodyHashes[mapping.idx], sizeof(uint64_t));
+	}
+	return hash;
+}
+
+template class BasicSolver<float>;
+template class BasicSolver<fp64::Fp64>;
+template class BasicSolverState<float>;
+template class BasicSolverState<fp64::Fp64>;
@@ -6,31 +6,205 @@
 #include "Rigidbody.h"
 #include "DefaultAllocator.h"
 #include "QuadNode.h"
+#include "NarrowphaseBatch.h"
+#include "StaticShape.h"
+#include "JobSystem.h"
+#include "TraceRecorder.h"
 
-class Solver
+//Describes one body for batch creation, shape params are read according to bodyType
+template <typename T>
+struct BasicBodyDesc
+{
+	typedef T decimal;
+	typedef PipMath::BasicVector2<T> Vector2;
+
+	BasicBodyDesc(BodyType bodyType = BodyType::Circle)
+		: bodyType(bodyType), radius(1.f), length(1.f), halfExtents(1.f, 1.f), vertices(nullptr), vertexCount(0), children(nullptr),
+		childCount(0), position(),
+		rotation(0.f), velocity(), angularVelocity(0.f), mass(1.f), e(1.f), isKinematic(false)
+	{
+	}
+	BodyType bodyType;
+	decimal radius;//Circle, Capsule
+	decimal length;//Capsule
+	Vector2 halfExtents;//Obb
+	const Vector2* vertices;//Polygon, copied on creation
+	size_t vertexCount;//Polygon
+	const BasicBodyDesc* children;//Compound, their position and rotation are relative to the body
+	size_t childCount;//Compound
+	Vector2 position;
+	decimal rotation;
+	Vector2 velocity;
+	decimal angularVelocity;
+	decimal mass;
+	decimal e;
+	bool isKinematic;
+};
+typedef BasicBodyDesc<decimal> BodyDesc;
+
+//Flat copy of the simulation state for rollback. Bodies are stored raw (vtable included), so a state is only valid
+//within the process that saved it. Buffers keep their capacity, saving into the same state again doesn't allocate
+template <typename T>
+struct BasicSolverState
+{
+	std::vector<char> pool;
+	std::vector<Idx> mappings;
+	std::vector<size_t> objectToMappingIdx;
+	std::vector<char> quadTreeShape;//Preorder leaf flags, node bounds are derived when subdividing
+	T accumulator;
+	size_t ByteSize() const;
+};
+typedef BasicSolverState<decimal> SolverState;
+
+//Parts of a discrete step, timed into Solver::m_phaseTimes
+enum class StepPhase
+{
+	Integration,//Forces, integration and the sleep check
+	Broadphase,//Binning bodies into quadtree leaves and the tree's upkeep
+	Narrowphase,//Pair tests and static shape queries
+	Response,//Contact islands
+	Count
+};
+const char* GetStepPhaseName(StepPhase phase);
+
+//What the last Step went through, alongside Solver::m_phaseTimes
+struct StepStats
+{
+	size_t pairTests;//Body pairs handed to the narrowphase, static shape queries aside
+	size_t manifolds;//Contacts found, static ones included
+	size_t islands;
+	size_t awakeBodies;//Dynamic bodies that aren't sleeping
+	size_t sleepingBodies;
+	size_t kinematicBodies;
+	size_t leafCount;//Quadtree leaves the step binned bodies into
+	unsigned int quadTreeDepth;//After the step's subdivides and merges, 1 is the root alone
+};
+
+//How well the quadtree splits the current bodies, for tuning QNODE_SUBDIVIDE_THRESHOLD and QNODE_MERGE_THRESHOLD.
+//Bodies are binned the way the next Step would bin them. Leaf vectors follow QuadNode::GetLeafNodes order
+struct BroadphaseDiagnostics
+{
+	std::vector<size_t> leavesPerDepth;//[d] is the number of leaves d levels below the root
+	std::vector<size_t> leavesPerBodyCount;//[n] is the number of leaves holding n bodies
+	std::vector<size_t> leafBodies;//Bodies per leaf
+	std::vector<size_t> leafPairTests;//Pairs each leaf hands to the narrowphase
+	size_t bodiesInSeveralLeaves;//Straddling a leaf edge, every leaf they're in tests them again
+	size_t pairTests;//Summed over leaves, pairs tested in more than one leaf count every time
+	size_t uniquePairs;
+	size_t overlaps;//Unique pairs whose shapes really touch
+	float efficiency;//overlaps / pairTests, 1 would be a broadphase that only reports contacts
+};
+
+//Bytes held by one solver, vectors counted by capacity. Pool and quadtree nodes come from AllocationHooks, the rest
+//from the standard allocator
+struct MemoryReport
+{
+	size_t solver;//The Solver object itself, quadtree root and job system included
+	size_t poolUsed;
+	size_t poolReserved;//0 when the pool belongs to someone else, see DefaultAllocator::UsePool
+	size_t mappingTables;//m_mappings and m_objectToMappingIdx
+	size_t quadTreeNodes;//Root included
+	size_t quadTreeBytes;//Nodes below the root, and blocks kept for reuse
+	size_t leafVectors;//Per leaf body lists
+	size_t manifolds;//m_currentManifolds, per leaf and static shape lists
+	size_t narrowphase;
+	size_t staticShapes;
+	size_t scratch;//Step's body and leaf lists, islands, static candidates, per leaf counts and body hashes
+	size_t total;//All of the above but poolUsed, which poolReserved holds
+};
+
+//Determinism: a step's outcome doesn't depend on the scheduler. Every parallel range writes only its own bodies, leaves
+//or output slots, manifolds are gathered in leaf order then body order, islands are numbered by their first manifold
+//and solve their manifolds in that order, and nothing is summed across threads. Float and Fp64 worlds alike come out bit
+//for bit the same on any number of threads, as long as the scheduler runs every range exactly once
+template <typename T>
+class BasicSolver
 {
 public:
-	Solver();
-	~Solver();
+	PIP_SCALAR_TYPES(T)
+	typedef BasicDefaultAllocator<T> DefaultAllocator;
+	typedef BasicQuadNode<T> QuadNode;
+	typedef BasicBodyDesc<T> BodyDesc;
+	typedef BasicSolverState<T> SolverState;
+	typedef BasicNarrowphaseBatch<T> NarrowphaseBatch;
+	typedef BasicStaticShape<T> StaticShape;
+
+	BasicSolver();
+	explicit BasicSolver(size_t poolSize);//0 leaves the allocator without a pool, see DefaultAllocator::UsePool
+	~BasicSolver();
 	void Update(decimal dt);//Updates the time and executes fixed timestep Step();
+	decimal GetInterpolationAlpha();//How far Update is into the next step, draw bodies at m_prevPos + (m_position - m_prevPos) * alpha
 	void ContinuousStep(decimal dt);//#Not supported: CCD Step physics forward
 	void Step(decimal dt);// Discrete step
-	void ComputeResponse(const PipMath::Manifold& manifold);
-	int CreateCircle(Handle& handle, decimal rad = 1.0f, PipMath::Vector2 pos = PipMath::Vector2(), decimal rot = 0.0f,
-	 PipMath::Vector2 vel = PipMath::Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
-	int CreateCapsule(Handle& handle, decimal length = 1.0f, decimal rad = 1.0f, PipMath::Vector2 pos = PipMath::Vector2(), decimal rot = 0.0f,
-	 PipMath::Vector2 vel = PipMath::Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
-	int CreateOrientedBox(Handle& handle, PipMath::Vector2 halfExtents = PipMath::Vector2(1.f, 1.f), PipMath::Vector2 pos = PipMath::Vector2(),
-	 decimal rot = 0.0f, PipMath::Vector2 vel = PipMath::Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f,
+	//Negative penetration is a speculative contact: only the approach that would close the gap within dt is removed
+	void ComputeResponse(const Manifold& manifold, decimal dt);
+	int CreateCircle(Handle& handle, decimal rad = 1.0f, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	int CreateCapsule(Handle& handle, decimal length = 1.0f, decimal rad = 1.0f, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	int CreateOrientedBox(Handle& handle, Vector2 halfExtents = Vector2(1.f, 1.f), Vector2 pos = Vector2(),
+	 decimal rot = 0.0f, Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f,
 	 bool isKinematic = false);
+	//Returns -1 unless the vertices make a convex polygon of 3 to POLYGON_MAX_VERTICES, pos is its centroid
+	int CreatePolygon(Handle& handle, const Vector2* vertices, size_t vertexCount, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	//Returns -1 unless there are 1 to COMPOUND_MAX_CHILDREN Circle, Capsule or Obb children, pos is their centroid
+	int CreateCompound(Handle& handle, const BodyDesc* children, size_t childCount, Vector2 pos = Vector2(), decimal rot = 0.0f,
+	 Vector2 vel = Vector2(), decimal angVel = 0.0f, decimal mass = 1.0f, decimal e = 1.f, bool isKinematic = false);
+	int CreateBodies(const BodyDesc* descs, size_t count, Handle* handles);//All or nothing, fills handles[count]
+	//Static level geometry, owned by the solver until DestroyStaticShapes. Returns -1 if there's no segment to build
+	int CreateChain(const Vector2* vertices, size_t vertexCount, bool loop = false, decimal thickness = 0.1f, decimal e = 1.f);
+	int CreateHeightfield(const decimal* heights, size_t sampleCount, Vector2 origin, decimal spacing, decimal depth = 1.f,
+	 decimal e = 1.f);
+	void DestroyStaticShapes();
+	void DestroyBodies(const Handle* handles, size_t count);
+	void ReservePool(size_t size);//Grows the allocator's pool, the current manifolds go with the bodies' old addresses
+	size_t DestroyBodiesInRegion(Vector2 topRight, Vector2 bottomLeft);//Returns number of bodies destroyed
+	void SaveState(SolverState& state);
+	int RestoreState(const SolverState& state);//Returns -1 if state doesn't fit in the pool
+	int Resimulate(const SolverState& state, unsigned int steps);//Restore and step forward with the fixed timestep
+	//FNV-1a over every body's transform, velocities and sleep state, combined in handle order. Caches and hints are left
+	//out, two solvers that took the same steps hash the same whatever their thread counts or pool layout. Step keeps
+	//m_stateHash up to date as it goes, this is the full pass for a state that didn't come from Step
+	uint64_t HashState();
+	static uint64_t HashBody(const Rigidbody* rb);
+	void GetBroadphaseDiagnostics(BroadphaseDiagnostics& diagnostics);//Runs every unique pair's narrowphase test, not for every frame
+	void GetMemoryReport(MemoryReport& report);
+private:
+	void BuildIslands(const std::vector<Rigidbody*>& rigidbodies);//Groups m_currentManifolds by the dynamic bodies they share
+	uint64_t CombineBodyHashes();//m_bodyHashes in handle order
 public:
 	DefaultAllocator m_allocator;
 	QuadNode m_quadTreeRoot;
 	bool m_continuousCollision, m_stepMode, m_stepOnce, m_quadTreeSubdivision, m_staticResolution, m_logCollisionInfo, 
-	m_frictionModel;//#Bit field?
+	m_frictionModel, m_batchNarrowphase, m_speculativeContacts;//#Bit field?
 	decimal m_accumulator;
 	decimal m_timestep;
 	decimal m_gravity;
 	decimal m_airViscosity;
-	std::vector<PipMath::Manifold> m_currentManifolds;
+	std::vector<Manifold> m_currentManifolds;
+	NarrowphaseBatch m_narrowphase;//Pairs of the current step, reused across steps
+	std::vector<StaticShape*> m_staticShapes;
+	std::vector<std::vector<OrientedBox*>> m_staticCandidates;//Scratch for static shape queries, one per scheduler thread
+	std::vector<Manifold> m_staticManifolds;//Deepest contact per body and static shape, rb1 is null where nothing touched
+	std::vector<Rigidbody*> m_stepBodies;//Bodies in pool order, gathered at the start of each Step
+	std::vector<QuadNode*> m_leafNodes;//Leaves the step bins into, in GetLeafNodes order
+	std::vector<QuadNode*> m_leafParents;//Merge candidates
+	std::vector<std::vector<Rigidbody*>> m_leafBodies;//Bodies binned per leaf, by index in m_leafNodes
+	std::vector<QuadNode*> m_freeQuadNodes;//Child blocks merged away, for the next subdivide. Owned, freed with the solver
+	std::vector<std::vector<Manifold>> m_leafManifolds;//Unbatched narrowphase hits per leaf
+	std::vector<size_t> m_leafPairTests;//Unbatched narrowphase pairs tested per leaf
+	//Contact islands of the current step: m_islandManifolds holds manifold indices island by island, island i spans
+	//[m_islandOffsets[i], m_islandOffsets[i + 1])
+	std::vector<size_t> m_islandParents, m_islandIds, m_manifoldIslands, m_islandManifolds, m_islandOffsets;
+	JobSystem m_jobSystem;//One thread until SetThreadCount
+	TaskScheduler* m_scheduler;//Runs the step's phases, m_jobSystem unless a host engine plugs in its own. Null runs inline
+	double m_phaseTimes[(int)StepPhase::Count];//Milliseconds the last Step spent in each phase
+	StepStats m_stepStats;
+	std::vector<uint64_t> m_bodyHashes;//HashBody of each body in pool order, written by the last pass of Step
+	uint64_t m_stateHash;//HashState of the state the last Step left
+	bool m_stateHashStale;//Bodies were created, destroyed, restored or edited since, m_stateHash and m_bodyHashes need a HashState
+	TraceRecorder* m_trace;//Null unless tracing: records Update, Step, their phases and ranges, sleep and quadtree changes
+	TraceScheduler m_traceScheduler;//Wraps m_scheduler while tracing
 };
+typedef BasicSolver<decimal> Solver;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "PipMath.h"
+#include "Rigidbody.h"
+#include "OrientedBox.h"
+
+enum class StaticShapeType
+{
+	Chain,
+	Heightfield
+};
+
+//Level geometry made of many segments. Never moves, isn't allocated in the body pool nor binned in the quadtree: each
+//shape finds the segments near a body itself. Segments collide through kinematic OrientedBox proxies, so the existing
+//narrowphase and ComputeResponse handle them like any other kinematic body
+template <typename T>
+class BasicStaticShape
+{
+public:
+	PIP_SCALAR_TYPES(T)
+
+	virtual ~BasicStaticShape() {}
+	//Appends the segment proxies that may overlap the box. Never misses one, can return a few neighbours that don't
+	virtual void Query(Vector2 topRight, Vector2 bottomLeft, std::vector<OrientedBox*>& segments) = 0;
+	virtual size_t GetByteSize() = 0;//The shape and the capacity of its buffers
+public:
+	StaticShapeType m_shapeType;
+	std::vector<OrientedBox> m_segments;//One kinematic proxy per segment
+};
+typedef BasicStaticShape<decimal> StaticShape;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+
+//Runs [begin, end) of a parallel-for on the thread numbered threadIdx, below the scheduler's GetThreadCount()
+typedef void (*TaskFunction)(void* context, size_t begin, size_t end, unsigned int threadIdx);
+
+//What the solver needs from a thread pool. JobSystem is the default, a host engine can implement this over its own
+//workers and point Solver::m_scheduler at it
+class TaskScheduler
+{
+public:
+	virtual ~TaskScheduler() {}
+	//Splits [0, count) in ranges of at most grain and returns once every range has run. Not reentrant, tasks mustn't
+	//start a ParallelFor of their own
+	virtual void ParallelFor(size_t count, size_t grain, TaskFunction task, void* context) = 0;
+	virtual unsigned int GetThreadCount() = 0;//Including the thread that calls ParallelFor
+};
+
+//Runs f(begin, end, threadIdx) over [0, count) on scheduler, or inline on this thread when there's none
+template <typename F>
+void ParallelFor(TaskScheduler* scheduler, size_t count, size_t grain, F f)
+{
+	if (!scheduler)
+	{
+		if (count) f((size_t)0, count, 0u);
+		return;
+	}
+	scheduler->ParallelFor(count, grain, [](void* context, size_t begin, size_t end, unsigned int threadIdx) {
+		(*(F*)context)(begin, end, threadIdx);
+	}, &f);
+}
@@ -0,0 +1,113 @@
+#include "TraceRecorder.h"
+
+#include <stdio.h>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+TraceRecorder::TraceRecorder()
+	: m_threads(1), m_epoch(steady_clock::now())
+{
+}
+
+void TraceRecorder::Clear()
+{
+	for (TraceBuffer& buffer : m_threads) buffer.events.clear();
+	m_epoch = steady_clock::now();
+}
+
+void TraceRecorder::Reserve(unsigned int threadCount)
+{
+	if (m_threads.size() < threadCount) m_threads.resize(threadCount);
+}
+
+void TraceRecorder::Complete(unsigned int threadIdx, const char* name, TimePoint start, TimePoint end, const char* argName, int64_t arg)
+{
+	//A thread the buffers weren't reserved for can't be given one without a lock, its events are dropped
+	if (threadIdx >= m_threads.size()) return;
+	double startUs = ToMicroseconds(start);
+	m_threads[threadIdx].events.push_back(TraceEvent{ name, 'X', startUs, ToMicroseconds(end) - startUs, argName, arg });
+}
+
+void TraceRecorder::Instant(unsigned int threadIdx, const char* name, const char* argName, int64_t arg)
+{
+	if (threadIdx >= m_threads.size()) return;
+	m_threads[threadIdx].events.push_back(TraceEvent{ name, 'i', ToMicroseconds(steady_clock::now()), 0, argName, arg });
+}
+
+size_t TraceRecorder::GetEventCount()
+{
+	size_t count = 0;
+	for (TraceBuffer& buffer : m_threads) count += buffer.events.size();
+	return count;
+}
+
+int TraceRecorder::Write(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		cout << "PiP Error: TraceRecorder::Write couldn't open " << path << endl;
+		return -1;
+	}
+	//Thread tracks are named first, then each thread's events. Viewers sort by timestamp themselves
+	bool written = fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n") > 0;
+	for (size_t t = 0; t < m_threads.size() && written; t++)
+	{
+		written = fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"PiP thread %u\"}}",
+		 t ? ",\n" : "", (unsigned int)t, (unsigned int)t) > 0;
+	}
+	for (size_t t = 0; t < m_threads.size() && written; t++)
+	{
+		for (const TraceEvent& event : m_threads[t].events)
+		{
+			written = fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"pip\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", event.name, event.phase,
+			 (unsigned int)t, event.start) > 0;
+			if (written && event.phase == 'X') written = fprintf(file, ",\"dur\":%.3f", event.duration) > 0;
+			if (written && event.phase == 'i') written = fprintf(file, ",\"s\":\"t\"") > 0;
+			if (written && event.argName) written = fprintf(file, ",\"args\":{\"%s\":%lld}", event.argName, (long long)event.arg) > 0;
+			if (written) written = fprintf(file, "}") > 0;
+			if (!written) break;
+		}
+	}
+	if (written) written = fprintf(file, "\n]}\n") > 0;
+	if (fclose(file) != 0) written = false;
+	if (!written)
+	{
+		cout << "PiP Error: TraceRecorder::Write failed writing " << path << endl;
+		return -1;
+	}
+	return 0;
+}
+
+double TraceRecorder::ToMicroseconds(TimePoint time)
+{
+	return duration<double, micro>(time - m_epoch).count();
+}
+
+TraceScheduler::TraceScheduler()
+	: m_scheduler(nullptr), m_trace(nullptr), m_label("Task")
+{
+}
+
+void TraceScheduler::ParallelFor(size_t count, size_t grain, TaskFunction task, void* context)
+{
+	if (!m_trace)
+	{
+		::ParallelFor(m_scheduler, count, grain, [&](size_t begin, size_t end, unsigned int threadIdx) {
+			task(context, begin, end, threadIdx);
+		});
+		return;
+	}
+	::ParallelFor(m_scheduler, count, grain, [&](size_t begin, size_t end, unsigned int threadIdx) {
+		TraceRecorder::TimePoint start = steady_clock::now();
+		task(context, begin, end, threadIdx);
+		m_trace->Complete(threadIdx, m_label, start, steady_clock::now(), "items", (int64_t)(end - begin));
+	});
+}
+
+unsigned int TraceScheduler::GetThreadCount()
+{
+	return m_scheduler ? m_scheduler->GetThreadCount() : 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+
+#include "TaskScheduler.h"
+
+#define PIP_CACHE_LINE 64
+
+//One event of the trace, see TraceRecorder::Write for how it's written out
+struct TraceEvent
+{
+	const char* name;//Static strings only, events keep the pointer
+	char phase;//'X' complete event or 'i' instant
+	double start;//Microseconds since the recorder's epoch
+	double duration;
+	const char* argName;//Null if the event has no argument
+	int64_t arg;
+};
+
+//One thread's events. Each buffer gets a cache line of its own, the vector's end pointer moves with every event and
+//would otherwise keep invalidating the neighbouring threads' buffers
+struct alignas(PIP_CACHE_LINE) TraceBuffer
+{
+	std::vector<TraceEvent> events;
+};
+
+//Records a solver's timeline as Chrome trace events, for chrome://tracing or Perfetto. Every thread appends to a
+//buffer of its own, indexed by the threadIdx its scheduler gave it, so recording takes no lock. Buffers keep their
+//capacity across Clear, Write merges them into one JSON file at the end of a capture
+class TraceRecorder
+{
+public:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	TraceRecorder();
+	void Clear();//Drops the events, starts a new capture
+	void Reserve(unsigned int threadCount);//Buffers for threads 0 to threadCount - 1, call while nothing's recording
+	void Complete(unsigned int threadIdx, const char* name, TimePoint start, TimePoint end, const char* argName = nullptr, int64_t arg = 0);
+	void Instant(unsigned int threadIdx, const char* name, const char* argName = nullptr, int64_t arg = 0);
+	size_t GetEventCount();
+	int Write(const char* path);//Chrome trace event JSON, -1 if the file can't be written
+private:
+	double ToMicroseconds(TimePoint time);
+public:
+	std::vector<TraceBuffer> m_threads;//Events of each thread, in the order it recorded them
+	TimePoint m_epoch;
+};
+
+//Forwards parallel-fors to another scheduler, recording each range it runs on the thread that ran it
+class TraceScheduler :
+	public TaskScheduler
+{
+public:
+	TraceScheduler();
+	virtual void ParallelFor(size_t count, size_t grain, TaskFunction task, void* context) override;
+	virtual unsigned int GetThreadCount() override;
+public:
+	TaskScheduler* m_scheduler;//Null runs inline
+	TraceRecorder* m_trace;
+	const char* m_label;//Name given to the ranges, set between parallel-fors
+};
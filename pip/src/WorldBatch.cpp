@@ -0,0 +1,77 @@
+#include "WorldBatch.h"
+
+#include <cstddef>
+
+#include "AllocationHooks.h"
+
+#define PIP_WORLD_GRAIN 8//Worlds per parallel-for range
+
+template <typename T>
+BasicWorldBatch<T>::BasicWorldBatch(size_t worldCount, size_t poolSize, unsigned int threadCount)
+	: m_jobSystem(threadCount), m_worlds(nullptr), m_worldCount(worldCount), m_pools(nullptr), m_poolSize(poolSize)
+{
+	//Slices stay aligned for any body
+	m_poolSize = (poolSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+	m_pools = (char*)PipAllocate(m_poolSize * worldCount);
+	m_worlds = (Solver*)PipAllocate(sizeof(Solver) * worldCount);
+	if (!m_pools || !m_worlds)
+	{
+		std::cout << "PiP Error: WorldBatch failed to allocate " << worldCount << " worlds" << std::endl;
+		PipFree(m_pools);
+		PipFree(m_worlds);
+		m_pools = nullptr;
+		m_worlds = nullptr;
+		m_worldCount = 0;
+		return;
+	}
+	for (size_t i = 0; i < worldCount; i++)
+	{
+		Solver* world = new (&m_worlds[i]) Solver(0);
+		world->m_allocator.UsePool(m_pools + i * m_poolSize, m_poolSize);
+		//Nested parallel-fors aren't supported, the batch already runs each world on one thread
+		world->m_scheduler = nullptr;
+	}
+}
+
+template <typename T>
+BasicWorldBatch<T>::~BasicWorldBatch()
+{
+	for (size_t i = 0; i < m_worldCount; i++) m_worlds[i].~Solver();
+	PipFree(m_worlds);
+	PipFree(m_pools);
+}
+
+template <typename T>
+BasicSolver<T>& BasicWorldBatch<T>::GetWorld(size_t i)
+{
+	return m_worlds[i];
+}
+
+template <typename T>
+size_t BasicWorldBatch<T>::GetWorldCount()
+{
+	return m_worldCount;
+}
+
+template <typename T>
+void BasicWorldBatch<T>::Step()
+{
+	ParallelFor(&m_jobSystem, m_worldCount, PIP_WORLD_GRAIN, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++) m_worlds[i].Step(m_worlds[i].m_timestep);
+	});
+}
+
+template <typename T>
+void BasicWorldBatch<T>::Step(unsigned int steps)
+{
+	//Each range runs its worlds through every step, they stay in cache between steps
+	ParallelFor(&m_jobSystem, m_worldCount, PIP_WORLD_GRAIN, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++)
+		{
+			for (unsigned int step = 0; step < steps; step++) m_worlds[i].Step(m_worlds[i].m_timestep);
+		}
+	});
+}
+
+template class BasicWorldBatch<float>;
+template class BasicWorldBatch<fp64::Fp64>;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Solver.h"
+#include "JobSystem.h"
+
+//Many small independent worlds stepped together. Solvers are constructed side by side in one block and their body pools
+//are slices of one shared allocation, so a thread sweeping a run of worlds walks memory in order. Worlds are spread over
+//the batch's own job system, each world steps inline on whichever thread takes it
+template <typename T>
+class BasicWorldBatch
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	typedef BasicSolver<T> Solver;
+
+	//Every world gets poolSize bytes of bodies, a world's pool can't grow past that
+	BasicWorldBatch(size_t worldCount, size_t poolSize, unsigned int threadCount = 1);
+	~BasicWorldBatch();
+	Solver& GetWorld(size_t i);
+	size_t GetWorldCount();
+	void Step();//One fixed step of every world, each on its own m_timestep
+	void Step(unsigned int steps);
+public:
+	JobSystem m_jobSystem;//Spreads worlds over threads
+	Solver* m_worlds;
+	size_t m_worldCount;
+	char* m_pools;//m_worldCount slices of m_poolSize bytes
+	size_t m_poolSize;
+};
+typedef BasicWorldBatch<decimal> WorldBatch;
@@ -0,0 +1,463 @@
+#include "WorldFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Solver.h"
+#include "Circle.h"
+#include "Capsule.h"
+#include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
+
+using namespace std;
+using namespace PipMath;
+
+//Walks the preorder leaf flags the same way QuadNode::RestoreShape will. The file isn't trusted, so no recursion here:
+//pending[d] counts the nodes still to read on open level d
+static bool IsShapeValid(const char* shape, size_t shapeSize)
+{
+	unsigned int pending[PIP_WORLD_MAX_QUADTREE_DEPTH + 1];
+	int depth = 0;
+	size_t idx = 0;
+	pending[0] = 1;
+	while (depth >= 0)
+	{
+		if (pending[depth] == 0)
+		{
+			depth--;
+			continue;
+		}
+		if (idx >= shapeSize) return false;
+		pending[depth]--;
+		if (shape[idx++]) continue;
+		if (depth == PIP_WORLD_MAX_QUADTREE_DEPTH) return false;
+		pending[++depth] = 4;
+	}
+	return true;
+}
+
+template <typename T>
+BasicWorldFile<T>::BasicWorldFile()
+	: m_header(nullptr), m_bodies(nullptr), m_vertices(nullptr), m_children(nullptr), m_quadTreeShape(nullptr), m_size(0), m_mapping(nullptr)
+#ifdef _WIN32
+	, m_fileHandle(INVALID_HANDLE_VALUE), m_mappingHandle(nullptr)
+#endif
+{
+}
+
+template <typename T>
+BasicWorldFile<T>::~BasicWorldFile()
+{
+	Close();
+}
+
+template <typename T>
+int BasicWorldFile<T>::Open(const char* path)
+{
+	Close();
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		cout << "PiP Error: WorldFile::Open couldn't open " << path << endl;
+		return -1;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_fileHandle, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(WorldFileHeader))
+	{
+		cout << "PiP Error: WorldFile::Open file too small " << path << endl;
+		Close();
+		return -1;
+	}
+	m_size = (size_t)fileSize.QuadPart;
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mappingHandle) m_mapping = MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		cout << "PiP Error: WorldFile::Open couldn't open " << path << endl;
+		return -1;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) == -1 || fileStat.st_size < (off_t)sizeof(WorldFileHeader))
+	{
+		cout << "PiP Error: WorldFile::Open file too small " << path << endl;
+		close(fd);
+		return -1;
+	}
+	m_size = (size_t)fileStat.st_size;
+	m_mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m_mapping == MAP_FAILED) m_mapping = nullptr;
+	close(fd);//The mapping keeps the file alive
+#endif
+	if (!m_mapping)
+	{
+		cout << "PiP Error: WorldFile::Open couldn't map " << path << endl;
+		Close();
+		return -1;
+	}
+
+	const char* data = (const char*)m_mapping;
+	const WorldFileHeader* header = (const WorldFileHeader*)data;
+	if (header->magic != PIP_WORLD_MAGIC || header->version != PIP_WORLD_VERSION)
+	{
+		cout << "PiP Error: WorldFile::Open " << path << " isn't a version " << PIP_WORLD_VERSION << " world" << endl;
+		Close();
+		return -1;
+	}
+	if (header->decimalSize != sizeof(decimal) || header->bodyRecordSize != sizeof(WorldBodyRecord))
+	{
+		cout << "PiP Error: WorldFile::Open " << path << " was written for a different scalar type" << endl;
+		Close();
+		return -1;
+	}
+	if (header->bodiesOffset % alignof(WorldBodyRecord) != 0 || header->bodiesOffset > m_size
+	 || header->bodyCount > (m_size - header->bodiesOffset) / sizeof(WorldBodyRecord)
+	 || header->verticesOffset % alignof(decimal) != 0 || header->verticesOffset > m_size
+	 || header->vertexCount > (m_size - header->verticesOffset) / (2 * sizeof(decimal))
+	 || header->childrenOffset % alignof(WorldChildRecord) != 0 || header->childrenOffset > m_size
+	 || header->childCount > (m_size - header->childrenOffset) / sizeof(WorldChildRecord)
+	 || header->quadTreeShapeOffset > m_size || header->quadTreeShapeSize > m_size - header->quadTreeShapeOffset)
+	{
+		cout << "PiP Error: WorldFile::Open " << path << " is truncated" << endl;
+		Close();
+		return -1;
+	}
+	if (header->quadTreeShapeSize)
+	{
+		if (!IsShapeValid(data + header->quadTreeShapeOffset, (size_t)header->quadTreeShapeSize))
+		{
+			cout << "PiP Error: WorldFile::Open " << path << " has a malformed quadtree" << endl;
+			Close();
+			return -1;
+		}
+	}
+	m_header = header;
+	m_bodies = (const WorldBodyRecord*)(data + header->bodiesOffset);
+	m_vertices = (const decimal*)(data + header->verticesOffset);
+	m_children = (const WorldChildRecord*)(data + header->childrenOffset);
+	m_quadTreeShape = header->quadTreeShapeSize ? data + header->quadTreeShapeOffset : nullptr;
+	return 0;
+}
+
+template <typename T>
+void BasicWorldFile<T>::Close()
+{
+#ifdef _WIN32
+	if (m_mapping) UnmapViewOfFile(m_mapping);
+	if (m_mappingHandle) CloseHandle(m_mappingHandle);
+	if (m_fileHandle != INVALID_HANDLE_VALUE) CloseHandle(m_fileHandle);
+	m_mappingHandle = nullptr;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (m_mapping) munmap(m_mapping, m_size);
+#endif
+	m_mapping = nullptr;
+	m_header = nullptr;
+	m_bodies = nullptr;
+	m_vertices = nullptr;
+	m_children = nullptr;
+	m_quadTreeShape = nullptr;
+	m_size = 0;
+}
+
+template <typename T>
+int BasicWorldFile<T>::Load(Solver& solver)
+{
+	if (!m_header)
+	{
+		cout << "PiP Error: WorldFile::Load no world is open" << endl;
+		return -1;
+	}
+	size_t bodyCount = (size_t)m_header->bodyCount;
+	DefaultAllocator& allocator = solver.m_allocator;
+
+	//Every record is checked before anything is destroyed, a rejected file leaves the solver's world as it was
+	std::vector<size_t> lengths(bodyCount);
+	size_t totalLength = 0;
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		if (m_bodies[i].bodyType > (uint32_t)BodyType::Compound)
+		{
+			cout << "PiP Error: WorldFile::Load unknown body type " << m_bodies[i].bodyType << endl;
+			return -1;
+		}
+		if (m_bodies[i].bodyType == (uint32_t)BodyType::Polygon)
+		{
+			//Count against the section first, the section minus a bigger count would wrap
+			const WorldBodyRecord& record = m_bodies[i];
+			if (record.count < 3 || record.count > POLYGON_MAX_VERTICES || record.count > m_header->vertexCount
+			 || record.first > m_header->vertexCount - record.count)
+			{
+				cout << "PiP Error: WorldFile::Load polygon " << i << " has a bad vertex range" << endl;
+				return -1;
+			}
+			//Same check as CreatePolygon, the constructor divides by the area
+			Vector2 vertices[POLYGON_MAX_VERTICES];
+			ReadVertices(record, vertices);
+			if (!ConvexPolygon::IsValid(vertices, record.count))
+			{
+				cout << "PiP Error: WorldFile::Load polygon " << i << " isn't strictly convex" << endl;
+				return -1;
+			}
+		}
+		if (m_bodies[i].bodyType == (uint32_t)BodyType::Compound)
+		{
+			const WorldBodyRecord& record = m_bodies[i];
+			if (record.count < 1 || record.count > COMPOUND_MAX_CHILDREN || record.count > m_header->childCount
+			 || record.first > m_header->childCount - record.count)
+			{
+				cout << "PiP Error: WorldFile::Load compound " << i << " has a bad child range" << endl;
+				return -1;
+			}
+			//Same check as CreateCompound: known child types, each with some area
+			BodyDesc children[COMPOUND_MAX_CHILDREN];
+			ReadChildren(record, children);
+			if (!Compound::IsValid(children, record.count))
+			{
+				cout << "PiP Error: WorldFile::Load compound " << i << " has invalid children" << endl;
+				return -1;
+			}
+		}
+		lengths[i] = allocator.GetBodyByteSize((BodyType)m_bodies[i].bodyType);
+		totalLength += lengths[i];
+	}
+	//Growing keeps the current bodies, a pool that can't hold the file (a WorldBatch slice, a failed grow) is found out before they go
+	solver.ReservePool(totalLength);
+	if ((size_t)(allocator.m_pool.end - allocator.m_pool.start) < totalLength)
+	{
+		cout << "PiP Error: WorldFile::Load the pool can't hold " << totalLength << " bytes of bodies" << endl;
+		return -1;
+	}
+	allocator.DestroyAllBodies();
+	solver.m_stateHashStale = true;
+	std::vector<Handle> handles(bodyCount);
+	char* memory = bodyCount ? (char*)allocator.AllocateBodies(lengths.data(), bodyCount, handles.data()) : nullptr;
+	if (bodyCount && !memory) return -1;
+
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		const WorldBodyRecord& record = m_bodies[i];
+		Vector2 pos = Vector2(record.position[0], record.position[1]);
+		Vector2 vel = Vector2(record.velocity[0], record.velocity[1]);
+		bool isKinematic = (record.flags & PIP_BODY_KINEMATIC) != 0;
+		Rigidbody* rb = nullptr;
+		switch ((BodyType)record.bodyType)
+		{
+		case BodyType::Circle:
+		{
+			rb = new (memory) Circle(record.shape[0], pos, record.rotation, vel, record.angularVelocity, record.mass, record.e, isKinematic);
+			break;
+		}
+		case BodyType::Capsule:
+		{
+			rb = new (memory) Capsule(record.shape[0], record.shape[1], pos, record.rotation, vel, record.angularVelocity, record.mass,
+			 record.e, isKinematic);
+			break;
+		}
+		case BodyType::Obb:
+		{
+			rb = new (memory) OrientedBox(Vector2(record.shape[0], record.shape[1]), pos, record.rotation, vel, record.angularVelocity,
+			 record.mass, record.e, isKinematic);
+			break;
+		}
+		case BodyType::Polygon:
+		{
+			Vector2 vertices[POLYGON_MAX_VERTICES];
+			ReadVertices(record, vertices);
+			rb = new (memory) ConvexPolygon(vertices, record.count, pos, record.rotation, vel, record.angularVelocity, record.mass,
+			 record.e, isKinematic);
+			break;
+		}
+		case BodyType::Compound:
+		{
+			BodyDesc children[COMPOUND_MAX_CHILDREN];
+			ReadChildren(record, children);
+			rb = new (memory) Compound(children, record.count, pos, record.rotation, vel, record.angularVelocity, record.mass,
+			 record.e, isKinematic);
+			break;
+		}
+		}
+		rb->m_inertia = record.inertia;
+		rb->m_isSleeping = (record.flags & PIP_BODY_SLEEPING) != 0;
+		rb->m_timeInSleep = record.timeInSleep;
+		memory += lengths[i];
+	}
+
+	solver.m_timestep = m_header->timestep;
+	solver.m_gravity = m_header->gravity;
+	solver.m_airViscosity = m_header->airViscosity;
+	solver.m_accumulator = 0;
+	if (m_quadTreeShape) solver.m_quadTreeRoot.RestoreShape(m_quadTreeShape, (size_t)m_header->quadTreeShapeSize);
+	return 0;
+}
+
+template <typename T>
+void BasicWorldFile<T>::ReadVertices(const WorldBodyRecord& record, Vector2* vertices)
+{
+	const decimal* source = m_vertices + 2 * (size_t)record.first;
+	for (uint32_t j = 0; j < record.count; j++) vertices[j] = Vector2(source[2 * j], source[2 * j + 1]);
+}
+
+template <typename T>
+void BasicWorldFile<T>::ReadChildren(const WorldBodyRecord& record, BodyDesc* children)
+{
+	for (uint32_t j = 0; j < record.count; j++)
+	{
+		const WorldChildRecord& child = m_children[record.first + j];
+		children[j].bodyType = (BodyType)child.bodyType;
+		children[j].radius = child.bodyType == (uint32_t)BodyType::Capsule ? child.shape[1] : child.shape[0];
+		children[j].length = child.shape[0];
+		children[j].halfExtents = Vector2(child.shape[0], child.shape[1]);
+		children[j].position = Vector2(child.position[0], child.position[1]);
+		children[j].rotation = child.rotation;
+	}
+}
+
+template <typename T>
+int BasicWorldFile<T>::Write(const char* path, Solver& solver, bool writeQuadTree)
+{
+	std::vector<WorldBodyRecord> records;
+	std::vector<decimal> vertices;
+	std::vector<WorldChildRecord> children;
+	for (Rigidbody* rb = solver.m_allocator.GetFirstBody(); rb != nullptr; rb = solver.m_allocator.GetNextBody(rb))
+	{
+		WorldBodyRecord record;
+		memset(&record, 0, sizeof(record));//Deterministic padding bytes
+		record.bodyType = (uint32_t)rb->m_bodyType;
+		record.flags = (rb->m_isKinematic ? PIP_BODY_KINEMATIC : 0) | (rb->m_isSleeping ? PIP_BODY_SLEEPING : 0);
+		switch (rb->m_bodyType)
+		{
+		case BodyType::Circle:
+		{
+			record.shape[0] = static_cast<Circle*>(rb)->m_radius;
+			break;
+		}
+		case BodyType::Capsule:
+		{
+			Capsule* capsule = static_cast<Capsule*>(rb);
+			record.shape[0] = capsule->m_length;
+			record.shape[1] = capsule->m_radius;
+			break;
+		}
+		case BodyType::Obb:
+		{
+			OrientedBox* obb = static_cast<OrientedBox*>(rb);
+			record.shape[0] = obb->m_halfExtents.x;
+			record.shape[1] = obb->m_halfExtents.y;
+			break;
+		}
+		case BodyType::Polygon:
+		{
+			ConvexPolygon* polygon = static_cast<ConvexPolygon*>(rb);
+			record.first = (uint32_t)(vertices.size() / 2);
+			record.count = (uint32_t)polygon->m_vertexCount;
+			for (int j = 0; j < polygon->m_vertexCount; j++)
+			{
+				vertices.push_back(polygon->m_vertices[j].x);
+				vertices.push_back(polygon->m_vertices[j].y);
+			}
+			break;
+		}
+		case BodyType::Compound:
+		{
+			Compound* compound = static_cast<Compound*>(rb);
+			record.first = (uint32_t)children.size();
+			record.count = (uint32_t)compound->m_childCount;
+			for (int j = 0; j < compound->m_childCount; j++)
+			{
+				Rigidbody* proxy = compound->GetChild(j);
+				WorldChildRecord child;
+				memset(&child, 0, sizeof(child));
+				child.bodyType = (uint32_t)proxy->m_bodyType;
+				if (proxy->m_bodyType == BodyType::Circle) child.shape[0] = static_cast<Circle*>(proxy)->m_radius;
+				else if (proxy->m_bodyType == BodyType::Capsule)
+				{
+					child.shape[0] = static_cast<Capsule*>(proxy)->m_length;
+					child.shape[1] = static_cast<Capsule*>(proxy)->m_radius;
+				}
+				else
+				{
+					child.shape[0] = static_cast<OrientedBox*>(proxy)->m_halfExtents.x;
+					child.shape[1] = static_cast<OrientedBox*>(proxy)->m_halfExtents.y;
+				}
+				child.position[0] = compound->m_childOffsets[j].x;
+				child.position[1] = compound->m_childOffsets[j].y;
+				child.rotation = compound->m_childRotations[j];
+				children.push_back(child);
+			}
+			break;
+		}
+		}
+		record.position[0] = rb->m_position.x;
+		record.position[1] = rb->m_position.y;
+		record.rotation = rb->m_rotation;
+		record.velocity[0] = rb->m_velocity.x;
+		record.velocity[1] = rb->m_velocity.y;
+		record.angularVelocity = rb->m_angularVelocity;
+		record.mass = rb->m_mass;
+		record.e = rb->m_e;
+		record.inertia = rb->m_inertia;
+		record.timeInSleep = rb->m_timeInSleep;
+		records.push_back(record);
+	}
+	std::vector<char> shape;
+	if (writeQuadTree) solver.m_quadTreeRoot.SaveShape(shape);
+
+	WorldFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PIP_WORLD_MAGIC;
+	header.version = PIP_WORLD_VERSION;
+	header.decimalSize = sizeof(decimal);
+	header.bodyRecordSize = sizeof(WorldBodyRecord);
+	header.bodyCount = records.size();
+	header.bodiesOffset = sizeof(WorldFileHeader);
+	header.verticesOffset = header.bodiesOffset + records.size() * sizeof(WorldBodyRecord);
+	header.vertexCount = vertices.size() / 2;
+	header.childrenOffset = header.verticesOffset + vertices.size() * sizeof(decimal);
+	header.childrenOffset += (alignof(WorldChildRecord) - header.childrenOffset % alignof(WorldChildRecord)) % alignof(WorldChildRecord);
+	header.childCount = children.size();
+	header.quadTreeShapeOffset = header.childrenOffset + children.size() * sizeof(WorldChildRecord);
+	header.quadTreeShapeSize = shape.size();
+	header.timestep = solver.m_timestep;
+	header.gravity = solver.m_gravity;
+	header.airViscosity = solver.m_airViscosity;
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		cout << "PiP Error: WorldFile::Write couldn't open " << path << endl;
+		return -1;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (written && !records.empty()) written = fwrite(records.data(), sizeof(WorldBodyRecord), records.size(), file) == records.size();
+	if (written && !vertices.empty()) written = fwrite(vertices.data(), sizeof(decimal), vertices.size(), file) == vertices.size();
+	static const char zeros[alignof(WorldChildRecord)] = {};
+	size_t childrenPadding = (size_t)(header.childrenOffset - header.verticesOffset) - vertices.size() * sizeof(decimal);
+	if (written && childrenPadding) written = fwrite(zeros, 1, childrenPadding, file) == childrenPadding;
+	if (written && !children.empty()) written = fwrite(children.data(), sizeof(WorldChildRecord), children.size(), file) == children.size();
+	if (written && !shape.empty()) written = fwrite(shape.data(), 1, shape.size(), file) == shape.size();
+	if (fclose(file) != 0) written = false;
+	if (!written)
+	{
+		cout << "PiP Error: WorldFile::Write failed writing " << path << endl;
+		return -1;
+	}
+	return 0;
+}
+
+template class BasicWorldFile<float>;
+template class BasicWorldFile<fp64::Fp64>;
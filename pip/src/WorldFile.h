@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "PipMath.h"
+#include "Rigidbody.h"
+
+template <typename T> class BasicSolver;
+template <typename T> class BasicDefaultAllocator;
+template <typename T> struct BasicBodyDesc;
+
+#define PIP_WORLD_MAGIC 0x57504950 //"PIPW" read as little endian uint32
+#define PIP_WORLD_VERSION 3
+#define PIP_WORLD_MAX_QUADTREE_DEPTH 32//Levels below the root a file's quadtree may have, RestoreShape recurses once per level
+
+#define PIP_BODY_KINEMATIC 0x1
+#define PIP_BODY_SLEEPING 0x2
+
+//Layout: [WorldFileHeader][WorldBodyRecord * bodyCount][polygon vertices][WorldChildRecord * childCount][quadtree shape, optional]
+//Records are fixed size and stored in host layout, so a mapped file is read in place without parsing.
+//decimalSize tells float worlds from fixed point ones, they don't load into each other
+template <typename T>
+struct BasicWorldFileHeader
+{
+	typedef T decimal;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t decimalSize;
+	uint32_t bodyRecordSize;
+	uint64_t bodyCount;
+	uint64_t bodiesOffset;
+	uint64_t quadTreeShapeOffset;
+	uint64_t quadTreeShapeSize;//0 if the broadphase isn't prebuilt
+	uint64_t verticesOffset;//Local space polygon vertices as decimal x, y pairs
+	uint64_t vertexCount;
+	uint64_t childrenOffset;//Compound children
+	uint64_t childCount;
+	decimal timestep;
+	decimal gravity;
+	decimal airViscosity;
+};
+typedef BasicWorldFileHeader<decimal> WorldFileHeader;
+
+template <typename T>
+struct BasicWorldBodyRecord
+{
+	typedef T decimal;
+
+	uint32_t bodyType;
+	uint32_t flags;//PIP_BODY_*
+	uint32_t first;//Polygon: its slice of the vertex section. Compound: its slice of the child section
+	uint32_t count;
+	decimal shape[2];//Circle: radius. Capsule: length, radius. Obb: half extents
+	decimal position[2];
+	decimal rotation;
+	decimal velocity[2];
+	decimal angularVelocity;
+	decimal mass;
+	decimal e;
+	decimal inertia;//Stored as simulated, loading doesn't depend on each shape's inertia formula
+	decimal timeInSleep;
+};
+typedef BasicWorldBodyRecord<decimal> WorldBodyRecord;
+
+template <typename T>
+struct BasicWorldChildRecord
+{
+	typedef T decimal;
+
+	uint32_t bodyType;
+	uint32_t padding;
+	decimal shape[2];//Same as the body record
+	decimal position[2];//From the compound's centre of mass, body space
+	decimal rotation;
+};
+typedef BasicWorldChildRecord<decimal> WorldChildRecord;
+
+template <typename T>
+class BasicWorldFile
+{
+public:
+	PIP_SCALAR_TYPES(T)
+	typedef BasicSolver<T> Solver;
+	typedef BasicDefaultAllocator<T> DefaultAllocator;
+	typedef BasicBodyDesc<T> BodyDesc;
+	typedef BasicWorldFileHeader<T> WorldFileHeader;
+	typedef BasicWorldBodyRecord<T> WorldBodyRecord;
+	typedef BasicWorldChildRecord<T> WorldChildRecord;
+
+	BasicWorldFile();
+	~BasicWorldFile();
+	int Open(const char* path);//Maps the file read only and validates it, -1 on failure
+	void Close();
+	int Load(Solver& solver);//Replaces the solver's bodies, grows its pool if needed
+	static int Write(const char* path, Solver& solver, bool writeQuadTree = true);//Dumps a running solver
+public:
+	const WorldFileHeader* m_header;
+	const WorldBodyRecord* m_bodies;
+	const decimal* m_vertices;
+	const WorldChildRecord* m_children;
+	const char* m_quadTreeShape;
+	size_t m_size;
+private:
+	void ReadVertices(const WorldBodyRecord& record, Vector2* vertices);//A polygon record's slice of the vertex section
+	void ReadChildren(const WorldBodyRecord& record, BodyDesc* children);//A compound record's slice of the child section
+	void* m_mapping;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
+typedef BasicWorldFile<decimal> WorldFile;
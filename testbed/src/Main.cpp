@@ -1,10 +1,29 @@
 #define CATCH_CONFIG_RUNNER
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch.h"
 
+#include <map>
+#include <fstream>
+#include <float.h>
+#include <numeric>
+#include <new>
+#include <atomic>
+
 #include "TestApp.h"
 #include "Circle.h"
 #include "Capsule.h"
 #include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
+#include "WorldFile.h"
+#include "AsyncSolver.h"
+#include "WorldBatch.h"
+#include "DesyncLog.h"
+#include "AllocationHooks.h"
+#include "CollisionDispatch.h"
+#include "NarrowphaseBatch.h"
+#include "Chain.h"
+#include "Heightfield.h"
 
 //Enable/Disable unit tests
 #define RUN_TESTS 1
@@ -12,6 +31,102 @@
 using namespace PipMath;
 using namespace std;
 
+//Fills the solver's quadtree area with a grid of mixed small bodies, used by tests and benchmarks
+template <typename T>
+static void CreateBenchmarkWorld(BasicSolver<T>& solver, size_t bodyCount)
+{
+	typedef T decimal;
+	typedef BasicVector2<T> Vector2;
+	solver.m_allocator.DestroyAllBodies();
+	solver.m_allocator.ReservePool(bodyCount * sizeof(BasicOrientedBox<T>));
+	solver.m_stepMode = false;
+	size_t side = (size_t)ceil(sqrt((double)bodyCount));
+	decimal spacing = (decimal)18.f / (decimal)(float)side;
+	std::vector<BasicBodyDesc<T>> descs(bodyCount);
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		BasicBodyDesc<T>& desc = descs[i];
+		desc.bodyType = (i % 2) ? BodyType::Obb : BodyType::Circle;
+		desc.radius = spacing * (decimal)0.3f;
+		desc.length = spacing * (decimal)0.3f;
+		desc.halfExtents = Vector2(spacing * (decimal)0.35f, spacing * (decimal)0.25f);
+		desc.position = Vector2((decimal)(float)(i % side) * spacing - (decimal)9.f, (decimal)(float)(i / side) * spacing - (decimal)9.f);
+		desc.rotation = (decimal)(float)(i % 7) * (decimal)0.3f;
+		desc.velocity = Vector2((decimal)(float)((int)(i % 5) - 2), (decimal)(float)((int)(i % 3) - 1));
+		if (i < side)
+		{
+			//Bottom row of kinematic capsules holds the rest up
+			desc.bodyType = BodyType::Capsule;
+			desc.isKinematic = true;
+		}
+	}
+	std::vector<Handle> handles(bodyCount);
+	solver.CreateBodies(descs.data(), bodyCount, handles.data());
+}
+
+//Global operator new counts while s_countAllocations is set, for tests that check a step doesn't touch the heap
+static std::atomic<bool> s_countAllocations(false);
+static std::atomic<size_t> s_allocationCount(0);
+
+void* operator new(size_t size)
+{
+	if (s_countAllocations.load(std::memory_order_relaxed)) s_allocationCount++;
+	void* memory = malloc(size ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	if (s_countAllocations.load(std::memory_order_relaxed)) s_allocationCount++;
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept
+{
+	return operator new(size, nothrow);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+static float RandomRange(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
 //Unit Tests
 TEST_CASE("Base math queries") {
 	Vector2 segment1 = Vector2(-1, 0);
@@ -25,6 +140,115 @@ TEST_CASE("Base math queries") {
 #endif
 }
 
+TEST_CASE("Fixed point arithmetic") {
+	using fp64::Fp64;
+	//Raw values follow the Q32.32 reference implementation bit for bit
+	static_assert(Fp64(1.5f).InternalRepresentation() == 0x180000000, "Fp64 is constexpr");
+	REQUIRE((Fp64(3) * Fp64(0.5f)).InternalRepresentation() == 0x180000000);
+	REQUIRE(Fp64::WithInternalRepresentation(-3).InternalRepresentation() == -3);//Raw, FromInt64 is the integer conversion
+	REQUIRE(Fp64::FromInt64(-3).InternalRepresentation() == -0x300000000);
+	REQUIRE((Fp64::WithInternalRepresentation(-3) * Fp64(0.5f)).InternalRepresentation() == -1);//Truncates toward zero
+	REQUIRE((Fp64(-7) / Fp64(2)).InternalRepresentation() == -0x380000000);
+	REQUIRE((Fp64::WithInternalRepresentation(-1) / Fp64(3)).InternalRepresentation() == 0);
+	REQUIRE((Fp64(INT32_MAX) + Fp64(INT32_MAX)).InternalRepresentation() == (int64_t)0xFFFFFFFE00000000);//Wraps
+	REQUIRE(Fp64::FromFloat(NAN).InternalRepresentation() == 0);
+	REQUIRE(Fp64::FromDouble(1e30).InternalRepresentation() == INT64_MAX);
+	REQUIRE(Fp64::Sin(Fp64(0)).InternalRepresentation() == 0);
+	REQUIRE(Fp64::Pow(Fp64(2), 10) == Fp64(1024));
+	REQUIRE(Fp64::EasySqrt(Fp64(2)).EqualsEps(Fp64(1.41421356f), Fp64(0.0001f)));
+	REQUIRE((float)Fp64::Cos(Fp64(0)) == Approx(1.f).margin(0.001f));
+}
+
+//Max abs error against double libm over a sweep of raw Fp64 inputs, in Q32.32 ulps
+template<typename F, typename Ref>
+static double FixedPointMaxError(double from, double to, int samples, F f, Ref ref)
+{
+	double maxError = 0;
+	for (int i = 0; i <= samples; i++)
+	{
+		fp64::Fp64 x = fp64::Fp64::FromDouble(from + (to - from) * i / samples);
+		maxError = std::max(maxError, std::abs((double)f(x) - ref((double)x)));
+	}
+	return maxError * 4294967296.0;
+}
+
+TEST_CASE("Fast fixed point maths") {
+	using fp64::Fp64;
+	static_assert(Fp64::FastSqrt(Fp64(4)).InternalRepresentation() == 0x200000000, "FastSqrt is constexpr");
+	REQUIRE(Fp64::FastSqrt(Fp64(-1)).InternalRepresentation() == 0);
+	REQUIRE(Fp64::FastReciprocalSqrt(Fp64(0)).InternalRepresentation() == 0);
+	REQUIRE(Fp64::Atan2(Fp64(0), Fp64(0)).InternalRepresentation() == 0);
+	//Documented bounds in fp_math.h: sqrt < 1 ulp, sin/cos/atan2 <= 4 ulp
+	REQUIRE(FixedPointMaxError(0.001, 1000.0, 20000, [](Fp64 x) { return Fp64::FastSqrt(x); }, [](double x) { return std::sqrt(x); }) < 1.0);
+	REQUIRE(FixedPointMaxError(-100.0, 100.0, 20000, [](Fp64 x) { return Fp64::FastSin(x); }, [](double x) { return std::sin(x); }) <= 4.0);
+	REQUIRE(FixedPointMaxError(-100.0, 100.0, 20000, [](Fp64 x) { return Fp64::FastCos(x); }, [](double x) { return std::cos(x); }) <= 4.0);
+	REQUIRE(FixedPointMaxError(-PI, PI, 20000, [](Fp64 x) { return Fp64::Atan2(Fp64::FastSin(x), Fp64::FastCos(x) * Fp64(3)); },
+	 [](double x) { return std::atan2((double)Fp64::FastSin(Fp64::FromDouble(x)), (double)(Fp64::FastCos(Fp64::FromDouble(x)) * Fp64(3))); }) <= 4.0);
+	Fp64 s, c;
+	Fp64::FastSinCos(Fp64(1000), s, c);
+	REQUIRE((s == Fp64::FastSin(Fp64(1000)) && c == Fp64::FastCos(Fp64(1000))));
+}
+
+TEST_CASE("Fixed point maths benchmark", "[!benchmark]") {
+	using fp64::Fp64;
+	//Precision report, max abs error against double libm
+	auto sqrtRef = [](double x) { return std::sqrt(x); };
+	auto sinRef = [](double x) { return std::sin(x); };
+	auto cosRef = [](double x) { return std::cos(x); };
+	cout << "Fixed point precision (ulps of 2^-32):" << endl;
+	cout << "  EasySqrt [0, 1000]  " << FixedPointMaxError(0.0, 1000.0, 100000, [](Fp64 x) { return Fp64::EasySqrt(x); }, sqrtRef) << endl;
+	cout << "  FastSqrt [0, 1000]  " << FixedPointMaxError(0.0, 1000.0, 100000, [](Fp64 x) { return Fp64::FastSqrt(x); }, sqrtRef) << endl;
+	cout << "  Sin [-2PI, 2PI]     " << FixedPointMaxError(-2 * PI, 2 * PI, 100000, [](Fp64 x) { return Fp64::Sin(x); }, sinRef) << endl;
+	cout << "  FastSin [-2PI, 2PI] " << FixedPointMaxError(-2 * PI, 2 * PI, 100000, [](Fp64 x) { return Fp64::FastSin(x); }, sinRef) << endl;
+	cout << "  Cos [-2PI, 2PI]     " << FixedPointMaxError(-2 * PI, 2 * PI, 100000, [](Fp64 x) { return Fp64::Cos(x); }, cosRef) << endl;
+	cout << "  FastCos [-2PI, 2PI] " << FixedPointMaxError(-2 * PI, 2 * PI, 100000, [](Fp64 x) { return Fp64::FastCos(x); }, cosRef) << endl;
+	cout << "  Atan2 unit circle   " << FixedPointMaxError(-PI, PI, 100000, [](Fp64 x) { return Fp64::Atan2(Fp64::FastSin(x), Fp64::FastCos(x)); },
+	 [](double x) { return std::atan2((double)Fp64::FastSin(Fp64::FromDouble(x)), (double)Fp64::FastCos(Fp64::FromDouble(x))); }) << endl;
+
+	std::vector<Fp64> inputs(1024);
+	for (size_t i = 0; i < inputs.size(); i++) inputs[i] = Fp64::FromDouble(0.01 + 0.37 * (double)i);
+	BENCHMARK("EasySqrt x1024") {
+		Fp64 sum;
+		for (Fp64 x : inputs) sum += Fp64::EasySqrt(x);
+		return sum;
+	};
+	BENCHMARK("FastSqrt x1024") {
+		Fp64 sum;
+		for (Fp64 x : inputs) sum += Fp64::FastSqrt(x);
+		return sum;
+	};
+	BENCHMARK("1 / EasySqrt x1024") {
+		Fp64 sum;
+		for (Fp64 x : inputs) sum += Fp64(1) / Fp64::EasySqrt(x);
+		return sum;
+	};
+	BENCHMARK("FastReciprocalSqrt x1024") {
+		Fp64 sum;
+		for (Fp64 x : inputs) sum += Fp64::FastReciprocalSqrt(x);
+		return sum;
+	};
+	BENCHMARK("Sin + Cos x1024") {
+		Fp64 sum;
+		for (Fp64 x : inputs) sum += Fp64::Sin(x) + Fp64::Cos(x);
+		return sum;
+	};
+	BENCHMARK("FastSinCos x1024") {
+		Fp64 sum;
+		for (Fp64 x : inputs)
+		{
+			Fp64 s, c;
+			Fp64::FastSinCos(x, s, c);
+			sum += s + c;
+		}
+		return sum;
+	};
+	BENCHMARK("Atan2 x1024") {
+		Fp64 sum;
+		for (size_t i = 0; i < inputs.size(); i++) sum += Fp64::Atan2(inputs[i], inputs[inputs.size() - 1 - i]);
+		return sum;
+	};
+}
+
 TEST_CASE("Collision response behavior") {
 	//Mock objects
 	Solver mockSolver;
@@ -40,7 +264,7 @@ TEST_CASE("Collision response behavior") {
 	testManifold.rb1 = &circle1;
 	testManifold.rb2 = &circle2;
 
-	mockSolver.ComputeResponse(testManifold);
+	mockSolver.ComputeResponse(testManifold, mockSolver.m_timestep);
 
 	REQUIRE((circle1.m_velocity == Vector2(-1, 0) && circle2.m_velocity == Vector2(1, 0)));
 	
@@ -54,13 +278,100 @@ TEST_CASE("Collision response behavior") {
 	testManifold.rb1 = &obb1;
 	testManifold.rb2 = &obb2;
 
-	mockSolver.ComputeResponse(testManifold);
+	mockSolver.ComputeResponse(testManifold, mockSolver.m_timestep);
 
 	REQUIRE((obb1.m_velocity == Vector2(-5.f, 1.f) && obb2.m_velocity == Vector2(5.f, 1.f)));
 
 	//#Possibly test collision detection logging aswell?
 }
 
+TEST_CASE("Narrowphase edge cases")
+{
+	//Circle centre inside a box pushes out through the closest face
+	Circle circle = Circle(0.5f, Vector2(0.8f, 0.2f));
+	OrientedBox box = OrientedBox(Vector2(1.f, 1.f));
+	Manifold manifold;
+	REQUIRE(circle.IntersectWith(&box, manifold));
+	REQUIRE(manifold.numContactPoints == 1);
+	REQUIRE(manifold.normal.EqualsEps(Vector2(1, 0), FLT_EPSILON_TESTS));
+	REQUIRE(manifold.contactPoints[0].EqualsEps(Vector2(1.f, 0.2f), FLT_EPSILON_TESTS));
+	REQUIRE(Abs(manifold.penetration - (decimal)0.7f) < FLT_EPSILON_TESTS);
+
+	//A box only overlaps the quad nodes it reaches, wherever they sit
+	OrientedBox smallBox = OrientedBox(Vector2(0.5f, 0.5f));
+	REQUIRE(!smallBox.IntersectWith(Vector2(10, 10), Vector2(8, 8)));
+	REQUIRE(smallBox.IntersectWith(Vector2(1, 1), Vector2(0.25f, 0.25f)));
+
+	//A box fully inside another clips all four corners, the manifold keeps two
+	OrientedBox bigBox = OrientedBox(Vector2(2.f, 2.f));
+	OrientedBox innerBox = OrientedBox(Vector2(0.5f, 0.5f), Vector2(0.2f, 0), 0.1f);
+	Manifold insideManifold;
+	REQUIRE(bigBox.IntersectWith(&innerBox, insideManifold));
+	REQUIRE(insideManifold.numContactPoints >= 1);
+	REQUIRE(insideManifold.numContactPoints <= 2);
+
+	//Crossed boxes have no corner inside each other, the deepest incident corner is used
+	OrientedBox horizontal = OrientedBox(Vector2(2.f, 0.2f));
+	OrientedBox vertical = OrientedBox(Vector2(0.2f, 2.f), Vector2(0.1f, 0.1f));
+	Manifold crossManifold;
+	REQUIRE(horizontal.IntersectWith(&vertical, crossManifold));
+	REQUIRE(crossManifold.numContactPoints == 1);
+}
+
+TEST_CASE("Quad node merge waits for every child to be a leaf")
+{
+	//Only the first child is a leaf. Merging here would free the subdivided one, a leaf parent still queued for TryMerge
+	QuadNode root = QuadNode(Vector2(10, 10), Vector2(-10, -10));
+	root.Subdivide();
+	root.m_children[1].Subdivide();
+	root.TryMerge();
+	REQUIRE(!root.m_isLeaf);
+	REQUIRE(!root.m_children[1].m_isLeaf);
+	//Once that child merged back the root can merge too
+	root.m_children[1].TryMerge();
+	REQUIRE(root.m_children[1].m_isLeaf);
+	root.TryMerge();
+	REQUIRE(root.m_isLeaf);
+}
+
+TEST_CASE("Obb corners on non square boxes")
+{
+	//Corners come from both half extents, a flat box doesn't reach as far up as it does sideways
+	OrientedBox flat = OrientedBox(Vector2(2.f, 0.5f));
+	Vector2 corners[4];
+	flat.GetCorners(corners);
+	REQUIRE(corners[0].EqualsEps(Vector2(2.f, 0.5f), FLT_EPSILON_TESTS));
+	REQUIRE(corners[1].EqualsEps(Vector2(-2.f, 0.5f), FLT_EPSILON_TESTS));
+	REQUIRE(corners[2].EqualsEps(Vector2(-2.f, -0.5f), FLT_EPSILON_TESTS));
+	REQUIRE(corners[3].EqualsEps(Vector2(2.f, -0.5f), FLT_EPSILON_TESTS));
+	REQUIRE(!flat.IntersectWith(Vector2(0.4f, 1.8f), Vector2(-0.4f, 1.2f)));
+	OrientedBox above = OrientedBox(Vector2(0.2f, 0.2f), Vector2(0, 1.f));
+	Manifold boxManifold;
+	REQUIRE(!flat.IntersectWith(&above, boxManifold));
+
+	//A capsule end against the last edge, from the +x -y corner back to the first
+	Capsule capsule = Capsule(0.4f, 0.5f, Vector2(2.6f, 0));
+	Manifold capsuleManifold;
+	REQUIRE(capsule.IntersectWith(&flat, capsuleManifold));
+	REQUIRE(capsuleManifold.normal.EqualsEps(Vector2(1, 0), FLT_EPSILON_TESTS));
+	REQUIRE(Abs(capsuleManifold.penetration - (decimal)0.1f) < FLT_EPSILON_TESTS);
+}
+
+TEST_CASE("Small box resting on a long one")
+{
+	//The small box's face is the reference and no corner of the long box is inside it, its own bottom corners touch
+	OrientedBox floor = OrientedBox(Vector2(5.f, 0.5f));
+	OrientedBox box = OrientedBox(Vector2(0.5f, 0.5f), Vector2(1.f, 0.95f));
+	Manifold manifold;
+	REQUIRE(box.IntersectWith(&floor, manifold));
+	REQUIRE(manifold.numContactPoints == 2);
+	for (int i = 0; i < 2; i++)
+	{
+		REQUIRE(Abs(manifold.contactPoints[i].x - (decimal)1.f) <= (decimal)0.5f + FLT_EPSILON_TESTS);
+	}
+	REQUIRE(Abs(manifold.penetration - (decimal)0.05f) < FLT_EPSILON_TESTS);
+}
+
 TEST_CASE("Colliders vs QuadNode intersect tests")
 {
 	//#Test non intersection?
@@ -82,11 +393,11 @@ TEST_CASE("Colliders vs QuadNode intersect tests")
 	mockCapsule.m_position = Vector2();
 	mockCapsule.m_length = 12.1f;
 	REQUIRE(mockCapsule.IntersectWith(topRight, bottomLeft));
-	mockCapsule.m_rotation = 90 * DEG2RAD;
+	mockCapsule.SetRotation(90 * DEG2RAD);
 	REQUIRE(mockCapsule.IntersectWith(topRight, bottomLeft));
 
 	mockCapsule.m_length = 15;
-	mockCapsule.m_rotation = 45 * DEG2RAD;
+	mockCapsule.SetRotation(45 * DEG2RAD);
 	REQUIRE(mockCapsule.IntersectWith(topRight, bottomLeft));
 
 	//Obb test (SAT)
@@ -97,6 +408,1731 @@ TEST_CASE("Colliders vs QuadNode intersect tests")
 	REQUIRE(!mockObb.IntersectWith(topRight, bottomLeft));
 }
 
+TEST_CASE("Capsule vs QuadNode at any angle")
+{
+	//Reference distance from densely sampling the segment, the closed form test must agree outside the sampling error
+	Vector2 topRight = Vector2(1, 1);
+	Vector2 bottomLeft = Vector2(-1, -1);
+	srand(7);
+	for (int i = 0; i < 2000; i++)
+	{
+		Capsule capsule = Capsule(RandomRange(0.f, 3.f), RandomRange(0.05f, 0.5f), Vector2(RandomRange(-3.f, 3.f), RandomRange(-3.f, 3.f)));
+		//Every 4th one right at the vertical, where the old slope based test lost precision
+		capsule.SetRotation((i % 4 == 0) ? 90 * DEG2RAD + RandomRange(-1e-4f, 1e-4f) : RandomRange(-PI, PI));
+		Vector2 u = Vector2(1, 0).Rotate(capsule.m_rotationMatrix);
+		decimal minDist = FLT_MAX;
+		const int samples = 256;
+		for (int j = 0; j <= samples; j++)
+		{
+			Vector2 pt = capsule.m_position + u * (capsule.m_length * ((decimal)j / samples - 0.5f));
+			Vector2 out = pt - Vector2(Clamp(pt.x, bottomLeft.x, topRight.x), Clamp(pt.y, bottomLeft.y, topRight.y));
+			minDist = Min(minDist, out.Length());
+		}
+		decimal sampleError = capsule.m_length / samples + 1e-3f;
+		if (minDist <= capsule.m_radius - sampleError) REQUIRE(capsule.IntersectWith(topRight, bottomLeft));
+		if (minDist > capsule.m_radius + sampleError) REQUIRE(!capsule.IntersectWith(topRight, bottomLeft));
+	}
+}
+
+//The slope based capsule vs quad node test IntersectWith used before, kept as the benchmark baseline
+static bool SlopeCapsuleAabb(Capsule& capsule, Vector2 topRight, Vector2 bottomLeft)
+{
+	//#Early out tests
+	//Equation of a line
+	//Caps line	y = mx + c
+	//Slope from the cached rotation, vertical segments get FLT_MAX
+	decimal m = (capsule.m_rotationMatrix.c == 0) ? (decimal)FLT_MAX : capsule.m_rotationMatrix.s / capsule.m_rotationMatrix.c;
+	//Clamp line segment to aabb, compare sqdist to sqrRad
+	//Get Capsule's AB
+	decimal halfLength = capsule.m_length / 2;
+	Vector2 a = Vector2{ -halfLength, 0 };
+	Vector2 b = Vector2{ halfLength, 0 };
+	//Rotate about position
+	a.Rotate(capsule.m_rotationMatrix);
+	b.Rotate(capsule.m_rotationMatrix);
+	a += capsule.m_position;
+	b += capsule.m_position;
+	decimal c = a.y - m*a.x;
+
+	Vector2 boxPoints[4] =
+	{
+		topRight,
+		Vector2(topRight.x, bottomLeft.y), //bottomRight
+		bottomLeft,
+		Vector2(bottomLeft.x, topRight.y) //topLeft
+	};
+
+	//First, clamp both points in caps to aabb and check if theyre close enough
+	Vector2 aClamped = Vector2(Clamp(a.x, bottomLeft.x, topRight.x), Clamp(a.y, bottomLeft.y, topRight.y));
+	Vector2 bClamped = Vector2(Clamp(b.x, bottomLeft.x, topRight.x), Clamp(b.y, bottomLeft.y, topRight.y));
+	if ((aClamped - a).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+	if ((bClamped - b).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+	//Then if none are close enough check if capsule line collides with aabb axis, and then check distance against points clamped in segment and in aabb
+	//First check line is not parallel to y or x axis
+	decimal segmentXMin, segmentXMax, segmentYMin, segmentYMax;
+	if (a.x <= b.x)
+	{
+		segmentXMin = a.x;
+		segmentXMax = b.x;
+	}
+	else
+	{
+		segmentXMin = b.x;
+		segmentXMax = a.x;
+	}
+	if (a.y <= b.y)
+	{
+		segmentYMin = a.y;
+		segmentYMax = b.y;
+	}
+	else
+	{
+		segmentYMin = b.y;
+		segmentYMax = a.y;
+	}
+
+	if (m == 0) {
+		//Completely horizontal line segment
+		//Find points when it collides with the x min and max of the aabb
+		//Clamp those to the line segment, and to the aabb, and compare
+
+		decimal y = a.y;
+		decimal x = bottomLeft.x;
+		decimal x2 = topRight.x;
+		decimal boxClampY = Clamp(y, bottomLeft.y, topRight.y);
+		Vector2 boxClamp1 = Vector2(bottomLeft.x, boxClampY);
+		Vector2 boxClamp2 = Vector2(topRight.x, boxClampY);
+
+		Vector2 segmentClamp1 = Vector2(Clamp(x, segmentXMin, segmentXMax), y);
+		Vector2 segmentClamp2 = Vector2(Clamp(x2, segmentXMin, segmentXMax), y);
+		
+		//Check distances of segment clamps against box clamps
+		if ((segmentClamp1 - boxClamp1).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+		if ((segmentClamp1 - boxClamp2).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+		if ((segmentClamp2 - boxClamp1).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+		if ((segmentClamp2 - boxClamp2).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+	}
+	else if (m == FLT_MAX) 
+	{
+		//Completely vertical line segment
+		//Find points when it collides with the y min and max of the aabb
+		//Clamp those to the line segment, and to the aabb, and compare
+
+		decimal x = a.x;
+		decimal y = bottomLeft.y;
+		decimal y2 = topRight.y;
+		decimal boxClampX = Clamp(x, bottomLeft.x, topRight.x);
+		Vector2 boxClamp1 = Vector2(boxClampX, bottomLeft.y);
+		Vector2 boxClamp2 = Vector2(boxClampX, topRight.y);
+
+		Vector2 segmentClamp1 = Vector2(x, Clamp(y, segmentYMin, segmentYMax));
+		Vector2 segmentClamp2 = Vector2(x, Clamp(y2, segmentYMin, segmentYMax));
+
+		//Check distances of segment clamps against box clamps
+		if ((segmentClamp1 - boxClamp1).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+		if ((segmentClamp1 - boxClamp2).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+		if ((segmentClamp2 - boxClamp1).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+		if ((segmentClamp2 - boxClamp2).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+	}
+	else
+	{
+		//Use equation of line to solve for x == xmin || xmax and || y == ymin || ymax
+		//We know it collides with all aabb axis as its not parallel to none
+		//Line with box x axis 1
+		Vector2 lineX1 = Vector2(bottomLeft.x, m * bottomLeft.x + c);
+		Vector2 lineX2 = Vector2(topRight.x, m * topRight.x + c);
+
+		Vector2 lineY1 = Vector2((bottomLeft.y - c) / m, bottomLeft.y);
+		Vector2 lineY2 = Vector2((topRight.y - c) / m, topRight.y);
+
+		Vector2 boxClamp1 = Vector2(bottomLeft.x, Clamp(lineX1.y, bottomLeft.y, topRight.y));
+		Vector2 segmentClamp1 = Vector2(Clamp(lineX1.x, segmentXMin, segmentXMax), Clamp(lineX1.y, segmentYMin, segmentYMax));
+		if ((boxClamp1 - segmentClamp1).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+
+		Vector2 boxClamp2 = Vector2(topRight.x, Clamp(lineX2.y, bottomLeft.x, topRight.y));
+		Vector2 segmentClamp2 = Vector2(Clamp(lineX2.x, segmentXMin, segmentXMax), Clamp(lineX2.y, segmentYMin, segmentYMax));
+		if ((boxClamp2 - segmentClamp2).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+
+		Vector2 boxClamp3 = Vector2(Clamp(lineY1.x, bottomLeft.x, topRight.x), bottomLeft.y);
+		Vector2 segmentClamp3 = Vector2(Clamp(lineY1.x, segmentXMin, segmentXMax), Clamp(lineY1.y, segmentYMin, segmentYMax));
+		if ((boxClamp3 - segmentClamp3).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+
+		Vector2 boxClamp4 = Vector2(Clamp(lineY2.x, bottomLeft.x, topRight.x), topRight.y);
+		Vector2 segmentClamp4 = Vector2(Clamp(lineY2.x, segmentXMin, segmentXMax), Clamp(lineY2.y, segmentYMin, segmentYMax));
+		if ((boxClamp4 - segmentClamp4).LengthSqr() <= capsule.m_radius * capsule.m_radius) return true;
+	}
+	return false;
+}
+
+
+TEST_CASE("Capsule vs QuadNode benchmark", "[!benchmark]")
+{
+	srand(11);
+	std::vector<Capsule> capsules;
+	for (int i = 0; i < 1024; i++)
+	{
+		capsules.push_back(Capsule(RandomRange(0.2f, 2.f), RandomRange(0.05f, 0.5f), Vector2(RandomRange(-3.f, 3.f), RandomRange(-3.f, 3.f)),
+			RandomRange(-PI, PI)));
+	}
+	Vector2 topRight = Vector2(1, 1);
+	Vector2 bottomLeft = Vector2(-1, -1);
+
+	BENCHMARK("Slope based x1024") {
+		int hits = 0;
+		for (Capsule& capsule : capsules) hits += SlopeCapsuleAabb(capsule, topRight, bottomLeft);
+		return hits;
+	};
+	BENCHMARK("Closed form x1024") {
+		int hits = 0;
+		for (Capsule& capsule : capsules) hits += capsule.IntersectWith(topRight, bottomLeft);
+		return hits;
+	};
+}
+
+TEST_CASE("Pair dispatch table matches the visitor")
+{
+	//Overlapping body of each type, every ordered pair must produce the same manifold either way
+	Circle circle = Circle(1.f, Vector2(0.5f, 0.2f));
+	Capsule capsule = Capsule(2.f, 0.5f, Vector2(-0.4f, 0.f), 0.3f);
+	OrientedBox obb = OrientedBox(Vector2(1.f, 0.5f), Vector2(0.f, -0.3f), 0.6f);
+	Circle circle2 = Circle(1.f, Vector2(-0.5f, 0.f));
+	Capsule capsule2 = Capsule(2.f, 0.5f, Vector2(0.3f, 0.5f), 1.2f);
+	OrientedBox obb2 = OrientedBox(Vector2(0.5f, 0.5f), Vector2(0.8f, 0.1f), 0.2f);
+	Vector2 pentagon[5] = { Vector2(1.f, 0.f), Vector2(0.3f, 0.95f), Vector2(-0.8f, 0.6f), Vector2(-0.8f, -0.6f), Vector2(0.3f, -0.95f) };
+	ConvexPolygon polygon = ConvexPolygon(pentagon, 5, Vector2(0.2f, 0.1f), 0.4f);
+	ConvexPolygon polygon2 = ConvexPolygon(pentagon, 5, Vector2(-0.3f, 0.4f), 1.1f);
+	BodyDesc children[2] = { BodyDesc(BodyType::Obb), BodyDesc(BodyType::Circle) };
+	children[0].halfExtents = Vector2(0.8f, 0.3f);
+	children[1].radius = 0.5f;
+	children[1].position = Vector2(0.6f, 0.4f);
+	Compound compound = Compound(children, 2, Vector2(0.1f, -0.1f), 0.5f);
+	Compound compound2 = Compound(children, 2, Vector2(-0.2f, 0.2f), 2.f);
+	Rigidbody* bodies[2][BODY_TYPE_COUNT] = { { &circle, &capsule, &obb, &polygon, &compound },
+	 { &circle2, &capsule2, &obb2, &polygon2, &compound2 } };
+	for (int i = 0; i < BODY_TYPE_COUNT; i++)
+	{
+		for (int j = 0; j < BODY_TYPE_COUNT; j++)
+		{
+			Rigidbody* rb1 = bodies[0][i];
+			Rigidbody* rb2 = bodies[1][j];
+			Manifold visitorManifold, tableManifold;
+			bool visitorHit = rb1->IntersectWith(rb2, visitorManifold);
+			REQUIRE(IntersectPair(rb1, rb2, tableManifold) == visitorHit);
+			REQUIRE(visitorHit);
+			REQUIRE((tableManifold.rb1 == visitorManifold.rb1 && tableManifold.rb2 == visitorManifold.rb2));
+			REQUIRE(tableManifold.normal == visitorManifold.normal);
+			REQUIRE(tableManifold.penetration == visitorManifold.penetration);
+			REQUIRE(tableManifold.numContactPoints == visitorManifold.numContactPoints);
+		}
+	}
+}
+
+TEST_CASE("Convex polygon bodies")
+{
+	//Only convex polygons of 3 to POLYGON_MAX_VERTICES get created, either winding
+	Vector2 square[4] = { Vector2(0, 0), Vector2(2.f, 0), Vector2(2.f, 2.f), Vector2(0, 2.f) };
+	Vector2 clockwiseSquare[4] = { square[3], square[2], square[1], square[0] };
+	Vector2 concave[5] = { Vector2(0, 0), Vector2(2.f, 0), Vector2(1.f, 0.5f), Vector2(2.f, 2.f), Vector2(0, 2.f) };
+	Vector2 star[5];
+	for (int i = 0; i < 5; i++) star[i] = Vector2(Cos(i * 144 * DEG2RAD), Sin(i * 144 * DEG2RAD));
+	Vector2 octagon[POLYGON_MAX_VERTICES + 1];
+	for (int i = 0; i <= POLYGON_MAX_VERTICES; i++) octagon[i] = Vector2(Cos(i * 2 * PI / POLYGON_MAX_VERTICES), Sin(i * 2 * PI / POLYGON_MAX_VERTICES));
+	REQUIRE(ConvexPolygon::IsValid(square, 4));
+	REQUIRE(ConvexPolygon::IsValid(clockwiseSquare, 4));
+	REQUIRE(ConvexPolygon::IsValid(octagon, POLYGON_MAX_VERTICES));
+	REQUIRE(!ConvexPolygon::IsValid(square, 2));
+	REQUIRE(!ConvexPolygon::IsValid(concave, 5));
+	REQUIRE(!ConvexPolygon::IsValid(star, 5));
+	REQUIRE(!ConvexPolygon::IsValid(octagon, POLYGON_MAX_VERTICES + 1));
+	Solver solver;
+	Handle handle;
+	REQUIRE(solver.CreatePolygon(handle, concave, 5) == -1);
+
+	//Recentred on the centroid, a square has the same mass properties as the box
+	ConvexPolygon polygon = ConvexPolygon(clockwiseSquare, 4, Vector2(1.f, 1.f));
+	OrientedBox box = OrientedBox(Vector2(1.f, 1.f), Vector2(1.f, 1.f));
+	REQUIRE(Abs(polygon.m_inertia - box.m_inertia) < 1e-5f);
+	REQUIRE(polygon.m_vertices[0].EqualsEps(Vector2(-1.f, -1.f), 1e-5f));
+	REQUIRE(polygon.m_normals[0].EqualsEps(Vector2(0, -1.f), 1e-5f));
+
+	//Hill climbing from any start finds the brute force support
+	srand(11);
+	for (int i = 0; i < 200; i++)
+	{
+		Vector2 dir = Vector2(RandomRange(-1.f, 1.f), RandomRange(-1.f, 1.f));
+		int bruteForce = 0;
+		for (int j = 1; j < POLYGON_MAX_VERTICES; j++) if (dir.Dot(octagon[j]) > dir.Dot(octagon[bruteForce])) bruteForce = j;
+		int support = ConvexPolygon::FindSupport(octagon, POLYGON_MAX_VERTICES, dir, i % POLYGON_MAX_VERTICES);
+		REQUIRE(Abs(dir.Dot(octagon[support]) - dir.Dot(octagon[bruteForce])) < 1e-6f);
+	}
+
+	//A square polygon collides like the box it's shaped as, against each kind of body
+	for (int i = 0; i < 500; i++)
+	{
+		decimal rotation = RandomRange(-PI, PI);
+		polygon = ConvexPolygon(square, 4, Vector2(0, 0), rotation);
+		box = OrientedBox(Vector2(1.f, 1.f), Vector2(0, 0), rotation);
+		Vector2 pos = Vector2(RandomRange(-3.f, 3.f), RandomRange(-3.f, 3.f));
+		decimal rotation2 = RandomRange(-PI, PI);
+		Circle circle = Circle(0.5f, pos);
+		OrientedBox box2 = OrientedBox(Vector2(0.7f, 0.3f), pos, rotation2);
+		Vector2 diamondVertices[4] = { octagon[0], octagon[2], octagon[4], octagon[6] };
+		ConvexPolygon polygon2 = ConvexPolygon(diamondVertices, 4, pos, rotation2);
+		OrientedBox diamond = OrientedBox(Vector2(0.5f * Sqrt(2.f), 0.5f * Sqrt(2.f)), pos, rotation2 + PI / 4);
+		Rigidbody* pairs[3][2] = { { &circle, &circle }, { &box2, &box2 }, { &polygon2, &diamond } };
+		for (int j = 0; j < 3; j++)
+		{
+			Manifold polygonManifold, boxManifold;
+			bool polygonHit = IntersectPair((Rigidbody*)&polygon, pairs[j][0], polygonManifold);
+			bool boxHit = IntersectPair((Rigidbody*)&box, pairs[j][1], boxManifold);
+			if (Abs(polygonManifold.penetration) < 1e-3f || Abs(boxManifold.penetration) < 1e-3f) continue;//Grazing, either answer is fine
+			REQUIRE(polygonHit == boxHit);
+			if (!polygonHit) continue;
+			//Reference faces are biased towards the polygon, near ties may pick a slightly deeper axis
+			REQUIRE(Abs(polygonManifold.penetration - boxManifold.penetration) < boxManifold.penetration * 0.02f + 1e-3f);
+			//Normal points to the polygon
+			decimal polygonSide = polygonManifold.normal.Dot(polygon.m_position - pairs[j][0]->m_position);
+			REQUIRE(((polygonManifold.rb1 == &polygon) ? polygonSide : -polygonSide) >= -1e-4f);
+		}
+	}
+
+	//Capsule hits wherever the segment gets within its radius of the polygon
+	Vector2 pentagon[5] = { Vector2(1.f, 0.f), Vector2(0.3f, 0.95f), Vector2(-0.8f, 0.6f), Vector2(-0.8f, -0.6f), Vector2(0.3f, -0.95f) };
+	polygon = ConvexPolygon(pentagon, 5, Vector2(0, 0), 0.3f);
+	Vector2 vertices[5], normals[5];
+	polygon.GetWorldVertices(vertices, normals);
+	for (int i = 0; i < 500; i++)
+	{
+		Capsule capsule = Capsule(RandomRange(0.f, 2.f), 0.3f, Vector2(RandomRange(-2.5f, 2.5f), RandomRange(-2.5f, 2.5f)), RandomRange(-PI, PI));
+		Vector2 a = capsule.m_position - Vector2(capsule.m_length / 2, 0).Rotate(capsule.m_rotationMatrix);
+		Vector2 b = capsule.m_position + Vector2(capsule.m_length / 2, 0).Rotate(capsule.m_rotationMatrix);
+		//Reference distance by sampling the segment, 0 inside the polygon
+		decimal minDist = 100.f;
+		for (int j = 0; j <= 200; j++)
+		{
+			Vector2 p = a + (b - a) * (j / 200.f);
+			decimal outside = -1.f;
+			for (int k = 0; k < 5; k++) outside = Max(outside, normals[k].Dot(p - vertices[k]));
+			decimal dist = 0;
+			if (outside > 0)
+			{
+				dist = 100.f;
+				for (int k = 0; k < 5; k++) dist = Min(dist, (p - ClosestPtToSegment(vertices[k], vertices[(k + 1) % 5], p)).Length());
+			}
+			minDist = Min(minDist, dist);
+		}
+		if (Abs(minDist - capsule.m_radius) < 0.02f) continue;
+		Manifold manifold;
+		REQUIRE(IntersectPair((Rigidbody*)&capsule, (Rigidbody*)&polygon, manifold) == (minDist < capsule.m_radius));
+		if (minDist > 0 && minDist < capsule.m_radius) REQUIRE(Abs(manifold.penetration - (capsule.m_radius - minDist)) < 0.02f);
+	}
+
+	//A hexagon dropped on a box comes to rest on it
+	solver.m_allocator.DestroyAllBodies();
+	Vector2 hexagon[6];
+	for (int i = 0; i < 6; i++) hexagon[i] = Vector2(Cos(i * 60 * DEG2RAD), Sin(i * 60 * DEG2RAD)) * 0.5f;
+	Handle hexagonHandle;
+	REQUIRE(solver.CreatePolygon(hexagonHandle, hexagon, 6, Vector2(0.3f, 2.f), 0.2f, Vector2(), 0.f, 1.f, 0.2f) == 0);
+	solver.CreateOrientedBox(handle, Vector2(5.f, 0.5f), Vector2(0, -3.f), 0.f, Vector2(), 0.f, 1.f, 0.2f, true);
+	solver.m_stepMode = false;
+	for (int i = 0; i < 300; i++) solver.Step(solver.m_timestep);
+	Rigidbody* hexagonBody = solver.m_allocator.GetBody(hexagonHandle);
+	REQUIRE(hexagonBody->m_position.y > -2.6f);
+	REQUIRE(hexagonBody->m_position.y < -2.0f);
+	REQUIRE(hexagonBody->m_velocity.Length() < 0.1f);
+}
+
+TEST_CASE("Compound bodies")
+{
+	//1 to COMPOUND_MAX_CHILDREN children, no polygons or nested compounds
+	BodyDesc children[COMPOUND_MAX_CHILDREN + 1];
+	children[0] = BodyDesc(BodyType::Obb);
+	children[0].halfExtents = Vector2(1.f, 0.25f);
+	children[1] = BodyDesc(BodyType::Circle);
+	children[1].radius = 0.5f;
+	children[1].position = Vector2(1.5f, 0);
+	children[2] = BodyDesc(BodyType::Capsule);
+	children[2].length = 1.f;
+	children[2].radius = 0.25f;
+	children[2].position = Vector2(-1.f, 0.5f);
+	children[2].rotation = PI / 2;
+	REQUIRE(Compound::IsValid(children, 3));
+	REQUIRE(!Compound::IsValid(children, 0));
+	REQUIRE(!Compound::IsValid(children, COMPOUND_MAX_CHILDREN + 1));
+	BodyDesc polygonChild = BodyDesc(BodyType::Polygon);
+	REQUIRE(!Compound::IsValid(&polygonChild, 1));
+	Solver solver;
+	Handle handle;
+	REQUIRE(solver.CreateCompound(handle, &polygonChild, 1) == -1);
+	//Children without area would divide the centroid by zero
+	BodyDesc flatChildren[2] = { BodyDesc(BodyType::Circle), BodyDesc(BodyType::Obb) };
+	flatChildren[0].radius = 0;
+	flatChildren[1].halfExtents = Vector2(1.f, 0);
+	REQUIRE(!Compound::IsValid(flatChildren, 2));
+	REQUIRE(solver.CreateCompound(handle, flatChildren, 2) == -1);
+
+	//Two equal boxes side by side weigh and spin like one box twice as long
+	BodyDesc halves[2] = { BodyDesc(BodyType::Obb), BodyDesc(BodyType::Obb) };
+	halves[0].halfExtents = halves[1].halfExtents = Vector2(0.5f, 0.5f);
+	halves[0].position = Vector2(1.f, 1.f);
+	halves[1].position = Vector2(2.f, 1.f);
+	Compound compound = Compound(halves, 2, Vector2(0, 0), 0.f, Vector2(), 0.f, 2.f);
+	OrientedBox box = OrientedBox(Vector2(1.f, 0.5f), Vector2(0, 0), 0.f, Vector2(), 0.f, 2.f);
+	REQUIRE(compound.m_childOffsets[0].EqualsEps(Vector2(-0.5f, 0), 1e-5f));
+	REQUIRE(Abs(compound.m_inertia - box.m_inertia) < 1e-4f);
+
+	//Against any body, a child's manifold is reported for the compound as rb1 with the normal still pointing to it
+	srand(13);
+	compound = Compound(children, 3, Vector2(0, 0), 0.f);
+	for (int i = 0; i < 500; i++)
+	{
+		compound.m_position = Vector2(RandomRange(-0.5f, 0.5f), RandomRange(-0.5f, 0.5f));
+		compound.m_rotation = RandomRange(-PI, PI);
+		compound.m_rotationMatrix = Mat2(compound.m_rotation);
+		Vector2 pos = Vector2(RandomRange(-3.f, 3.f), RandomRange(-3.f, 3.f));
+		Circle circle = Circle(0.4f, pos);
+		OrientedBox obb = OrientedBox(Vector2(0.5f, 0.2f), pos, RandomRange(-PI, PI));
+		Rigidbody* others[2] = { &circle, &obb };
+		for (int j = 0; j < 2; j++)
+		{
+			//Reference: the deepest of each child tested on its own
+			compound.UpdateChildren();
+			bool childHit = false;
+			decimal deepest = 0;
+			for (int k = 0; k < compound.m_childCount; k++)
+			{
+				Manifold childManifold;
+				if (!IntersectPair(compound.GetChild(k), others[j], childManifold)) continue;
+				deepest = childHit ? Max(deepest, childManifold.penetration) : childManifold.penetration;
+				childHit = true;
+			}
+			Manifold manifold;
+			REQUIRE(IntersectPair((Rigidbody*)&compound, others[j], manifold) == childHit);
+			REQUIRE(IntersectPair(others[j], (Rigidbody*)&compound, manifold) == childHit);
+			if (!childHit) continue;
+			REQUIRE(Abs(manifold.penetration - deepest) < 1e-5f);
+			REQUIRE((manifold.rb1 == &compound && manifold.rb2 == others[j]));
+			REQUIRE(manifold.numContactPoints >= 1);
+		}
+	}
+
+	//An L shaped compound dropped on a box comes to rest on its long side
+	solver.m_allocator.DestroyAllBodies();
+	BodyDesc lShape[2] = { BodyDesc(BodyType::Obb), BodyDesc(BodyType::Obb) };
+	lShape[0].halfExtents = Vector2(1.f, 0.2f);
+	lShape[1].halfExtents = Vector2(0.2f, 0.5f);
+	lShape[1].position = Vector2(-0.8f, 0.7f);
+	Handle compoundHandle;
+	REQUIRE(solver.CreateCompound(compoundHandle, lShape, 2, Vector2(0.3f, 2.f), 0.f, Vector2(), 0.f, 1.f, 0.2f) == 0);
+	solver.CreateOrientedBox(handle, Vector2(5.f, 0.5f), Vector2(0, -3.f), 0.f, Vector2(), 0.f, 1.f, 0.2f, true);
+	solver.m_stepMode = false;
+	for (int i = 0; i < 300; i++) solver.Step(solver.m_timestep);
+	Compound* compoundBody = (Compound*)solver.m_allocator.GetBody(compoundHandle);
+	compoundBody->UpdateChildren();
+	REQUIRE(compoundBody->GetChild(0)->m_position.y > -2.5f);
+	REQUIRE(compoundBody->GetChild(0)->m_position.y < -2.1f);
+	REQUIRE(compoundBody->m_velocity.Length() < 0.1f);
+}
+
+TEST_CASE("Pair dispatch benchmark", "[!benchmark]")
+{
+	Solver solver;
+	CreateBenchmarkWorld(solver, 2000);
+	std::vector<Rigidbody*> bodies;
+	for (Rigidbody* rb = solver.m_allocator.GetFirstBody(); rb != nullptr; rb = solver.m_allocator.GetNextBody(rb)) bodies.push_back(rb);
+	//Neighbours in the grid, mixed types like a real leaf node
+	std::vector<std::pair<Rigidbody*, Rigidbody*>> pairs;
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		for (size_t j = i + 1; j < bodies.size() && j < i + 8; j++) pairs.push_back(std::make_pair(bodies[i], bodies[j]));
+	}
+
+	BENCHMARK("Virtual double dispatch") {
+		int hits = 0;
+		for (auto& pair : pairs)
+		{
+			Manifold manifold;
+			hits += pair.first->IntersectWith(pair.second, manifold);
+		}
+		return hits;
+	};
+	BENCHMARK("BodyType table dispatch") {
+		int hits = 0;
+		for (auto& pair : pairs)
+		{
+			Manifold manifold;
+			hits += IntersectPair(pair.first, pair.second, manifold);
+		}
+		return hits;
+	};
+}
+
+TEST_CASE("Batched narrowphase matches pair by pair")
+{
+	//Dense random circles and boxes so both kernel branches (centre inside / outside the box) get hit
+	std::vector<Circle> circles;
+	std::vector<OrientedBox> boxes;
+	srand(7);
+	for (int i = 0; i < 64; i++)
+	{
+		circles.push_back(Circle(RandomRange(0.1f, 0.6f), Vector2(RandomRange(-2.f, 2.f), RandomRange(-2.f, 2.f))));
+		boxes.push_back(OrientedBox(Vector2(RandomRange(0.1f, 0.8f), RandomRange(0.1f, 0.8f)), Vector2(RandomRange(-2.f, 2.f), RandomRange(-2.f, 2.f)),
+		 RandomRange(-PI, PI)));
+	}
+	std::vector<Rigidbody*> bodies;
+	for (int i = 0; i < 64; i++)
+	{
+		bodies.push_back(&circles[i]);
+		bodies.push_back(&boxes[i]);
+	}
+	NarrowphaseBatch batch;
+	std::vector<Manifold> expected;
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		for (size_t j = i + 1; j < bodies.size(); j++)
+		{
+			batch.AddPair(bodies[i], bodies[j]);
+			Manifold manifold;
+			if (IntersectPair(bodies[i], bodies[j], manifold)) expected.push_back(manifold);
+		}
+	}
+	std::vector<Manifold> batched;
+	REQUIRE(batch.Run(batched) == expected.size());
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		REQUIRE((batched[i].rb1 == expected[i].rb1 && batched[i].rb2 == expected[i].rb2));
+		REQUIRE(batched[i].normal == expected[i].normal);
+		REQUIRE(batched[i].penetration == expected[i].penetration);
+		REQUIRE(batched[i].numContactPoints == expected[i].numContactPoints);
+		REQUIRE(batched[i].contactPoints[0] == expected[i].contactPoints[0]);
+		REQUIRE(batched[i].contactPoints[1] == expected[i].contactPoints[1]);
+	}
+}
+
+TEST_CASE("Batched narrowphase benchmark", "[!benchmark]")
+{
+	Solver solver;
+	CreateBenchmarkWorld(solver, 4000);
+	std::vector<Rigidbody*> bodies;
+	for (Rigidbody* rb = solver.m_allocator.GetFirstBody(); rb != nullptr; rb = solver.m_allocator.GetNextBody(rb)) bodies.push_back(rb);
+	NarrowphaseBatch batch;
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		for (size_t j = i + 1; j < bodies.size() && j < i + 8; j++) batch.AddPair(bodies[i], bodies[j]);
+	}
+	size_t pairCount = batch.m_pairs.size() / 2;
+	std::vector<Manifold> manifolds;
+	manifolds.reserve(pairCount);
+
+	//Throughput in pairs/sec, Catch's BENCHMARK below reports the per run time
+	const int runs = 200;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++)
+	{
+		manifolds.clear();
+		for (size_t p = 0; p < pairCount; p++)
+		{
+			Manifold manifold;
+			if (IntersectPair(batch.m_pairs[p * 2], batch.m_pairs[p * 2 + 1], manifold)) manifolds.push_back(manifold);
+		}
+	}
+	double pairSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++)
+	{
+		manifolds.clear();
+		batch.Run(manifolds);
+	}
+	double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cout << pairCount << " pairs (circle-circle " << batch.m_circleCircle.size() << ", circle-obb " << batch.m_circleObb.size() << ")" << endl;
+	cout << "  Pair by pair: " << (double)(pairCount * runs) / pairSeconds << " pairs/sec" << endl;
+	cout << "  Batched:      " << (double)(pairCount * runs) / batchSeconds << " pairs/sec" << endl;
+
+	BENCHMARK("Pair by pair IntersectPair") {
+		manifolds.clear();
+		for (size_t p = 0; p < pairCount; p++)
+		{
+			Manifold manifold;
+			if (IntersectPair(batch.m_pairs[p * 2], batch.m_pairs[p * 2 + 1], manifold)) manifolds.push_back(manifold);
+		}
+		return manifolds.size();
+	};
+	BENCHMARK("NarrowphaseBatch::Run") {
+		manifolds.clear();
+		return batch.Run(manifolds);
+	};
+}
+
+TEST_CASE("Obb axis cache never changes the result")
+{
+	std::vector<OrientedBox> boxes;
+	srand(5);
+	for (int i = 0; i < 48; i++)
+	{
+		boxes.push_back(OrientedBox(Vector2(RandomRange(0.1f, 0.8f), RandomRange(0.1f, 0.8f)), Vector2(RandomRange(-2.f, 2.f),
+		 RandomRange(-2.f, 2.f)), RandomRange(-PI, PI)));
+	}
+	//Warm, evicted and stale slots against a fresh box every time, a few passes with the boxes moving in between
+	for (int pass = 0; pass < 3; pass++)
+	{
+		for (size_t i = 0; i < boxes.size(); i++)
+		{
+			for (size_t j = 0; j < boxes.size(); j++)
+			{
+				if (i == j) continue;
+				OrientedBox fresh = OrientedBox(boxes[i].m_halfExtents, boxes[i].m_position, boxes[i].m_rotation);
+				Manifold cached, reference;
+				bool hit = boxes[i].IntersectWith(&boxes[j], cached);
+				REQUIRE(fresh.IntersectWith(&boxes[j], reference) == hit);
+				if (!hit) continue;
+				reference.rb1 = &boxes[i];
+				REQUIRE(memcmp(&cached, &reference, sizeof(Manifold)) == 0);
+			}
+		}
+		for (OrientedBox& box : boxes) box.m_position += Vector2(RandomRange(-0.2f, 0.2f), RandomRange(-0.2f, 0.2f));
+	}
+}
+
+TEST_CASE("Obb axis cache benchmark", "[!benchmark]")
+{
+	//Resting rows of boxes with small gaps, neighbours overlap in the broadphase but most pairs stay apart frame to frame
+	std::vector<OrientedBox> boxes;
+	for (int row = 0; row < 32; row++)
+	{
+		for (int col = 0; col < 64; col++)
+		{
+			boxes.push_back(OrientedBox(Vector2(0.5f, 0.25f), Vector2(col * 1.02f + (row % 2) * 0.5f, row * 0.5f + (col % 3) * 0.001f),
+			 (col % 5) * 0.002f));
+		}
+	}
+	//Each box against its row and column neighbours, like a leaf of a stack
+	std::vector<std::pair<OrientedBox*, OrientedBox*>> pairs;
+	for (size_t i = 0; i < boxes.size(); i++)
+	{
+		for (size_t j : { i + 1, i + 63, i + 64, i + 65 })
+		{
+			if (j < boxes.size()) pairs.push_back(std::make_pair(&boxes[j], &boxes[i]));
+		}
+	}
+	auto intersectAll = [&pairs]() {
+		int hits = 0;
+		for (auto& pair : pairs)
+		{
+			Manifold manifold;
+			hits += pair.first->IntersectWith(pair.second, manifold);
+		}
+		return hits;
+	};
+	cout << pairs.size() << " obb pairs, " << intersectAll() << " touching" << endl;
+
+	BENCHMARK("Cold axis cache") {
+		for (OrientedBox& box : boxes)
+		{
+			for (auto& slot : box.m_satAxisCache) slot.Clear();
+		}
+		return intersectAll();
+	};
+	BENCHMARK("Warm axis cache") {
+		return intersectAll();
+	};
+}
+
+TEST_CASE("Batch body creation and destruction")
+{
+	Solver solver;
+	BodyDesc descs[4] = { BodyDesc(BodyType::Circle), BodyDesc(BodyType::Capsule), BodyDesc(BodyType::Obb), BodyDesc(BodyType::Circle) };
+	for (int i = 0; i < 4; i++) descs[i].position = Vector2((decimal)(i * 4), 0);
+	descs[1].length = 3.f;
+	descs[2].halfExtents = Vector2(2.f, 0.5f);
+	Handle handles[4];
+	REQUIRE(solver.CreateBodies(descs, 4, handles) == 0);
+	for (int i = 0; i < 4; i++)
+	{
+		Rigidbody* rb = solver.m_allocator.GetBody(handles[i]);
+		REQUIRE(rb);
+		REQUIRE(rb->m_bodyType == descs[i].bodyType);
+		REQUIRE(rb->m_position == descs[i].position);
+	}
+	REQUIRE(((Capsule*)solver.m_allocator.GetBody(handles[1]))->m_length == descs[1].length);
+	REQUIRE(((OrientedBox*)solver.m_allocator.GetBody(handles[2]))->m_halfExtents == descs[2].halfExtents);
+
+	//Batch destroy keeps surviving handles pointing at the right bodies
+	Handle toDestroy[2] = { handles[0], handles[2] };
+	solver.DestroyBodies(toDestroy, 2);
+	REQUIRE(!solver.m_allocator.IsHandleValid(handles[0]));
+	REQUIRE(!solver.m_allocator.IsHandleValid(handles[2]));
+	REQUIRE(solver.m_allocator.GetBody(handles[1])->m_position == descs[1].position);
+	REQUIRE(solver.m_allocator.GetBody(handles[3])->m_position == descs[3].position);
+
+	//Freed mappings get recycled by the next batch
+	Handle recycled[2];
+	REQUIRE(solver.CreateBodies(descs, 2, recycled) == 0);
+	REQUIRE((recycled[0].idx == handles[0].idx && recycled[0].generation == handles[0].generation + 1));
+
+	//Clearing a region only takes the bodies inside it
+	REQUIRE(solver.DestroyBodiesInRegion(Vector2(1, 1), Vector2(-1, -1)) == 1);
+	REQUIRE(!solver.m_allocator.IsHandleValid(recycled[0]));
+	REQUIRE(solver.m_allocator.GetBody(handles[1])->m_position == descs[1].position);
+	REQUIRE(solver.m_allocator.GetBody(handles[3])->m_position == descs[3].position);
+
+	//Doesn't fit: nothing gets created
+	size_t available = solver.m_allocator.AvailableInPool();
+	std::vector<BodyDesc> tooMany(available / sizeof(Circle) + 1);
+	std::vector<Handle> tooManyHandles(tooMany.size());
+	REQUIRE(solver.CreateBodies(tooMany.data(), tooMany.size(), tooManyHandles.data()) == -1);
+	REQUIRE(solver.m_allocator.AvailableInPool() == available);
+
+	//Growing the pool through the solver drops the manifolds pointing into the old one, then the batch fits. The recycled
+	//capsule sits exactly on the first one, it goes before stepping
+	solver.DestroyBodies(&recycled[1], 1);
+	BodyDesc touching[2] = { BodyDesc(BodyType::Circle), BodyDesc(BodyType::Circle) };
+	touching[1].position = Vector2(0.5f, 0);
+	Handle touchingHandles[2];
+	REQUIRE(solver.CreateBodies(touching, 2, touchingHandles) == 0);
+	solver.Step(solver.m_timestep);
+	REQUIRE(!solver.m_currentManifolds.empty());
+	solver.ReservePool((solver.m_allocator.m_pool.end - solver.m_allocator.m_pool.start) + tooMany.size() * sizeof(Circle));
+	REQUIRE(solver.m_currentManifolds.empty());
+	REQUIRE(solver.CreateBodies(tooMany.data(), tooMany.size(), tooManyHandles.data()) == 0);
+}
+
+TEST_CASE("Batch creation benchmark", "[!benchmark]")
+{
+	const size_t bodyCount = 20000;
+	std::vector<BodyDesc> descs(bodyCount);
+	for (size_t i = 0; i < bodyCount; i++) {
+		descs[i].bodyType = (BodyType)(i % 3);
+		descs[i].position = Vector2((decimal)(int)(i % 200), (decimal)(int)(i / 200));
+	}
+	std::vector<Handle> handles(bodyCount);
+	Solver solver;
+	solver.m_allocator.ReservePool(bodyCount * sizeof(OrientedBox));
+
+	BENCHMARK("CreateBodies 20k") {
+		solver.m_allocator.DestroyAllBodies();
+		return solver.CreateBodies(descs.data(), bodyCount, handles.data());
+	};
+	BENCHMARK("DestroyBodies 10k of 20k") {
+		solver.m_allocator.DestroyAllBodies();
+		solver.CreateBodies(descs.data(), bodyCount, handles.data());
+		solver.DestroyBodies(handles.data(), bodyCount / 2);
+	};
+}
+
+TEST_CASE("Static chains and heightfields")
+{
+	//Rectangles project their real corners, a flat 2x0.2 slab doesn't reach a box 0.5 above it
+	OrientedBox slab = OrientedBox(Vector2(1.f, 0.1f), Vector2(0, 0));
+	OrientedBox above = OrientedBox(Vector2(0.2f, 0.2f), Vector2(0, 0.5f));
+	Manifold slabManifold;
+	REQUIRE(!IntersectPair((Rigidbody*)&slab, (Rigidbody*)&above, slabManifold));
+
+	//Chain BVH finds every segment a brute force bounds test would, plus at most the rest of their leaves
+	std::vector<Vector2> vertices;
+	for (int i = 0; i <= 1000; i++) vertices.push_back(Vector2(i * 0.1f - 50.f, Sin(i * 0.05f) * 3.f));
+	Chain chain = Chain(vertices.data(), vertices.size());
+	REQUIRE(chain.m_segments.size() == 1000);
+	srand(3);
+	for (int i = 0; i < 100; i++)
+	{
+		Vector2 bottomLeft = Vector2(RandomRange(-52.f, 52.f), RandomRange(-4.f, 4.f));
+		Vector2 topRight = bottomLeft + Vector2(RandomRange(0.f, 2.f), RandomRange(0.f, 2.f));
+		std::vector<OrientedBox*> found;
+		chain.Query(topRight, bottomLeft, found);
+		size_t expected = 0;
+		for (OrientedBox& segment : chain.m_segments)
+		{
+			Vector2 segmentTopRight, segmentBottomLeft;
+			segment.ComputeAabb(segmentTopRight, segmentBottomLeft);
+			if (segmentBottomLeft.x > topRight.x || segmentTopRight.x < bottomLeft.x || segmentBottomLeft.y > topRight.y ||
+			 segmentTopRight.y < bottomLeft.y) continue;
+			expected++;
+			REQUIRE(std::find(found.begin(), found.end(), &segment) != found.end());
+		}
+		REQUIRE(found.size() <= expected * CHAIN_LEAF_SEGMENTS * 2 + CHAIN_LEAF_SEGMENTS);
+	}
+
+	//Boxes far off a heightfield find nothing, their x is never converted to an int that can't hold it
+	std::vector<decimal> flatHeights(11, (decimal)0.f);
+	Heightfield flat(flatHeights.data(), flatHeights.size(), Vector2(0, 0), 1.f);
+#if USE_FIXEDPOINT
+	decimal far = 1e8f;//Fixed point tops out at 2^31
+#else
+	decimal far = 1e12f;
+#endif
+	std::vector<OrientedBox*> farSegments;
+	flat.Query(Vector2(far, 1.f), Vector2(far - 1.f, -1.f), farSegments);
+	flat.Query(Vector2(-far + 1.f, 1.f), Vector2(-far, -1.f), farSegments);
+	REQUIRE(farSegments.empty());
+	flat.Query(Vector2(far, 1.f), Vector2(-far, -1.f), farSegments);
+	REQUIRE(farSegments.size() == 10);
+#if !USE_FIXEDPOINT
+	farSegments.clear();
+	flat.Query(Vector2(NAN, 1.f), Vector2(NAN, -1.f), farSegments);
+	REQUIRE(farSegments.empty());
+#endif
+
+	//Bodies dropped on a heightfield and a chain end up resting on them
+	Solver solver;
+	std::vector<decimal> heights;
+	for (int i = 0; i <= 200; i++) heights.push_back(Sin(i * 0.1f) * 0.5f);
+	REQUIRE(solver.CreateHeightfield(heights.data(), heights.size(), Vector2(-10.f, -5.f), 0.1f) == 0);
+	Vector2 ledge[3] = { Vector2(2.f, 1.f), Vector2(5.f, 1.f), Vector2(8.f, 2.f) };
+	REQUIRE(solver.CreateChain(ledge, 3) == 0);
+	REQUIRE(solver.CreateChain(ledge, 1) == -1);
+	Handle circleHandle, boxHandle;
+	solver.CreateCircle(circleHandle, 0.5f, Vector2(-3.f, 0.f), 0.f, Vector2(), 0.f, 1.f, 0.2f);
+	solver.CreateOrientedBox(boxHandle, Vector2(0.5f, 0.3f), Vector2(3.5f, 3.f), 0.f, Vector2(), 0.f, 1.f, 0.2f);
+	for (int i = 0; i < 300; i++) solver.Step(solver.m_timestep);
+	Rigidbody* circle = solver.m_allocator.GetBody(circleHandle);
+	Rigidbody* box = solver.m_allocator.GetBody(boxHandle);
+	decimal groundHeight = -5.f + Sin((circle->m_position.x + 10.f) * 10.f * 0.1f) * 0.5f;
+	REQUIRE(circle->m_position.y > groundHeight + 0.3f);
+	REQUIRE(circle->m_position.y < groundHeight + 0.7f);
+	REQUIRE(box->m_position.y > 1.f);
+	REQUIRE(box->m_position.y < 1.6f);
+	solver.DestroyStaticShapes();
+	REQUIRE(solver.m_staticShapes.empty());
+}
+
+TEST_CASE("Static terrain benchmark", "[!benchmark]")
+{
+	//The same 1000 segment terrain as kinematic boxes in the pool, and as one heightfield
+	const int segmentCount = 1000;
+	std::vector<decimal> heights;
+	for (int i = 0; i <= segmentCount; i++) heights.push_back(Sin(i * 0.02f) * 2.f);
+	decimal spacing = 20.f / segmentCount;
+	auto addBodies = [](Solver& solver) {
+		for (int i = 0; i < 20; i++)
+		{
+			Handle handle;
+			solver.CreateCircle(handle, 0.2f, Vector2(-9.f + i * 0.9f, 0.f));
+		}
+	};
+	Solver boxSolver;
+	boxSolver.m_allocator.ReservePool((segmentCount + 20) * sizeof(OrientedBox));
+	for (int i = 0; i < segmentCount; i++)
+	{
+		Vector2 a = Vector2(-10.f + spacing * i, -5.f + heights[i]);
+		Vector2 ab = Vector2(spacing, heights[i + 1] - heights[i]);
+		Handle handle;
+		boxSolver.CreateOrientedBox(handle, Vector2(ab.Length() / 2, 0.05f), a + ab / 2, Atan2(ab.y, ab.x), Vector2(), 0.f, 1.f, 1.f, true);
+	}
+	addBodies(boxSolver);
+	Solver fieldSolver;
+	fieldSolver.CreateHeightfield(heights.data(), heights.size(), Vector2(-10.f, -5.f), spacing);
+	addBodies(fieldSolver);
+
+	BENCHMARK("Step, 1000 kinematic boxes") {
+		boxSolver.Step(boxSolver.m_timestep);
+	};
+	BENCHMARK("Step, 1000 segment heightfield") {
+		fieldSolver.Step(fieldSolver.m_timestep);
+	};
+}
+
+TEST_CASE("Speculative contacts stop tunneling")
+{
+	//Small fast bodies against a thin wall at 30 Hz: discrete steps jump right over it, speculative ones don't
+	for (int speculative = 0; speculative < 2; speculative++)
+	{
+		Solver solver;
+		solver.m_stepMode = false;
+		solver.m_timestep = 1.f / 30.f;
+		solver.m_gravity = 0;
+		solver.m_speculativeContacts = speculative == 1;
+		Handle circleHandle, boxHandle, capsuleHandle, handle;
+		solver.CreateOrientedBox(handle, Vector2(0.05f, 4.f), Vector2(0, 0), 0.f, Vector2(), 0.f, 1.f, 0.5f, true);
+		solver.CreateCircle(circleHandle, 0.1f, Vector2(-5.f, 2.f), 0.f, Vector2(60.f, 0));
+		solver.CreateOrientedBox(boxHandle, Vector2(0.1f, 0.1f), Vector2(-5.3f, 0), 0.3f, Vector2(75.f, 0));
+		solver.CreateCapsule(capsuleHandle, 0.3f, 0.1f, Vector2(-5.5f, -2.f), 1.f, Vector2(50.f, 0));
+		for (int i = 0; i < 30; i++) solver.Step(solver.m_timestep);
+		Handle handles[3] = { circleHandle, boxHandle, capsuleHandle };
+		for (int i = 0; i < 3; i++)
+		{
+			Rigidbody* rb = solver.m_allocator.GetBody(handles[i]);
+			if (speculative) REQUIRE(rb->m_position.x < 0);
+			else REQUIRE(rb->m_position.x > 0);
+		}
+	}
+	//Steps longer than m_timestep close the gap over their own dt
+	{
+		Solver solver;
+		solver.m_stepMode = false;
+		solver.m_timestep = 1.f / 60.f;
+		solver.m_gravity = 0;
+		solver.m_speculativeContacts = true;
+		Handle circleHandle, handle;
+		solver.CreateOrientedBox(handle, Vector2(0.05f, 4.f), Vector2(0, 0), 0.f, Vector2(), 0.f, 1.f, 0.5f, true);
+		solver.CreateCircle(circleHandle, 0.1f, Vector2(-5.f, 2.f), 0.f, Vector2(60.f, 0));
+		for (int i = 0; i < 30; i++) solver.Step(1.f / 20.f);
+		REQUIRE(solver.m_allocator.GetBody(circleHandle)->m_position.x < 0);
+	}
+
+	//Resting contact keeps working, the last speculative step lets the box just touch
+	Solver solver;
+	solver.m_stepMode = false;
+	solver.m_timestep = 1.f / 30.f;
+	solver.m_speculativeContacts = true;
+	Handle handle, boxHandle;
+	solver.CreateOrientedBox(handle, Vector2(5.f, 0.5f), Vector2(0, -3.f), 0.f, Vector2(), 0.f, 1.f, 0.2f, true);
+	solver.CreateOrientedBox(boxHandle, Vector2(0.5f, 0.5f), Vector2(0.3f, 0), 0.f, Vector2(), 0.f, 1.f, 0.2f);
+	for (int i = 0; i < 90; i++) solver.Step(solver.m_timestep);
+	Rigidbody* box = solver.m_allocator.GetBody(boxHandle);
+	REQUIRE(box->m_position.y > -2.05f);
+	REQUIRE(box->m_position.y < -1.9f);
+	//The gap comes back as negative penetration, only within the distance asked for
+	box->m_position = Vector2(0.3f, -1.5f);
+	box->m_rotation = 0;
+	box->UpdateRotation();
+	Manifold gap;
+	REQUIRE(SpeculativePair(box, solver.m_allocator.GetBody(handle), (decimal)1.f, gap));
+	REQUIRE(Abs(gap.penetration + 0.5f) < 1e-4f);
+	REQUIRE(gap.normal.EqualsEps(Vector2(0, 1.f), 1e-4f));
+	REQUIRE(!SpeculativePair(box, solver.m_allocator.GetBody(handle), (decimal)0.4f, gap));
+}
+
+TEST_CASE("Float and fixed point worlds side by side")
+{
+	BasicSolver<float> floatSolver;
+	BasicSolver<fp64::Fp64> fixedSolver;
+	CreateBenchmarkWorld(floatSolver, 400);
+	CreateBenchmarkWorld(fixedSolver, 400);
+	for (int i = 0; i < 3; i++)
+	{
+		floatSolver.Step(floatSolver.m_timestep);
+		fixedSolver.Step(fixedSolver.m_timestep);
+	}
+	//Same scene in both scalars, a few steps in they still agree closely
+	float maxDistance = 0.f;
+	BasicRigidbody<fp64::Fp64>* fixedRb = fixedSolver.m_allocator.GetFirstBody();
+	for (BasicRigidbody<float>* rb = floatSolver.m_allocator.GetFirstBody(); rb != nullptr; rb = floatSolver.m_allocator.GetNextBody(rb))
+	{
+		REQUIRE(fixedRb != nullptr);
+		REQUIRE(fixedRb->m_bodyType == rb->m_bodyType);
+		maxDistance = std::max(maxDistance, BasicVector2<float>(rb->m_position.x - (float)fixedRb->m_position.x,
+		 rb->m_position.y - (float)fixedRb->m_position.y).Length());
+		fixedRb = fixedSolver.m_allocator.GetNextBody(fixedRb);
+	}
+	REQUIRE(fixedRb == nullptr);
+	REQUIRE(maxDistance < 0.01f);
+}
+
+TEST_CASE("Float and fixed point step benchmark", "[!benchmark]")
+{
+	BasicSolver<float> floatSolver;
+	BasicSolver<fp64::Fp64> fixedSolver;
+	CreateBenchmarkWorld(floatSolver, 1000);
+	CreateBenchmarkWorld(fixedSolver, 1000);
+	BENCHMARK("Step 1000 bodies, float") {
+		floatSolver.Step(floatSolver.m_timestep);
+	};
+	BENCHMARK("Step 1000 bodies, Fp64") {
+		fixedSolver.Step(fixedSolver.m_timestep);
+	};
+}
+
+TEST_CASE("Snapshot restore and resimulation")
+{
+	Solver solver;
+	CreateBenchmarkWorld(solver, 200);
+	for (int i = 0; i < 10; i++) solver.Step(solver.m_timestep);
+	SolverState state;
+	solver.SaveState(state);
+	std::vector<QuadNode*> leafNodes;
+	size_t savedLeafCount = solver.m_quadTreeRoot.GetLeafNodes(leafNodes);
+
+	for (int i = 0; i < 20; i++) solver.Step(solver.m_timestep);
+	std::vector<char> expected(solver.m_allocator.m_pool.start, solver.m_allocator.m_pool.next);
+
+	REQUIRE(solver.RestoreState(state) == 0);
+	leafNodes.clear();
+	REQUIRE(solver.m_quadTreeRoot.GetLeafNodes(leafNodes) == savedLeafCount);
+	REQUIRE(memcmp(solver.m_allocator.m_pool.start, state.pool.data(), state.pool.size()) == 0);
+
+	//Resimulating from the snapshot lands on the exact same state
+	REQUIRE(solver.Resimulate(state, 20) == 0);
+	REQUIRE(expected.size() == (size_t)(solver.m_allocator.m_pool.next - solver.m_allocator.m_pool.start));
+	REQUIRE(memcmp(solver.m_allocator.m_pool.start, expected.data(), expected.size()) == 0);
+}
+
+TEST_CASE("Snapshot benchmark", "[!benchmark]")
+{
+	size_t bodyCounts[2] = { 1000, 10000 };
+	for (size_t bodyCount : bodyCounts)
+	{
+		Solver solver;
+		CreateBenchmarkWorld(solver, bodyCount);
+		for (int i = 0; i < 5; i++) solver.Step(solver.m_timestep);
+		SolverState state;
+		solver.SaveState(state);
+		std::cout << bodyCount << " bodies, snapshot bytes: " << state.ByteSize() << std::endl;
+		std::string suffix = " " + std::to_string(bodyCount);
+
+		BENCHMARK("SaveState" + suffix) {
+			solver.SaveState(state);
+		};
+		BENCHMARK("RestoreState" + suffix) {
+			return solver.RestoreState(state);
+		};
+		BENCHMARK("Resimulate 1 step" + suffix) {
+			return solver.Resimulate(state, 1);
+		};
+	}
+}
+
+//Benchmark world plus the shapes the SIMD buckets don't take and some static ground
+static void CreateMixedWorld(Solver& solver, size_t bodyCount)
+{
+	CreateBenchmarkWorld(solver, bodyCount);
+	solver.m_allocator.ReservePool((bodyCount + 100) * sizeof(Compound));
+	Vector2 triangle[3] = { Vector2(-0.15f, -0.1f), Vector2(0.15f, -0.1f), Vector2(0, 0.15f) };
+	BodyDesc children[2];
+	children[0].bodyType = BodyType::Obb;
+	children[0].halfExtents = Vector2(0.2f, 0.05f);
+	children[1].radius = 0.1f;
+	children[1].position = Vector2(0.2f, 0);
+	for (int i = 0; i < 50; i++)
+	{
+		Handle handle;
+		Vector2 position = Vector2(RandomRange(-9.f, 9.f), RandomRange(-8.f, 9.f));
+		solver.CreatePolygon(handle, triangle, 3, position, RandomRange(0.f, 3.f), Vector2(RandomRange(-2.f, 2.f), 0));
+		solver.CreateCompound(handle, children, 2, position + Vector2(0.3f, 0.3f), RandomRange(0.f, 3.f));
+	}
+	std::vector<decimal> heights;
+	for (int i = 0; i <= 200; i++) heights.push_back(Sin(i * 0.1f) * 0.5f);
+	solver.CreateHeightfield(heights.data(), heights.size(), Vector2(-10.f, -10.f), 0.1f);
+}
+
+//Runs a parallel-for's ranges on this thread in a shuffled order, posing as threadCount threads
+class ShuffledScheduler :
+	public TaskScheduler
+{
+public:
+	ShuffledScheduler(unsigned int threadCount, unsigned int seed) : m_threadCount(threadCount), m_seed(seed) {}
+	virtual void ParallelFor(size_t count, size_t grain, TaskFunction task, void* context) override
+	{
+		std::vector<size_t> ranges;
+		for (size_t begin = 0; begin < count; begin += grain) ranges.push_back(begin);
+		for (size_t i = ranges.size(); i > 1; i--)
+		{
+			m_seed = m_seed * 1103515245u + 12345u;
+			std::swap(ranges[i - 1], ranges[m_seed % i]);
+		}
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			task(context, ranges[i], std::min(ranges[i] + grain, count), (unsigned int)(i % m_threadCount));
+		}
+	}
+	virtual unsigned int GetThreadCount() override { return m_threadCount; }
+	unsigned int m_threadCount, m_seed;
+};
+
+TEST_CASE("Determinism across thread counts")
+{
+	//Every scenario is stepped on 1 thread for reference, then on more threads and under a scheduler that runs ranges in
+	//a shuffled order. The state hash has to match the reference after every single step
+	struct Scenario
+	{
+		const char* name;
+		bool mixed, batched, speculative;
+	};
+	Scenario scenarios[4] = {
+		{ "benchmark world", false, true, false },
+		{ "mixed world", true, true, false },
+		{ "mixed world, unbatched", true, false, false },
+		{ "mixed world, speculative", true, false, true }
+	};
+	const int steps = 40;
+	for (Scenario& scenario : scenarios)
+	{
+		std::vector<uint64_t> reference;
+		for (int run = 0; run < 5; run++)
+		{
+			srand(11);
+			Solver solver;
+			if (scenario.mixed) CreateMixedWorld(solver, 600);
+			else CreateBenchmarkWorld(solver, 1000);
+			solver.m_batchNarrowphase = scenario.batched;
+			solver.m_speculativeContacts = scenario.speculative;
+			unsigned int threadCounts[4] = { 1, 2, 4, 8 };
+			ShuffledScheduler shuffled(7, 5);
+			if (run < 4) solver.m_jobSystem.SetThreadCount(threadCounts[run]);
+			else solver.m_scheduler = &shuffled;
+			std::vector<uint64_t> hashes;
+			for (int i = 0; i < steps; i++)
+			{
+				solver.Step(solver.m_timestep);
+				hashes.push_back(solver.HashState());
+			}
+			REQUIRE(!solver.m_currentManifolds.empty());
+			if (run == 0) reference = hashes;
+			REQUIRE(hashes.front() != hashes.back());
+			INFO(scenario.name << ", run " << run);
+			REQUIRE(hashes == reference);
+		}
+	}
+
+	//Every range is handed out exactly once, whoever ends up running it
+	JobSystem jobSystem(8);
+	std::vector<int> counts(10007, 0);
+	std::vector<unsigned int> threads(counts.size());
+	ParallelFor(&jobSystem, counts.size(), 13, [&](size_t begin, size_t end, unsigned int threadIdx) {
+		for (size_t i = begin; i < end; i++)
+		{
+			counts[i]++;
+			threads[i] = threadIdx;
+		}
+	});
+	REQUIRE(std::count(counts.begin(), counts.end(), 1) == (int)counts.size());
+	REQUIRE(*std::max_element(threads.begin(), threads.end()) < 8);
+}
+
+//Whole file in and out, the malformed file tests edit a good file's bytes
+static std::vector<char> ReadFileBytes(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void WriteFileBytes(const char* path, const std::vector<char>& bytes)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(bytes.data(), bytes.size());
+}
+
+TEST_CASE("State hash and desync detection")
+{
+	Solver solver;
+	srand(7);
+	CreateMixedWorld(solver, 300);
+	SolverState start;
+	solver.SaveState(start);
+	//The hash Step leaves matches a full pass over the same state
+	for (int i = 0; i < 10; i++)
+	{
+		solver.Step(solver.m_timestep);
+		uint64_t stepHash = solver.m_stateHash;
+		REQUIRE(stepHash == solver.HashState());
+	}
+
+	//Same start on 1 and 4 threads records the same run
+	const unsigned int steps = 30;
+	DesyncLog a, b;
+	solver.m_jobSystem.SetThreadCount(1);
+	REQUIRE(a.Replay(solver, start, steps) == 0);
+	solver.m_jobSystem.SetThreadCount(4);
+	REQUIRE(b.Replay(solver, start, steps) == 0);
+	REQUIRE(a.GetStepCount() == steps);
+	size_t step;
+	Handle handle;
+	REQUIRE(!DesyncLog::FindDesync(a, b, step, handle));
+
+	//A client nudging one body before step 12 diverges there, on that body. Handle 0 comes first in handle order,
+	//whatever it hits that step is reported after it
+	DesyncLog c;
+	solver.RestoreState(start);
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		if (i == 12) solver.m_allocator.GetBody(Handle(0, 0))->m_velocity += Vector2(0.5f, 0);
+		solver.Step(solver.m_timestep);
+		c.Record(solver);
+	}
+	REQUIRE(DesyncLog::FindDesync(a, c, step, handle));
+	REQUIRE(step == 12);
+	REQUIRE(handle.idx == 0);
+
+	//Logs recorded elsewhere compare the same once read back
+	const char* path = "pip_desync_test.bin";
+	REQUIRE(c.Write(path) == 0);
+	DesyncLog read;
+	REQUIRE(read.Read(path) == 0);
+	remove(path);
+	REQUIRE(read.m_stateHashes == c.m_stateHashes);
+	REQUIRE(!DesyncLog::FindDesync(read, c, step, handle));
+	REQUIRE(DesyncLog::FindDesync(a, read, step, handle));
+	REQUIRE(step == 12);
+
+	//Destroying a body and creating another between steps keeps the body count, the log still hashes them as they are
+	DesyncLog swapped;
+	solver.RestoreState(start);
+	solver.Step(solver.m_timestep);
+	Handle first(0, 0), created;
+	solver.DestroyBodies(&first, 1);
+	REQUIRE(solver.CreateCircle(created, 0.2f, Vector2(0, 8.f)) == 0);
+	REQUIRE(created.idx == 0);
+	swapped.Record(solver);
+	REQUIRE(swapped.m_stateHashes[0] == solver.HashState());
+	REQUIRE(swapped.m_bodies[0].generation == created.generation);
+	REQUIRE(swapped.m_bodies[0].hash == Solver::HashBody(solver.m_allocator.GetBody(created)));
+
+	//Counts and offsets that don't fit the file are refused before anything is sized or indexed from them
+	REQUIRE(c.Write(path) == 0);
+	std::vector<char> good = ReadFileBytes(path);
+	size_t offsetsStart = sizeof(DesyncLogHeader) + steps * sizeof(uint64_t);
+	std::vector<char> bytes = good;
+	((DesyncLogHeader*)bytes.data())->stepCount = UINT64_MAX;
+	WriteFileBytes(path, bytes);
+	REQUIRE(read.Read(path) == -1);
+	REQUIRE(read.GetStepCount() == 0);
+	bytes = good;
+	((DesyncLogHeader*)bytes.data())->bodyCount = UINT64_MAX / sizeof(BodyHashRecord);
+	WriteFileBytes(path, bytes);
+	REQUIRE(read.Read(path) == -1);
+	bytes = good;
+	((DesyncLogHeader*)bytes.data())->bodyCount = c.m_bodies.size() + 1;
+	WriteFileBytes(path, bytes);
+	REQUIRE(read.Read(path) == -1);
+	//A step ending past the bodies while the last offset still matches
+	bytes = good;
+	((uint64_t*)(bytes.data() + offsetsStart))[5] = c.m_bodies.size() + 1000;
+	WriteFileBytes(path, bytes);
+	REQUIRE(read.Read(path) == -1);
+	//A step ending before it starts
+	bytes = good;
+	((uint64_t*)(bytes.data() + offsetsStart))[5] = 0;
+	WriteFileBytes(path, bytes);
+	REQUIRE(read.Read(path) == -1);
+	bytes = good;
+	bytes.resize(bytes.size() - 1);
+	WriteFileBytes(path, bytes);
+	REQUIRE(read.Read(path) == -1);
+	WriteFileBytes(path, good);
+	REQUIRE(read.Read(path) == 0);
+	remove(path);
+	REQUIRE(!DesyncLog::FindDesync(read, c, step, handle));
+}
+
+TEST_CASE("Solver trace export")
+{
+	Solver traced, untraced;
+	srand(3);
+	CreateMixedWorld(traced, 600);
+	srand(3);
+	CreateMixedWorld(untraced, 600);
+	traced.m_jobSystem.SetThreadCount(4);
+	TraceRecorder trace;
+	traced.m_trace = &trace;
+	//Two or three steps per Update, tracing mustn't change them
+	traced.m_stepMode = untraced.m_stepMode = false;
+	for (int i = 0; i < 20; i++)
+	{
+		traced.Update(traced.m_timestep * 2.5f);
+		untraced.Update(untraced.m_timestep * 2.5f);
+	}
+	REQUIRE(traced.HashState() == untraced.HashState());
+	std::map<std::string, int> counts;
+	for (TraceBuffer& buffer : trace.m_threads)
+	{
+		for (TraceEvent& event : buffer.events) counts[event.name]++;
+		//Buffers sit on cache lines of their own
+		REQUIRE((uintptr_t)&buffer % PIP_CACHE_LINE == 0);
+	}
+	REQUIRE(counts["Update"] == 20);
+	REQUIRE(counts["Step"] >= 40);
+	REQUIRE(counts["Narrowphase"] == counts["Step"]);
+	REQUIRE(counts["Pair tests"] >= counts["Step"]);
+	REQUIRE(counts["Subdivide"] > 0);
+
+	const char* path = "pip_trace_test.json";
+	REQUIRE(trace.Write(path) == 0);
+	std::ifstream file(path);
+	std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	remove(path);
+	REQUIRE(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+	REQUIRE(json.find("\"name\":\"Step\",\"cat\":\"pip\",\"ph\":\"X\"") != std::string::npos);
+	REQUIRE(json.rfind("]}") != std::string::npos);
+	trace.Clear();
+	REQUIRE(trace.GetEventCount() == 0);
+}
+
+TEST_CASE("Step stats")
+{
+	//Batched and leaf by leaf narrowphases test the same pairs and find the same contacts
+	Solver batched, unbatched;
+	CreateBenchmarkWorld(batched, 800);
+	CreateBenchmarkWorld(unbatched, 800);
+	unbatched.m_batchNarrowphase = false;
+	for (int i = 0; i < 15; i++)
+	{
+		batched.Step(batched.m_timestep);
+		unbatched.Step(unbatched.m_timestep);
+		const StepStats& stats = batched.m_stepStats;
+		REQUIRE(stats.pairTests == unbatched.m_stepStats.pairTests);
+		REQUIRE(stats.manifolds == unbatched.m_stepStats.manifolds);
+		REQUIRE(stats.manifolds == batched.m_currentManifolds.size());
+		REQUIRE(stats.awakeBodies + stats.sleepingBodies + stats.kinematicBodies == 800);
+		REQUIRE(stats.islands <= stats.manifolds);
+	}
+	std::vector<QuadNode*> leaves;
+	batched.m_quadTreeRoot.GetLeafNodes(leaves);
+	REQUIRE(batched.m_stepStats.pairTests > 0);
+	REQUIRE(batched.m_stepStats.kinematicBodies > 0);
+	REQUIRE(batched.m_stepStats.quadTreeDepth > 1);
+	REQUIRE(leaves.size() >= batched.m_stepStats.quadTreeDepth);
+}
+
+TEST_CASE("Broadphase diagnostics")
+{
+	Solver solver;
+	CreateBenchmarkWorld(solver, 800);
+	for (int i = 0; i < 10; i++) solver.Step(solver.m_timestep);
+	BroadphaseDiagnostics diagnostics;
+	solver.GetBroadphaseDiagnostics(diagnostics);
+	std::vector<QuadNode*> leaves;
+	solver.m_quadTreeRoot.GetLeafNodes(leaves);
+	REQUIRE(diagnostics.leafBodies.size() == leaves.size());
+	REQUIRE(diagnostics.leavesPerDepth.size() == solver.m_quadTreeRoot.GetDepth());
+	REQUIRE(std::accumulate(diagnostics.leavesPerDepth.begin(), diagnostics.leavesPerDepth.end(), (size_t)0) == leaves.size());
+	REQUIRE(std::accumulate(diagnostics.leavesPerBodyCount.begin(), diagnostics.leavesPerBodyCount.end(), (size_t)0) == leaves.size());
+	size_t entries = 0;
+	for (size_t n = 0; n < diagnostics.leavesPerBodyCount.size(); n++) entries += n * diagnostics.leavesPerBodyCount[n];
+	REQUIRE(entries == std::accumulate(diagnostics.leafBodies.begin(), diagnostics.leafBodies.end(), (size_t)0));
+	//Bodies on a leaf edge are entered in every leaf they touch
+	REQUIRE(diagnostics.bodiesInSeveralLeaves > 0);
+	REQUIRE(entries > 800);
+	REQUIRE(diagnostics.pairTests == std::accumulate(diagnostics.leafPairTests.begin(), diagnostics.leafPairTests.end(), (size_t)0));
+	REQUIRE(diagnostics.uniquePairs <= diagnostics.pairTests);
+	REQUIRE(diagnostics.overlaps > 0);
+	REQUIRE(diagnostics.overlaps <= diagnostics.uniquePairs);
+	REQUIRE(diagnostics.efficiency == Approx((float)diagnostics.overlaps / (float)diagnostics.pairTests));
+}
+
+TEST_CASE("Memory report and allocation hooks")
+{
+	struct Counts
+	{
+		size_t allocations, live;
+	};
+	Counts counts = {};
+	AllocationHooks hooks = {
+		[](size_t size, void* user) -> void* { ((Counts*)user)->allocations++; ((Counts*)user)->live++; return malloc(size); },
+		[](void* memory, size_t size, void* user) -> void* {
+			if (!memory) { ((Counts*)user)->allocations++; ((Counts*)user)->live++; }
+			return realloc(memory, size);
+		},
+		[](void* memory, void* user) { ((Counts*)user)->live--; free(memory); },
+		&counts
+	};
+	SetAllocationHooks(&hooks);
+	{
+		Solver solver;
+		CreateMixedWorld(solver, 800);
+		for (int i = 0; i < 5; i++) solver.Step(solver.m_timestep);
+		//Destroying a body moves the ones after it down the pool through a scratch copy
+		Handle handle(0, 0);
+		solver.DestroyBodies(&handle, 1);
+		MemoryReport report;
+		solver.GetMemoryReport(report);
+		REQUIRE(report.poolUsed == (size_t)(solver.m_allocator.m_pool.next - solver.m_allocator.m_pool.start));
+		REQUIRE(report.poolReserved >= report.poolUsed);
+		REQUIRE(report.mappingTables >= solver.m_allocator.m_mappings.size() * sizeof(Idx));
+		REQUIRE(report.quadTreeNodes > 1);
+		REQUIRE(report.quadTreeNodes % 4 == 1);
+		REQUIRE(report.quadTreeBytes >= (report.quadTreeNodes - 1 + solver.m_freeQuadNodes.size() * 4) * sizeof(QuadNode));
+		REQUIRE(report.leafVectors > 0);
+		REQUIRE(report.manifolds >= solver.m_currentManifolds.size() * sizeof(Manifold));
+		REQUIRE(report.narrowphase > 0);
+		REQUIRE(report.staticShapes > 0);
+		REQUIRE(report.total > report.poolReserved + report.manifolds);
+
+		WorldBatch batch(2, 10 * sizeof(OrientedBox));
+		batch.GetWorld(0).GetMemoryReport(report);
+		REQUIRE(report.poolReserved == 0);
+		REQUIRE(counts.allocations > report.quadTreeNodes / 4);
+	}
+	//Pool, quadtree nodes, scratch copies and batch blocks all went back through the hooks
+	REQUIRE(counts.live == 0);
+	SetAllocationHooks(nullptr);
+}
+
+TEST_CASE("Steady state steps don't allocate")
+{
+	size_t hookAllocations = 0;
+	AllocationHooks hooks = {
+		[](size_t size, void* user) -> void* { (*(size_t*)user)++; return malloc(size); },
+		[](void* memory, size_t size, void* user) -> void* { (*(size_t*)user)++; return realloc(memory, size); },
+		[](void* memory, void*) { free(memory); },
+		&hookAllocations
+	};
+	SetAllocationHooks(&hooks);
+	for (int threads = 1; threads <= 4; threads += 3)
+	{
+		Solver solver;
+		srand(3);
+		CreateMixedWorld(solver, 800);
+		solver.m_jobSystem.SetThreadCount(threads);
+		//Warm up, then play the same steps again: every buffer they need has grown to size the first time
+		const int steps = 30;
+		for (int i = 0; i < 10; i++) solver.Step(solver.m_timestep);
+		SolverState state;
+		solver.SaveState(state);
+		for (int i = 0; i < steps; i++) solver.Step(solver.m_timestep);
+		solver.RestoreState(state);
+		hookAllocations = 0;
+		s_allocationCount = 0;
+		s_countAllocations = true;
+		for (int i = 0; i < steps; i++) solver.Step(solver.m_timestep);
+		s_countAllocations = false;
+		INFO("threads: " << threads);
+		REQUIRE(s_allocationCount == 0);
+		REQUIRE(hookAllocations == 0);
+	}
+	SetAllocationHooks(nullptr);
+}
+
+TEST_CASE("Solver trace overhead benchmark", "[!benchmark]")
+{
+	Solver solver;
+	srand(11);
+	CreateMixedWorld(solver, 10000);
+	solver.m_jobSystem.SetThreadCount(4);
+	SolverState state;
+	solver.SaveState(state);
+	TraceRecorder trace;
+	//Same steps with and without the trace, taking the best of a few rounds of each
+	const int steps = 20;
+	double seconds[2] = { DBL_MAX, DBL_MAX };
+	for (int round = 0; round < 6; round++)
+	{
+		int traced = round % 2;
+		solver.m_trace = traced ? &trace : nullptr;
+		trace.Clear();
+		solver.RestoreState(state);
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) solver.Step(solver.m_timestep);
+		seconds[traced] = std::min(seconds[traced], std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::cout << "Step untraced: " << seconds[0] * 1000 / steps << " ms, traced: " << seconds[1] * 1000 / steps << " ms ("
+	 << (seconds[1] / seconds[0] - 1) * 100 << "% overhead, " << trace.GetEventCount() << " events)" << std::endl;
+}
+
+TEST_CASE("Job system benchmark", "[!benchmark]")
+{
+	//Same 20 steps from the same state at each thread count, phases are averaged per step
+	Solver solver;
+	srand(11);
+	CreateMixedWorld(solver, 10000);
+	for (int i = 0; i < 5; i++) solver.Step(solver.m_timestep);
+	SolverState state;
+	solver.SaveState(state);
+	const char* phaseNames[(int)StepPhase::Count] = { "Integration", "Broadphase", "Narrowphase", "Response" };
+	double baseline[(int)StepPhase::Count] = {};
+	std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+	unsigned int threadCounts[5] = { 1, 2, 4, 8, 16 };
+	for (unsigned int threadCount : threadCounts)
+	{
+		solver.m_jobSystem.SetThreadCount(threadCount);
+		solver.RestoreState(state);
+		double phaseTimes[(int)StepPhase::Count] = {};
+		const int steps = 20;
+		for (int i = 0; i < steps; i++)
+		{
+			solver.Step(solver.m_timestep);
+			for (int phase = 0; phase < (int)StepPhase::Count; phase++) phaseTimes[phase] += solver.m_phaseTimes[phase] / steps;
+		}
+		std::cout << threadCount << " threads:";
+		for (int phase = 0; phase < (int)StepPhase::Count; phase++)
+		{
+			if (threadCount == 1) baseline[phase] = phaseTimes[phase];
+			std::cout << " " << phaseNames[phase] << " " << phaseTimes[phase] << " ms (x" << baseline[phase] / phaseTimes[phase] << ")";
+		}
+		std::cout << std::endl;
+	}
+}
+
+TEST_CASE("World batch matches standalone worlds")
+{
+	//Worlds differ in body count, each one has to step exactly like a solver of its own on any thread count
+	const size_t worldCount = 40;
+	const int steps = 30;
+	std::vector<std::vector<uint64_t>> reference(worldCount);
+	for (size_t i = 0; i < worldCount; i++)
+	{
+		Solver solver;
+		CreateBenchmarkWorld(solver, 10 + i % 13);
+		for (int step = 0; step < steps; step++)
+		{
+			solver.Step(solver.m_timestep);
+			reference[i].push_back(solver.HashState());
+		}
+	}
+	unsigned int threadCounts[3] = { 1, 3, 8 };
+	for (unsigned int threadCount : threadCounts)
+	{
+		WorldBatch batch(worldCount, 24 * sizeof(OrientedBox), threadCount);
+		REQUIRE(batch.GetWorldCount() == worldCount);
+		for (size_t i = 0; i < worldCount; i++) CreateBenchmarkWorld(batch.GetWorld(i), 10 + i % 13);
+		std::vector<std::vector<uint64_t>> hashes(worldCount);
+		for (int step = 0; step < steps; step++)
+		{
+			batch.Step();
+			for (size_t i = 0; i < worldCount; i++) hashes[i].push_back(batch.GetWorld(i).HashState());
+		}
+		INFO(threadCount << " threads");
+		REQUIRE(hashes == reference);
+		//Pools are slices of one block, in world order
+		REQUIRE(batch.GetWorld(1).m_allocator.m_pool.start == batch.GetWorld(0).m_allocator.m_pool.start + batch.m_poolSize);
+	}
+}
+
+TEST_CASE("World batch benchmark", "[!benchmark]")
+{
+	//Thousands of 30 body worlds, as separate solvers stepped one after another and as a batch on each thread count
+	const size_t worldCount = 4096;
+	const size_t bodyCount = 30;
+	const unsigned int steps = 20;
+	std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+	{
+		std::vector<std::unique_ptr<Solver>> solvers;
+		for (size_t i = 0; i < worldCount; i++)
+		{
+			solvers.push_back(std::unique_ptr<Solver>(new Solver()));
+			CreateBenchmarkWorld(*solvers.back(), bodyCount);
+		}
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			for (std::unique_ptr<Solver>& solver : solvers) solver->Step(solver->m_timestep);
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Separate solvers: " << worldCount * steps / seconds << " world-steps/s" << std::endl;
+	}
+	unsigned int threadCounts[5] = { 1, 2, 4, 8, 16 };
+	for (unsigned int threadCount : threadCounts)
+	{
+		WorldBatch batch(worldCount, bodyCount * sizeof(OrientedBox), threadCount);
+		for (size_t i = 0; i < worldCount; i++) CreateBenchmarkWorld(batch.GetWorld(i), bodyCount);
+		auto start = std::chrono::steady_clock::now();
+		batch.Step(steps);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Batch, " << threadCount << " threads: " << worldCount * steps / seconds << " world-steps/s" << std::endl;
+	}
+}
+
+TEST_CASE("Async physics thread")
+{
+	Solver solver;
+	CreateBenchmarkWorld(solver, 200);
+	SolverState start;
+	solver.SaveState(start);
+	AsyncSolver asyncSolver(solver);
+	asyncSolver.Start();
+	REQUIRE(asyncSolver.IsRunning());
+	//The reader only ever sees whole steps, in order, and always has something to draw
+	unsigned int lastStep = 0;
+	while (lastStep < 10)
+	{
+		RenderSnapshot& snapshot = asyncSolver.AcquireSnapshot();
+		REQUIRE(snapshot.GetFirstBody() != nullptr);
+		REQUIRE(snapshot.stepCount >= lastStep);
+		lastStep = snapshot.stepCount;
+		decimal alpha = asyncSolver.GetAlpha(snapshot);
+		REQUIRE((alpha >= 0 && alpha <= 1));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	asyncSolver.Stop();
+	REQUIRE(!asyncSolver.IsRunning());
+
+	//The last published step is the state the solver was left in
+	RenderSnapshot& snapshot = asyncSolver.AcquireSnapshot();
+	REQUIRE(snapshot.pool.size() == (size_t)(solver.m_allocator.m_pool.next - solver.m_allocator.m_pool.start));
+	REQUIRE(memcmp(snapshot.pool.data(), solver.m_allocator.m_pool.start, snapshot.pool.size()) == 0);
+	Rigidbody* fourth = snapshot.GetNextBody(snapshot.GetNextBody(snapshot.GetNextBody(snapshot.GetFirstBody())));
+	REQUIRE(snapshot.GetBody(Handle(3, 0)) == fourth);
+	REQUIRE(snapshot.GetBody(Handle(3, 1)) == nullptr);
+	//Same steps on this thread land on the same state
+	REQUIRE(solver.Resimulate(start, snapshot.stepCount) == 0);
+	REQUIRE(memcmp(snapshot.pool.data(), solver.m_allocator.m_pool.start, snapshot.pool.size()) == 0);
+}
+
+TEST_CASE("World file round trip")
+{
+	const char* path = "pip_world_test.bin";
+	Solver solver;
+	CreateBenchmarkWorld(solver, 200);
+	solver.m_allocator.ReservePool(200 * sizeof(OrientedBox) + 2 * sizeof(ConvexPolygon) + sizeof(Compound));
+	Vector2 triangle[3] = { Vector2(0, 0), Vector2(0.6f, 0), Vector2(0, 0.4f) };
+	Vector2 hexagon[6] = { Vector2(0.4f, 0), Vector2(0.2f, 0.35f), Vector2(-0.2f, 0.35f), Vector2(-0.4f, 0), Vector2(-0.2f, -0.35f),
+	 Vector2(0.2f, -0.35f) };
+	Handle handle;
+	REQUIRE(solver.CreatePolygon(handle, triangle, 3, Vector2(-3.f, 9.5f)) == 0);
+	REQUIRE(solver.CreatePolygon(handle, hexagon, 6, Vector2(3.f, 9.5f), 0.5f) == 0);
+	BodyDesc children[2] = { BodyDesc(BodyType::Capsule), BodyDesc(BodyType::Circle) };
+	children[0].length = 0.6f;
+	children[0].radius = 0.1f;
+	children[1].radius = 0.2f;
+	children[1].position = Vector2(0.5f, 0.1f);
+	REQUIRE(solver.CreateCompound(handle, children, 2, Vector2(0, 9.5f), 0.3f) == 0);
+	for (int i = 0; i < 10; i++) solver.Step(solver.m_timestep);
+	REQUIRE(WorldFile::Write(path, solver) == 0);
+
+	WorldFile world;
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.m_header->bodyCount == 203);
+	REQUIRE(world.m_header->vertexCount == 9);
+	REQUIRE(world.m_header->childCount == 2);
+	Solver loaded;
+	REQUIRE(world.Load(loaded) == 0);
+	world.Close();
+	remove(path);
+
+	//Same bodies, same order, same broadphase layout
+	std::vector<QuadNode*> leafNodes, loadedLeafNodes;
+	REQUIRE(solver.m_quadTreeRoot.GetLeafNodes(leafNodes) == loaded.m_quadTreeRoot.GetLeafNodes(loadedLeafNodes));
+	Rigidbody* rb = solver.m_allocator.GetFirstBody();
+	Rigidbody* loadedRb = loaded.m_allocator.GetFirstBody();
+	for (; rb != nullptr && loadedRb != nullptr; rb = solver.m_allocator.GetNextBody(rb), loadedRb = loaded.m_allocator.GetNextBody(loadedRb))
+	{
+		REQUIRE(loadedRb->m_bodyType == rb->m_bodyType);
+		REQUIRE(loadedRb->m_position == rb->m_position);
+		REQUIRE(loadedRb->m_velocity == rb->m_velocity);
+		REQUIRE(loadedRb->m_inertia == rb->m_inertia);
+		REQUIRE(loadedRb->m_isKinematic == rb->m_isKinematic);
+		if (rb->m_bodyType == BodyType::Compound)
+		{
+			Compound* compound = (Compound*)rb;
+			Compound* loadedCompound = (Compound*)loadedRb;
+			REQUIRE(loadedCompound->m_childCount == compound->m_childCount);
+			for (int i = 0; i < compound->m_childCount; i++)
+			{
+				REQUIRE(loadedCompound->GetChild(i)->m_bodyType == compound->GetChild(i)->m_bodyType);
+				REQUIRE(loadedCompound->m_childOffsets[i].EqualsEps(compound->m_childOffsets[i], 1e-4f));
+			}
+		}
+		if (rb->m_bodyType != BodyType::Polygon) continue;
+		ConvexPolygon* polygon = (ConvexPolygon*)rb;
+		ConvexPolygon* loadedPolygon = (ConvexPolygon*)loadedRb;
+		REQUIRE(loadedPolygon->m_vertexCount == polygon->m_vertexCount);
+		for (int i = 0; i < polygon->m_vertexCount; i++) REQUIRE(loadedPolygon->m_vertices[i].EqualsEps(polygon->m_vertices[i], 1e-4f));
+	}
+	REQUIRE((rb == nullptr && loadedRb == nullptr));
+
+	//Anything that isn't a world is rejected, starting with a full header that has the wrong magic
+	REQUIRE(WorldFile::Write(path, solver) == 0);
+	std::vector<char> good = ReadFileBytes(path);
+	std::vector<char> bytes = good;
+	((WorldFileHeader*)bytes.data())->magic = 0;
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == -1);
+	//Sections reaching past the end of the file
+	bytes = good;
+	((WorldFileHeader*)bytes.data())->bodyCount = bytes.size();
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == -1);
+	bytes = good;
+	((WorldFileHeader*)bytes.data())->quadTreeShapeOffset = bytes.size() + 1;
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == -1);
+	//A quadtree that runs out of bytes, and one that only ever subdivides. The second used to overflow the stack
+	bytes = good;
+	WorldFileHeader* header = (WorldFileHeader*)bytes.data();
+	memset(bytes.data() + header->quadTreeShapeOffset, 0, (size_t)header->quadTreeShapeSize);
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == -1);
+	bytes = good;
+	((WorldFileHeader*)bytes.data())->quadTreeShapeOffset = bytes.size();
+	((WorldFileHeader*)bytes.data())->quadTreeShapeSize = 1 << 20;
+	bytes.resize(bytes.size() + (1 << 20), 0);
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == -1);
+	//A bad record is found before anything is destroyed, the solver keeps its world
+	bytes = good;
+	((WorldBodyRecord*)(bytes.data() + ((WorldFileHeader*)bytes.data())->bodiesOffset))[100].bodyType = 99;
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.Load(loaded) == -1);
+	world.Close();
+	size_t bodyCount = 0;
+	for (Rigidbody* body = loaded.m_allocator.GetFirstBody(); body != nullptr; body = loaded.m_allocator.GetNextBody(body)) bodyCount++;
+	REQUIRE(bodyCount == 203);
+	//A hexagon claiming more vertices than the section holds, the range check used to wrap and read past the file
+	bytes = good;
+	((WorldFileHeader*)bytes.data())->vertexCount = 3;
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.Load(loaded) == -1);
+	world.Close();
+	//The compound's children past the end of the child section, same wrap as the vertex range
+	bytes = good;
+	((WorldFileHeader*)bytes.data())->childCount = 1;
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.Load(loaded) == -1);
+	world.Close();
+	//Compound children with no area
+	bytes = good;
+	header = (WorldFileHeader*)bytes.data();
+	WorldChildRecord* childRecords = (WorldChildRecord*)(bytes.data() + header->childrenOffset);
+	for (int i = 0; i < 2; i++) childRecords[i].shape[0] = childRecords[i].shape[1] = 0;
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.Load(loaded) == -1);
+	world.Close();
+	//Collinear vertices would divide by a zero area
+	bytes = good;
+	header = (WorldFileHeader*)bytes.data();
+	decimal* vertices = (decimal*)(bytes.data() + header->verticesOffset);
+	for (int i = 0; i < 3; i++)
+	{
+		vertices[2 * i] = (decimal)(float)i;
+		vertices[2 * i + 1] = 0;
+	}
+	WriteFileBytes(path, bytes);
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.Load(loaded) == -1);
+	world.Close();
+	//A batch world's pool can't grow past its slice, a file too big for it leaves the world as it was
+	WriteFileBytes(path, good);
+	WorldBatch batch(1, 10 * sizeof(OrientedBox));
+	Solver& small = batch.GetWorld(0);
+	BodyDesc descs[2] = { BodyDesc(BodyType::Obb), BodyDesc(BodyType::Circle) };
+	descs[1].position = Vector2(3.f, 0);
+	Handle handles[2];
+	REQUIRE(small.CreateBodies(descs, 2, handles) == 0);
+	uint64_t hash = small.HashState();
+	REQUIRE(world.Open(path) == 0);
+	REQUIRE(world.Load(small) == -1);
+	world.Close();
+	REQUIRE(small.HashState() == hash);
+	REQUIRE(small.m_allocator.IsHandleValid(handles[1]));
+	remove(path);
+}
+
+TEST_CASE("World file load benchmark", "[!benchmark]")
+{
+	const char* path = "pip_world_bench.bin";
+	const size_t bodyCount = 20000;
+	Solver solver;
+	CreateBenchmarkWorld(solver, bodyCount);
+	//Prebuilt 256 leaf tree, a first step with every body in the root leaf would test all 2e8 pairs
+	for (int level = 0; level < 4; level++)
+	{
+		std::vector<QuadNode*> leaves;
+		solver.m_quadTreeRoot.GetLeafNodes(leaves);
+		for (QuadNode* leaf : leaves) leaf->Subdivide();
+	}
+	solver.Step(solver.m_timestep);
+	WorldFile::Write(path, solver);
+	std::vector<BodyDesc> descs(bodyCount);
+	size_t bodyIdx = 0;
+	for (Rigidbody* rb = solver.m_allocator.GetFirstBody(); rb != nullptr; rb = solver.m_allocator.GetNextBody(rb)) descs[bodyIdx++].bodyType = rb->m_bodyType;
+	std::vector<Handle> handles(bodyCount);
+	Solver loaded;
+
+	BENCHMARK("Open + Load 20k") {
+		WorldFile world;
+		world.Open(path);
+		return world.Load(loaded);
+	};
+	BENCHMARK("CreateBodies 20k (code built scene)") {
+		loaded.m_allocator.DestroyAllBodies();
+		return loaded.CreateBodies(descs.data(), bodyCount, handles.data());
+	};
+	remove(path);
+}
+
 int main(int argc, char* argv[])
 {
 	//Do tests here (asserts)
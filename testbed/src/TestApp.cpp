@@ -3,12 +3,14 @@
 #include "Circle.h"
 #include "Capsule.h"
 #include "OrientedBox.h"
+#include "ConvexPolygon.h"
+#include "Compound.h"
 
 using namespace PipMath;
 
 TestApp::TestApp()
-	:m_window(nullptr), m_glslVersion(""), m_sceneName(""), m_prevTime(0), m_showDemoWindow(false), m_showRigidbodyEditor(true), m_displayManifolds(true), m_drawGrid(true),
-	m_renderLeafNodes(true), m_inputDown(0), m_inputPressed(0), m_inputHeld(0), m_inputReleased(0)
+	:m_window(nullptr), m_glslVersion(""), m_sceneName(""), m_asyncSolver(m_solver), m_prevTime(0), m_showDemoWindow(false), m_showRigidbodyEditor(true), m_displayManifolds(true), m_drawGrid(true),
+	m_renderLeafNodes(true), m_asyncPhysics(false), m_showPerformance(false), m_leafHeatMap(false), m_perfHistory(), m_perfOffset(0), m_spawnCount(500), m_inputDown(0), m_inputPressed(0), m_inputHeld(0), m_inputReleased(0)
 {
 }
 
@@ -75,7 +77,9 @@ void TestApp::LoadScene(unsigned int index)
 {
 	//Deallocate m_allocator pool
 	m_solver.m_allocator.DestroyAllBodies();
+	m_solver.DestroyStaticShapes();
 	m_solver.m_currentManifolds.clear();
+	m_solver.m_stateHashStale = true;
 	m_bodyHandles.clear();
 	Handle handle;
 	switch (index) {
@@ -130,6 +134,33 @@ void TestApp::LoadScene(unsigned int index)
 		if (m_solver.CreateCircle(handle, 1.0f, Vector2(-2.f, -6), 0.0f, Vector2(1.5f, 0)) != -1) m_bodyHandles.push_back(handle);
 		break;
 	}
+	case 6:
+	{
+		m_sceneName = "Scene 6: Heightfield and chain terrain";
+		std::vector<decimal> heights;
+		for (int i = 0; i <= 160; i++) heights.push_back(Sin(i * 0.15f) * 1.5f + Sin(i * 0.04f) * 2.f);
+		m_solver.CreateHeightfield(heights.data(), heights.size(), Vector2(-16.f, -9.f), 0.2f);
+		Vector2 ledge[4] = { Vector2(-8.f, 3.f), Vector2(-3.f, 2.f), Vector2(0.f, 2.5f), Vector2(4.f, 1.f) };
+		m_solver.CreateChain(ledge, 4);
+		for (int i = 0; i < 6; i++) {
+			if (m_solver.CreateCircle(handle, 0.5f, Vector2(-7.f + i * 2.f, 6.f)) != -1) m_bodyHandles.push_back(handle);
+		}
+		if (m_solver.CreateOrientedBox(handle, Vector2(0.8f, 0.4f), Vector2(-5.f, 8.f)) != -1) m_bodyHandles.push_back(handle);
+		if (m_solver.CreateCapsule(handle, 1.f, 0.4f, Vector2(8.f, 4.f)) != -1) m_bodyHandles.push_back(handle);
+		Vector2 hexagon[6];
+		for (int i = 0; i < 6; i++) hexagon[i] = Vector2(Cos(i * 60 * DEG2RAD), Sin(i * 60 * DEG2RAD)) * 0.7f;
+		if (m_solver.CreatePolygon(handle, hexagon, 6, Vector2(1.f, 7.f)) != -1) m_bodyHandles.push_back(handle);
+		Vector2 wedge[3] = { Vector2(-0.8f, -0.4f), Vector2(0.8f, -0.4f), Vector2(0.f, 0.6f) };
+		if (m_solver.CreatePolygon(handle, wedge, 3, Vector2(-1.f, 9.f), 30 * DEG2RAD) != -1) m_bodyHandles.push_back(handle);
+		//Hammer: a capsule handle with a box head
+		BodyDesc hammer[2] = { BodyDesc(BodyType::Capsule), BodyDesc(BodyType::Obb) };
+		hammer[0].length = 1.6f;
+		hammer[0].radius = 0.15f;
+		hammer[1].halfExtents = Vector2(0.25f, 0.5f);
+		hammer[1].position = Vector2(0.9f, 0);
+		if (m_solver.CreateCompound(handle, hammer, 2, Vector2(5.f, 8.f), 20 * DEG2RAD) != -1) m_bodyHandles.push_back(handle);
+		break;
+	}
 	default:
 		break;
 	}
@@ -151,80 +182,53 @@ void TestApp::UpdateLoop()
 		decimal dt = curTime - m_prevTime;
 		m_prevTime = curTime;
 		/*Physics update*/
-		m_solver.Update(dt);
+		//The physics thread only runs while nothing here touches the solver: keys held, the mouse over imgui, the editor
+		//open or step mode all go back to stepping on this thread
+		bool runAsync = m_asyncPhysics && !m_solver.m_stepMode && !m_showRigidbodyEditor && !m_inputDown && !ImGui::GetIO().WantCaptureMouse;
+		if (runAsync) m_asyncSolver.Start();
+		else {
+			m_asyncSolver.Stop();
+			m_solver.Update(dt);
+		}
 		/* Render here */
 		glClear(GL_COLOR_BUFFER_BIT);
 		glColor3f(1, 1, 1);
-		//Loop through solver's rigidbody pool
-		for (Rigidbody* rb = (Rigidbody*)m_solver.m_allocator.GetFirstBody(); rb != nullptr; rb = m_solver.m_allocator.GetNextBody(rb)) {
-			glLoadIdentity();
-			switch (rb->m_bodyType) {
-			case BodyType::Circle: {
-				Circle* circle = (Circle*)rb;
-				glTranslatef((float)rb->m_position.x, (float)rb->m_position.y, -1);
-				glRotatef((float)rb->m_rotation * RAD2DEG, 0, 0, 1);
-				glScalef((float)circle->m_radius, (float)circle->m_radius, (float)circle->m_radius);
-				glBegin(GL_TRIANGLES);
-				//Circle vertices from trig
-				for (int i = 0; i < 350; i += 10) {
-					//Counter clockwise
-					glVertex3f(0, 0, 0);
-					glVertex3f(cos(i * DEG2RAD), sin(i * DEG2RAD), 0);
-					glVertex3f(cos((i + 10.f) * DEG2RAD), sin((i + 10.f) * DEG2RAD), 0);
-				}
-				break;
+		//Loop through solver's rigidbody pool, or the last step the physics thread published
+		if (runAsync) {
+			RenderSnapshot& snapshot = m_asyncSolver.AcquireSnapshot();
+			decimal alpha = m_asyncSolver.GetAlpha(snapshot);
+			for (Rigidbody* rb = snapshot.GetFirstBody(); rb != nullptr; rb = snapshot.GetNextBody(rb)) {
+				DrawBody(rb, alpha);
 			}
-			case BodyType::Capsule: {
-				Capsule* capsule = (Capsule*)rb;
-				//Capsule matrix stuff
-				glTranslatef((float)rb->m_position.x, (float)rb->m_position.y, -1);
-				glRotatef((float)rb->m_rotation * RAD2DEG, 0, 0, 1);
-				glBegin(GL_TRIANGLES);
-				//Capsule vertices (Two circles and rectangle?)
-				float offSet = (float)capsule->m_length / 2;
-				float rad = (float)capsule->m_radius;
-				for (int i = 0; i < 350; i += 10) {
-					glVertex3f(-offSet, 0, 0);
-					glVertex3f(-offSet + rad * cos(i * DEG2RAD), rad * sin(i * DEG2RAD), 0);
-					glVertex3f(-offSet + rad * cos((i + 10.f) * DEG2RAD), rad * sin((i + 10.f) * DEG2RAD), 0);
-				}
-				for (int i = 0; i < 350; i += 10) {
-					glVertex3f(offSet, 0, 0);
-					glVertex3f(offSet + rad * cos(i * DEG2RAD), rad * sin(i * DEG2RAD), 0);
-					glVertex3f(offSet + rad * cos((i + 10.f) * DEG2RAD), rad * sin((i + 10.f) * DEG2RAD), 0);
-				}
-				//Draw rectangle in gltriangles
-				glVertex3f(-offSet, -rad, 0);
-				glVertex3f(offSet, -rad, 0);
-				glVertex3f(offSet, rad, 0);
-				//Tri2
-				glVertex3f(-offSet, -rad, 0);
-				glVertex3f(offSet, rad, 0);
-				glVertex3f(-offSet, rad, 0);
-				break;
-			}
-			case BodyType::Obb: {
-				OrientedBox* obb = (OrientedBox*)rb;
-				glTranslatef((float)rb->m_position.x, (float)rb->m_position.y, -1);
-				glRotatef((float)rb->m_rotation * RAD2DEG, 0, 0, 1);
-				glBegin(GL_TRIANGLES);
-				//Rectangle made up of two triangles
-				Vector2 halfExtents = obb->m_halfExtents;
-				glVertex3f(-(float)halfExtents.x, -(float)halfExtents.y, 0);
-				glVertex3f((float)halfExtents.x, -(float)halfExtents.y, 0);
-				glVertex3f((float)halfExtents.x, (float)halfExtents.y, 0);
-				//Upper tri
-				glVertex3f(-(float)halfExtents.x, -(float)halfExtents.y, 0);
-				glVertex3f((float)halfExtents.x, (float)halfExtents.y, 0);
-				glVertex3f(-(float)halfExtents.x, (float)halfExtents.y, 0);
-				break;
+		}
+		else {
+			decimal alpha = m_solver.GetInterpolationAlpha();
+			for (Rigidbody* rb = (Rigidbody*)m_solver.m_allocator.GetFirstBody(); rb != nullptr; rb = m_solver.m_allocator.GetNextBody(rb)) {
+				DrawBody(rb, alpha);
 			}
+		}
+		//Static shapes: draw every segment proxy
+		glColor3f(0.6f, 0.6f, 0.6f);
+		for (StaticShape* shape : m_solver.m_staticShapes) {
+			glLoadIdentity();
+			glTranslatef(0, 0, -1);
+			glBegin(GL_TRIANGLES);
+			for (OrientedBox& segment : shape->m_segments) {
+				Vector2 corners[4];
+				segment.GetCorners(corners);
+				glVertex3f((float)corners[0].x, (float)corners[0].y, 0);
+				glVertex3f((float)corners[1].x, (float)corners[1].y, 0);
+				glVertex3f((float)corners[2].x, (float)corners[2].y, 0);
+				glVertex3f((float)corners[0].x, (float)corners[0].y, 0);
+				glVertex3f((float)corners[2].x, (float)corners[2].y, 0);
+				glVertex3f((float)corners[3].x, (float)corners[3].y, 0);
 			}
 			glEnd();
 		}
+		glColor3f(1, 1, 1);
 
-		//Render manifolds
-		if (m_displayManifolds) {
+		//Render manifolds, they belong to the physics thread while it runs
+		if (m_displayManifolds && !runAsync) {
 			glColor3f(1, 0, 0);
 			//Draw in red: Normal with magnitude at all contact points
 			for ( Manifold& manifold : m_solver.m_currentManifolds) {
@@ -274,8 +278,37 @@ void TestApp::UpdateLoop()
 			}
 			glEnd();
 		}
+		//Leaf heat map: blue to red by pair tests, scaled to the busiest leaf
+		if ((m_leafHeatMap || m_showPerformance) && !runAsync) m_solver.GetBroadphaseDiagnostics(m_broadphaseDiagnostics);
+		if (m_leafHeatMap && !runAsync)
+		{
+			std::vector<QuadNode*> leafNodes;
+			m_solver.m_quadTreeRoot.GetLeafNodes(leafNodes);
+			const std::vector<size_t>& pairTests = m_broadphaseDiagnostics.leafPairTests;
+			size_t maxPairTests = 1;
+			for (size_t tests : pairTests) maxPairTests = std::max(maxPairTests, tests);
+			glLoadIdentity();
+			glTranslatef(0, 0, -1);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glBegin(GL_QUADS);
+			for (size_t i = 0; i < leafNodes.size() && i < pairTests.size(); i++)
+			{
+				float heat = (float)pairTests[i] / (float)maxPairTests;
+				glColor4f(heat, 0.f, 1.f - heat, 0.15f + 0.35f * heat);
+				Vector2 topRight = leafNodes[i]->m_topRight;
+				Vector2 bottomLeft = leafNodes[i]->m_bottomLeft;
+				glVertex3f((float)topRight.x, (float)topRight.y, 0);
+				glVertex3f((float)bottomLeft.x, (float)topRight.y, 0);
+				glVertex3f((float)bottomLeft.x, (float)bottomLeft.y, 0);
+				glVertex3f((float)topRight.x, (float)bottomLeft.y, 0);
+			}
+			glEnd();
+			glDisable(GL_BLEND);
+			glColor3f(1, 1, 1);
+		}
 		//Render leaf nodes
-		if (m_renderLeafNodes)
+		if (m_renderLeafNodes && !runAsync)
 		{
 			//Similar to drawing grid
 			std::vector<QuadNode*> leafNodes;
@@ -315,6 +348,107 @@ void TestApp::UpdateLoop()
 	glfwTerminate();
 }
 
+void TestApp::DrawBody(Rigidbody* rb, decimal alpha)
+{
+	//Blend the last two steps for drawing only, the body stays as the solver left it
+	Vector2 position = rb->m_prevPos + (rb->m_position - rb->m_prevPos) * alpha;
+	decimal rotation = rb->m_prevRot + (rb->m_rotation - rb->m_prevRot) * alpha;
+	DrawShape(rb, position, rotation);
+}
+
+void TestApp::DrawShape(Rigidbody* rb, Vector2 position, decimal rotation)
+{
+	glLoadIdentity();
+	switch (rb->m_bodyType) {
+	case BodyType::Circle: {
+		Circle* circle = (Circle*)rb;
+		glTranslatef((float)position.x, (float)position.y, -1);
+		glRotatef((float)rotation * RAD2DEG, 0, 0, 1);
+		glScalef((float)circle->m_radius, (float)circle->m_radius, (float)circle->m_radius);
+		glBegin(GL_TRIANGLES);
+		//Circle vertices from trig
+		for (int i = 0; i < 350; i += 10) {
+			//Counter clockwise
+			glVertex3f(0, 0, 0);
+			glVertex3f(cos(i * DEG2RAD), sin(i * DEG2RAD), 0);
+			glVertex3f(cos((i + 10.f) * DEG2RAD), sin((i + 10.f) * DEG2RAD), 0);
+		}
+		break;
+	}
+	case BodyType::Capsule: {
+		Capsule* capsule = (Capsule*)rb;
+		//Capsule matrix stuff
+		glTranslatef((float)position.x, (float)position.y, -1);
+		glRotatef((float)rotation * RAD2DEG, 0, 0, 1);
+		glBegin(GL_TRIANGLES);
+		//Capsule vertices (Two circles and rectangle?)
+		float offSet = (float)capsule->m_length / 2;
+		float rad = (float)capsule->m_radius;
+		for (int i = 0; i < 350; i += 10) {
+			glVertex3f(-offSet, 0, 0);
+			glVertex3f(-offSet + rad * cos(i * DEG2RAD), rad * sin(i * DEG2RAD), 0);
+			glVertex3f(-offSet + rad * cos((i + 10.f) * DEG2RAD), rad * sin((i + 10.f) * DEG2RAD), 0);
+		}
+		for (int i = 0; i < 350; i += 10) {
+			glVertex3f(offSet, 0, 0);
+			glVertex3f(offSet + rad * cos(i * DEG2RAD), rad * sin(i * DEG2RAD), 0);
+			glVertex3f(offSet + rad * cos((i + 10.f) * DEG2RAD), rad * sin((i + 10.f) * DEG2RAD), 0);
+		}
+		//Draw rectangle in gltriangles
+		glVertex3f(-offSet, -rad, 0);
+		glVertex3f(offSet, -rad, 0);
+		glVertex3f(offSet, rad, 0);
+		//Tri2
+		glVertex3f(-offSet, -rad, 0);
+		glVertex3f(offSet, rad, 0);
+		glVertex3f(-offSet, rad, 0);
+		break;
+	}
+	case BodyType::Obb: {
+		OrientedBox* obb = (OrientedBox*)rb;
+		glTranslatef((float)position.x, (float)position.y, -1);
+		glRotatef((float)rotation * RAD2DEG, 0, 0, 1);
+		glBegin(GL_TRIANGLES);
+		//Rectangle made up of two triangles
+		Vector2 halfExtents = obb->m_halfExtents;
+		glVertex3f(-(float)halfExtents.x, -(float)halfExtents.y, 0);
+		glVertex3f((float)halfExtents.x, -(float)halfExtents.y, 0);
+		glVertex3f((float)halfExtents.x, (float)halfExtents.y, 0);
+		//Upper tri
+		glVertex3f(-(float)halfExtents.x, -(float)halfExtents.y, 0);
+		glVertex3f((float)halfExtents.x, (float)halfExtents.y, 0);
+		glVertex3f(-(float)halfExtents.x, (float)halfExtents.y, 0);
+		break;
+	}
+	case BodyType::Compound: {
+		//Children are placed from the drawn transform the way UpdateChildren places them from the body's, only their shapes are read
+		Compound* compound = (Compound*)rb;
+		Mat2 rotationMatrix = Mat2(rotation);
+		for (int i = 0; i < compound->m_childCount; i++)
+		{
+			DrawShape(compound->GetChild(i), position + compound->m_childOffsets[i].Rotated(rotationMatrix), rotation + compound->m_childRotations[i]);
+		}
+		return;
+	}
+	case BodyType::Polygon: {
+		ConvexPolygon* polygon = (ConvexPolygon*)rb;
+		glTranslatef((float)position.x, (float)position.y, -1);
+		glRotatef((float)rotation * RAD2DEG, 0, 0, 1);
+		glBegin(GL_TRIANGLES);
+		//Fan around the centroid
+		for (int i = 0; i < polygon->m_vertexCount; i++) {
+			Vector2 v1 = polygon->m_vertices[i];
+			Vector2 v2 = polygon->m_vertices[(i + 1 < polygon->m_vertexCount) ? i + 1 : 0];
+			glVertex3f(0, 0, 0);
+			glVertex3f((float)v1.x, (float)v1.y, 0);
+			glVertex3f((float)v2.x, (float)v2.y, 0);
+		}
+		break;
+	}
+	}
+	glEnd();
+}
+
 void TestApp::DrawImgui()
 {
 	ImGui_ImplOpenGL3_NewFrame();
@@ -323,8 +457,13 @@ void TestApp::DrawImgui()
 	// 1. Show the big demo window (Most of the sample code is in ImGui::ShowDemoWindow()! You can browse its code to learn more about Dear ImGui!).
 	if (m_showDemoWindow)
 		ImGui::ShowDemoWindow(&m_showDemoWindow);
-	if (m_showRigidbodyEditor)
+	//Hovering a window hands the solver back to this thread before any widget writes to it
+	if (ImGui::GetIO().WantCaptureMouse)
+		m_asyncSolver.Stop();
+	if (m_showRigidbodyEditor && !m_asyncSolver.IsRunning())
 		ImGuiShowRigidbodyEditor();
+	if (m_showPerformance)
+		ImGuiShowPerformance();
 	// 2. Show a simple window that we create ourselves. We use a Begin/End pair to created a named window.
 	{
 		ImGui::Begin(m_sceneName.c_str());                          // Create a window and append into it.
@@ -335,12 +474,42 @@ void TestApp::DrawImgui()
 		ImGui::Checkbox("Show Rigidbody Editor (Y)", &m_showRigidbodyEditor); 
 		ImGui::Checkbox("Display manifolds (U)", &m_displayManifolds);
 		ImGui::Checkbox("Show Grid (I)", &m_drawGrid);
+		ImGui::Checkbox("Show Performance", &m_showPerformance);
 		ImGui::Text("Destroy first body (O)");
 		ImGui::Text("Launch bomb (P)");
 		ImGui::Checkbox("Static & Kinetic friction", &m_solver.m_frictionModel);
 		ImGui::Checkbox("Static collision resolution: True", &m_solver.m_staticResolution);
 		ImGui::Checkbox("Show Leaf Nodes", &m_renderLeafNodes);
+		ImGui::Checkbox("Leaf heat map (pair tests)", &m_leafHeatMap);
 		ImGui::Checkbox("Log Collision Info", &m_solver.m_logCollisionInfo);
+		//Speculative contacts hold up at a longer timestep
+		if (ImGui::Checkbox("Speculative contacts (30 Hz)", &m_solver.m_speculativeContacts)) {
+			m_solver.m_timestep = m_solver.m_speculativeContacts ? 1.f / 30.f : 0.02f;
+		}
+		//Step phases spread over the solver's job system
+		int threadCount = (int)m_solver.m_jobSystem.GetThreadCount();
+		if (ImGui::SliderInt("Physics threads", &threadCount, 1, 16)) m_solver.m_jobSystem.SetThreadCount(threadCount);
+		//The physics thread writes them while it runs
+		if (!m_asyncSolver.IsRunning()) ImGui::Text("Step: integration %.2f ms, broadphase %.2f ms, narrowphase %.2f ms, response %.2f ms",
+		 m_solver.m_phaseTimes[(int)StepPhase::Integration], m_solver.m_phaseTimes[(int)StepPhase::Broadphase],
+		 m_solver.m_phaseTimes[(int)StepPhase::Narrowphase], m_solver.m_phaseTimes[(int)StepPhase::Response]);
+		//Captures until unticked, then writes the trace for chrome://tracing or Perfetto. The physics thread owns it while it runs
+		bool tracing = m_solver.m_trace != nullptr;
+		if (!m_asyncSolver.IsRunning() && ImGui::Checkbox("Record trace (pip_trace.json)", &tracing))
+		{
+			if (tracing)
+			{
+				m_trace.Clear();
+				m_solver.m_trace = &m_trace;
+			}
+			else
+			{
+				m_solver.m_trace = nullptr;
+				m_trace.Write("pip_trace.json");
+			}
+		}
+		//Steps on a thread of its own, drawing blends the last two published steps
+		if (ImGui::Checkbox("Async physics thread", &m_asyncPhysics) && m_asyncPhysics) m_showRigidbodyEditor = false;
 		ImGui::Text("Continuous Collision : False");
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 		ImGui::End();
@@ -348,6 +517,82 @@ void TestApp::DrawImgui()
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
+void TestApp::ImGuiShowPerformance()
+{
+	ImGui::Begin("Performance", &m_showPerformance);
+	//One sample per frame. The physics thread writes the counters while it runs, the graphs hold still until it stops
+	const StepStats& stats = m_solver.m_stepStats;
+	if (!m_asyncSolver.IsRunning()) {
+		float samples[(int)PerfGraph::Count] = {
+			(float)m_solver.m_phaseTimes[(int)StepPhase::Integration], (float)m_solver.m_phaseTimes[(int)StepPhase::Broadphase],
+			(float)m_solver.m_phaseTimes[(int)StepPhase::Narrowphase], (float)m_solver.m_phaseTimes[(int)StepPhase::Response],
+			(float)stats.pairTests, (float)stats.manifolds, (float)stats.awakeBodies, (float)stats.sleepingBodies,
+			(float)stats.leafCount, (float)stats.quadTreeDepth
+		};
+		for (int i = 0; i < (int)PerfGraph::Count; i++) m_perfHistory[i][m_perfOffset] = samples[i];
+		m_perfOffset = (m_perfOffset + 1) % PERF_HISTORY;
+	}
+	else ImGui::Text("Paused while the physics thread runs");
+	const char* names[(int)PerfGraph::Count] = { "Integration ms", "Broadphase ms", "Narrowphase ms", "Response ms", "Pair tests",
+		"Manifolds", "Awake bodies", "Sleeping bodies", "Leaves", "Quadtree depth" };
+	for (int i = 0; i < (int)PerfGraph::Count; i++) {
+		//Each graph scales to its own peak, the latest value is written over it
+		float peak = 0;
+		for (float sample : m_perfHistory[i]) peak = Max(peak, sample);
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%.2f (peak %.2f)", m_perfHistory[i][(m_perfOffset + PERF_HISTORY - 1) % PERF_HISTORY], peak);
+		ImGui::PlotLines(names[i], m_perfHistory[i], PERF_HISTORY, m_perfOffset, overlay, 0.f, Max(peak, 1.f) * 1.1f, ImVec2(0, 40));
+	}
+	ImGui::Separator();
+	ImGui::Text("Bodies: %d awake, %d sleeping, %d kinematic", (int)stats.awakeBodies, (int)stats.sleepingBodies, (int)stats.kinematicBodies);
+	//Broadphase as it stands, see Solver::GetBroadphaseDiagnostics
+	if (!m_asyncSolver.IsRunning()) {
+		const BroadphaseDiagnostics& diagnostics = m_broadphaseDiagnostics;
+		std::vector<float> histogram(diagnostics.leavesPerDepth.begin(), diagnostics.leavesPerDepth.end());
+		ImGui::PlotHistogram("Leaves per depth", histogram.data(), (int)histogram.size(), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 40));
+		histogram.assign(diagnostics.leavesPerBodyCount.begin(), diagnostics.leavesPerBodyCount.end());
+		ImGui::PlotHistogram("Leaves per body count", histogram.data(), (int)histogram.size(), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 40));
+		ImGui::Text("Bodies in several leaves: %d", (int)diagnostics.bodiesInSeveralLeaves);
+		ImGui::Text("Pair tests %d, unique %d, overlapping %d: %.1f%% efficient", (int)diagnostics.pairTests, (int)diagnostics.uniquePairs,
+		 (int)diagnostics.overlaps, diagnostics.efficiency * 100.f);
+	}
+	if (!m_asyncSolver.IsRunning()) {
+		MemoryReport memory;
+		m_solver.GetMemoryReport(memory);
+		ImGui::Text("Memory %.1f KB: pool %.1f of %.1f KB, quadtree %d nodes %.1f KB, manifolds %.1f KB", memory.total / 1024.f,
+		 memory.poolUsed / 1024.f, memory.poolReserved / 1024.f, (int)memory.quadTreeNodes, (memory.quadTreeBytes + memory.leafVectors) / 1024.f,
+		 memory.manifolds / 1024.f);
+	}
+	ImGui::InputInt("Bodies to spawn", &m_spawnCount, 100, 1000);
+	m_spawnCount = std::max(m_spawnCount, 1);
+	if (ImGui::Button("Spawn")) SpawnRandomBodies(m_spawnCount);
+	ImGui::End();
+}
+
+void TestApp::SpawnRandomBodies(int count)
+{
+	//Hovering the button already took the solver back from the physics thread
+	m_asyncSolver.Stop();
+	DefaultAllocator& allocator = m_solver.m_allocator;
+	m_solver.ReservePool((allocator.m_pool.next - allocator.m_pool.start) + count * sizeof(OrientedBox));
+	Vector2 topRight = m_solver.m_quadTreeRoot.m_topRight;
+	Vector2 bottomLeft = m_solver.m_quadTreeRoot.m_bottomLeft;
+	auto random = [](float min, float max) { return min + (max - min) * (float)rand() / (float)RAND_MAX; };
+	std::vector<BodyDesc> descs(count);
+	for (BodyDesc& desc : descs) {
+		desc.bodyType = (BodyType)(rand() % 3);
+		desc.radius = random(0.05f, 0.2f);
+		desc.length = random(0.1f, 0.3f);
+		desc.halfExtents = Vector2(random(0.05f, 0.2f), random(0.05f, 0.2f));
+		desc.position = Vector2(random((float)bottomLeft.x, (float)topRight.x), random((float)bottomLeft.y, (float)topRight.y));
+		desc.rotation = random(0.f, 2 * PI);
+		desc.velocity = Vector2(random(-2.f, 2.f), random(-2.f, 2.f));
+	}
+	std::vector<Handle> handles(count);
+	if (m_solver.CreateBodies(descs.data(), count, handles.data()) != -1)
+		m_bodyHandles.insert(m_bodyHandles.end(), handles.begin(), handles.end());
+}
+
 //Maybe take handle to boolean
 void TestApp::ImGuiShowRigidbodyEditor()
 {
@@ -378,6 +623,18 @@ void TestApp::ImGuiShowRigidbodyEditor()
 			snprintf(objDesc, 100, "halfExtents: x(%f), y(%f)", (double)obb->m_halfExtents.x, (double)obb->m_halfExtents.y);//Worth revising this
 			break;
 		}
+		case BodyType::Polygon: {
+			ConvexPolygon* polygon = (ConvexPolygon*)rb;
+			objShape = "ConvexPolygon";
+			snprintf(objDesc, 100, "Vertices(%i)", polygon->m_vertexCount);
+			break;
+		}
+		case BodyType::Compound: {
+			Compound* compound = (Compound*)rb;
+			objShape = "Compound";
+			snprintf(objDesc, 100, "Children(%i)", compound->m_childCount);
+			break;
+		}
 		}
 		//Turn to char*
 		char* strId = new char[10];
@@ -403,8 +660,8 @@ void TestApp::ImGuiShowRigidbodyEditor()
 			snprintf(realVel, 50, "Vel (Real) X(%f), Y(%f)", (double)rb->m_velocity.x, (double)rb->m_velocity.y);
 			ImGui::Text(realVel);
 #else
-			ImGui::DragFloat("VelX", &rb->m_velocity.x, 1.0f);//#TODO: Might not be compatible with fixedpoint mode. Create wrapper for inputfloat funcs?
-			ImGui::DragFloat("VelY", &rb->m_velocity.y, 1.0f);
+			if (ImGui::DragFloat("VelX", &rb->m_velocity.x, 1.0f)) m_solver.m_stateHashStale = true;//#TODO: Might not be compatible with fixedpoint mode. Create wrapper for inputfloat funcs?
+			if (ImGui::DragFloat("VelY", &rb->m_velocity.y, 1.0f)) m_solver.m_stateHashStale = true;
 #endif
 			ImGui::NextColumn();
 
@@ -415,7 +672,7 @@ void TestApp::ImGuiShowRigidbodyEditor()
 			snprintf(realRot, 50, "Rot (Real) (%f)", (double)rb->m_angularVelocity);
 			ImGui::Text(realRot);
 #else
-			ImGui::DragFloat("Rot (Rad/S)", &rb->m_angularVelocity, 0.1f);
+			if (ImGui::DragFloat("Rot (Rad/S)", &rb->m_angularVelocity, 0.1f)) m_solver.m_stateHashStale = true;
 #endif
 			ImGui::NextColumn();
 
@@ -558,6 +815,7 @@ void TestApp::ProcessInput()
 	short f4 = glfwGetKey(m_window, GLFW_KEY_F4);
 	short f5 = glfwGetKey(m_window, GLFW_KEY_F5);
 	short f6 = glfwGetKey(m_window, GLFW_KEY_F6);
+	short f7 = glfwGetKey(m_window, GLFW_KEY_F7);
 	short r = glfwGetKey(m_window, GLFW_KEY_R);
 	short t = glfwGetKey(m_window, GLFW_KEY_T);
 	short y = glfwGetKey(m_window, GLFW_KEY_Y);
@@ -566,13 +824,15 @@ void TestApp::ProcessInput()
 	short o = glfwGetKey(m_window, GLFW_KEY_O);
 	short p = glfwGetKey(m_window, GLFW_KEY_P);
 
-	short inputDownNew = (f1 << 0) | (f2 << 1) | (f3 << 2) | (f4 << 3) | (f5 << 4) | (f6 << 5) | (r << 6) | (t << 7) | (y << 8) | (u << 9) | (i << 10) | (o << 11) | (p << 12);
+	short inputDownNew = (f1 << 0) | (f2 << 1) | (f3 << 2) | (f4 << 3) | (f5 << 4) | (f6 << 5) | (r << 6) | (t << 7) | (y << 8) | (u << 9) | (i << 10) | (o << 11) | (p << 12) | (f7 << 13);
 	//AND with m_inputDown to get m_inputHeld
 	m_inputHeld = m_inputDown & inputDownNew;
 	m_inputPressed = ~m_inputDown & inputDownNew;
 	//etc, then assign new inputDown
 	m_inputReleased = m_inputDown & ~inputDownNew;
 	m_inputDown = inputDownNew;
+	//Keys change the scene and settings, the physics thread hands the solver back first
+	if (m_inputDown) m_asyncSolver.Stop();
 
 	//React to input
 	if (m_inputPressed & (short)Keys::F1)LoadScene(0);
@@ -581,6 +841,7 @@ void TestApp::ProcessInput()
 	if (m_inputPressed & (short)Keys::F4)LoadScene(3);
 	if (m_inputPressed & (short)Keys::F5)LoadScene(4);
 	if (m_inputPressed & (short)Keys::F6)LoadScene(5);
+	if (m_inputPressed & (short)Keys::F7)LoadScene(6);
 
 	if (m_inputPressed & (short)Keys::R)m_solver.m_stepMode ^= 1;
 	if (m_inputPressed & (short)Keys::T)m_solver.m_stepOnce = m_solver.m_stepMode & true;
@@ -592,6 +853,7 @@ void TestApp::ProcessInput()
 		//Debug delete first body handle on the list
 		if (!m_bodyHandles.empty()){
 			m_solver.m_allocator.DestroyBody(m_bodyHandles[0]);
+			m_solver.m_stateHashStale = true;
 			m_bodyHandles.erase(m_bodyHandles.begin());
 			//#WIP Solution to manifolds being invalid when deleting objs on step mode, as Step() doesn't run to clear them
 			if (m_solver.m_stepMode) m_solver.m_currentManifolds.clear();
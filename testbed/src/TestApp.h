@@ -9,6 +9,7 @@
 #include "imgui_impl_opengl3.h"
 
 #include "Solver.h"
+#include "AsyncSolver.h"
 
 enum class Keys : 
 	short {
@@ -24,7 +25,25 @@ enum class Keys :
 	U = (1 << 9),
 	I = (1 << 10),
 	O = (1 << 11),
-	P = (1 << 12)
+	P = (1 << 12),
+	F7 = (1 << 13)
+};
+#define PERF_HISTORY 240//Frames kept by each performance graph
+
+//Graphs of the performance window, fed by Solver::m_phaseTimes and Solver::m_stepStats
+enum class PerfGraph
+{
+	Integration,
+	Broadphase,
+	Narrowphase,
+	Response,
+	PairTests,
+	Manifolds,
+	AwakeBodies,
+	SleepingBodies,
+	LeafCount,
+	QuadTreeDepth,
+	Count
 };
 //Holds Physics solver, abstracts all glfw/imgui graphics, input etc.
 class TestApp
@@ -35,8 +54,12 @@ public:
 	void InitImgui();
 	void LoadScene(unsigned int index);
 	void UpdateLoop();
+	void DrawBody(Rigidbody* rb, decimal alpha = 1);//Drawn alpha of the way from its previous step to its current one
+	void DrawShape(Rigidbody* rb, PipMath::Vector2 position, decimal rotation);//At the given transform, also draws each child of a compound
 	void DrawImgui();
 	void ImGuiShowRigidbodyEditor();
+	void ImGuiShowPerformance();
+	void SpawnRandomBodies(int count);//Circles, capsules and boxes scattered over the quadtree area, grows the pool
 	void ProcessInput();
 	void LaunchBomb();
 public:
@@ -47,10 +70,17 @@ public:
 	//Physics
 	Solver m_solver;
 	std::vector<Handle> m_bodyHandles;
+	AsyncSolver m_asyncSolver;//Declared after m_solver, stops its thread before the solver goes away
+	TraceRecorder m_trace;//m_solver.m_trace points here while recording
 	//Timestep
 	decimal m_prevTime;
 	//Imgui
-	bool m_showDemoWindow, m_showRigidbodyEditor, m_displayManifolds, m_drawGrid, m_renderLeafNodes;//#Bit field?
-	//Input: Short =16 bits. 0-5 load scenes.. see Keys::
+	bool m_showDemoWindow, m_showRigidbodyEditor, m_displayManifolds, m_drawGrid, m_renderLeafNodes, m_asyncPhysics, m_showPerformance,
+	m_leafHeatMap;//#Bit field?
+	BroadphaseDiagnostics m_broadphaseDiagnostics;//Refreshed every frame the heat map or performance window need it
+	float m_perfHistory[(int)PerfGraph::Count][PERF_HISTORY];//Ring buffers, m_perfOffset is the oldest sample
+	int m_perfOffset;
+	int m_spawnCount;
+	//Input: Short =16 bits. 0-5 and 13 load scenes.. see Keys::
 	short m_inputDown, m_inputPressed, m_inputHeld, m_inputReleased;
 };